@@ -39,6 +39,10 @@
 /* Function definitions */
 static void	TableWorldChanged(ClientData instanceData);
 static void	TableDisplay(ClientData clientdata);
+static void	TableDisplayTimer(ClientData clientdata);
+static void	TableCancelRedraw(Table *tablePtr);
+static void	TableFlashEvent(ClientData clientdata);
+static void	TableUpdateScrollbars(ClientData clientData);
 
 /*
  * The following tables define the widget commands (and sub-
@@ -55,20 +59,20 @@ enum selCommand {
 
 static const char *commandNames[] = {
     "activate", "bbox", "border", "cget", "clear", "configure", "curselection", "curvalue",
-    "delete", "get", "height", "hidden", "icursor", "index", "insert",
+    "delete", "filter", "flush", "get", "height", "hidden", "icursor", "index", "insert",
 #ifdef POSTSCRIPT
     "postscript",
 #endif
-    "reread", "scan", "see", "selection", "set", "spans", "tag", "validate", "version",
+    "reorder", "reread", "scan", "see", "selection", "set", "snapshot", "sort", "spans", "tag", "validate", "version",
     "window", "width", "xview", "yview", (char *)NULL
 };
 enum command {
     CMD_ACTIVATE, CMD_BBOX, CMD_BORDER, CMD_CGET, CMD_CLEAR, CMD_CONFIGURE, CMD_CURSEL,
-    CMD_CURVALUE, CMD_DELETE, CMD_GET, CMD_HEIGHT, CMD_HIDDEN, CMD_ICURSOR, CMD_INDEX, CMD_INSERT,
+    CMD_CURVALUE, CMD_DELETE, CMD_FILTER, CMD_FLUSH, CMD_GET, CMD_HEIGHT, CMD_HIDDEN, CMD_ICURSOR, CMD_INDEX, CMD_INSERT,
 #ifdef POSTSCRIPT
     CMD_POSTSCRIPT,
 #endif
-    CMD_REREAD, CMD_SCAN, CMD_SEE, CMD_SELECTION, CMD_SET, CMD_SPANS, CMD_TAG, CMD_VALIDATE,
+    CMD_REORDER, CMD_REREAD, CMD_SCAN, CMD_SEE, CMD_SELECTION, CMD_SET, CMD_SNAPSHOT, CMD_SORT, CMD_SPANS, CMD_TAG, CMD_VALIDATE,
     CMD_VERSION, CMD_WINDOW, CMD_WIDTH, CMD_XVIEW, CMD_YVIEW
 };
 
@@ -225,6 +229,8 @@ Tk_ConfigSpec tableSpecs[] = {
 	offsetof(Table, ipadY), 0},
     {TK_CONFIG_JUSTIFY, "-justify", "justify", "Justify", "left",
 	offsetof(Table, defaultTag.justify), 0},
+    {TK_CONFIG_INT, "-maxfps", "maxFps", "MaxFps", "0",
+	offsetof(Table, maxFps), 0},
     {TK_CONFIG_PIXELS, "-maxheight", "maxHeight", "MaxHeight", "600",
 	offsetof(Table, maxReqHeight), 0},
     {TK_CONFIG_PIXELS, "-maxwidth", "maxWidth", "MaxWidth", "800",
@@ -235,6 +241,8 @@ Tk_ConfigSpec tableSpecs[] = {
     {TK_CONFIG_PIXELS, "-pady", "padY", "Pad", "0", offsetof(Table, padY), 0},
     {TK_CONFIG_RELIEF, "-relief", "relief", "Relief", "sunken",
 	offsetof(Table, defaultTag.relief), 0},
+    {TK_CONFIG_INT, "-renderbudget", "renderBudget", "RenderBudget", "0",
+	offsetof(Table, renderBudget), 0},
     {TK_CONFIG_CUSTOM, "-resizeborders", "resizeBorders", "ResizeBorders", "both",
 	offsetof(Table, resize), 0, &resizeTypeOpt},
     {TK_CONFIG_INT, "-rowheight", "rowHeight", "RowHeight", "1",
@@ -434,7 +442,7 @@ static char * TableVarProc(
 		/* clear the selection buffer */
 		TableGetActiveBuf(tablePtr);
 		/* flush any cache */
-		Table_ClearHashTable(tablePtr->cache);
+		TableClearValueCache(tablePtr->cache);
 		Tcl_InitHashTable(tablePtr->cache, TCL_STRING_KEYS);
 		/* and invalidate the table */
 		TableInvalidateAll(tablePtr, 0);
@@ -488,21 +496,25 @@ static char * TableVarProc(
 
 	    entryPtr = Tcl_CreateHashEntry(tablePtr->cache, buf, &new);
 	    if (!new) {
-		data = (char *) Tcl_GetHashValue(entryPtr);
-		if (data) { Tcl_Free(data); }
+		TableFreeCacheValue((char *) Tcl_GetHashValue(entryPtr));
 	    }
 	    data = (char *) Tcl_GetVar2(interp, name, index, TCL_GLOBAL_ONLY);
 	    if (data && *data != '\0') {
-		val = (char *)Tcl_Alloc((Tcl_Size)strlen(data)+1);
-		strcpy(val, data);
+		val = TableNewCacheValue(data);
 	    } else {
 		val = NULL;
 	    }
 	    Tcl_SetHashValue(entryPtr, val);
 	}
-	/* convert index to real coords */
-	row -= tablePtr->rowOffset;
-	col -= tablePtr->colOffset;
+	/* the row may start or stop matching the row filter */
+	TableFilterChanged(tablePtr, row);
+	/* convert the data index to its place in the view, in real coords */
+	row = TableDataToView(tablePtr, row, ROW) - tablePtr->rowOffset;
+	col = TableDataToView(tablePtr, col, COL) - tablePtr->colOffset;
+	if (row < 0) {
+	    /* hidden by the row filter */
+	    return (char *)NULL;
+	}
 	/* did the active cell just update */
 	if (row == tablePtr->activeRow && col == tablePtr->activeCol) {
 	    TableGetActiveBuf(tablePtr);
@@ -647,6 +659,7 @@ static int TableConfigure(
 
     Tcl_HashSearch search;
     int oldUse, oldCaching, oldExport, oldTitleRows, oldTitleCols;
+    int oldRows, oldVisible;
     int result = TCL_OK;
     char *oldVar = NULL;
     Tcl_DString error;
@@ -657,6 +670,10 @@ static int TableConfigure(
     oldUse	= tablePtr->useCmd;
     oldTitleRows	= tablePtr->titleRows;
     oldTitleCols	= tablePtr->titleCols;
+    /* -rows is configured with the rows hidden by a filter too */
+    oldVisible		= tablePtr->rows;
+    tablePtr->rows	= TableAllRows(tablePtr);
+    oldRows		= tablePtr->rows;
     if (tablePtr->arrayVar != NULL) {
 	oldVar = Tcl_Alloc((Tcl_Size)strlen(tablePtr->arrayVar) + 1);
 	strcpy(oldVar, tablePtr->arrayVar);
@@ -669,9 +686,19 @@ static int TableConfigure(
 	/* Free oldVar if it was allocated */
 	if (oldVar != NULL) Tcl_Free(oldVar);
 
+	tablePtr->rows = MAX(1, tablePtr->rows);
+	TableFilterUpdate(tablePtr, (tablePtr->rows != oldRows));
+	TableFlushStyleCache(tablePtr);
+	TableFlushGcCache(tablePtr);
 	return TCL_ERROR;
     }
 
+    /*
+     * The table defaults may have changed, so remerge the tags,
+     * and the old font may be gone, so drop the GCs using it
+     */
+    TableFlushStyleCache(tablePtr);
+    TableFlushGcCache(tablePtr);
     Tcl_DStringInit(&error);
 
     /* Any time we configure, reevaluate what our data source is */
@@ -736,7 +763,7 @@ static int TableConfigure(
 	 * Our effective data source changed, so flush and
 	 * retrieve new active buffer
 	 */
-	Table_ClearHashTable(tablePtr->cache);
+	TableClearValueCache(tablePtr->cache);
 	Tcl_InitHashTable(tablePtr->cache, TCL_STRING_KEYS);
 	TableGetActiveBuf(tablePtr);
 	forceUpdate = 1;
@@ -744,7 +771,7 @@ static int TableConfigure(
 	/*
 	 * Caching changed, so just clear the cache for safety
 	 */
-	Table_ClearHashTable(tablePtr->cache);
+	TableClearValueCache(tablePtr->cache);
 	Tcl_InitHashTable(tablePtr->cache, TCL_STRING_KEYS);
 	forceUpdate = 1;
     }
@@ -778,6 +805,17 @@ static int TableConfigure(
     CONSTRAIN(tablePtr->titleRows, 0, tablePtr->rows);
     CONSTRAIN(tablePtr->titleCols, 0, tablePtr->cols);
 
+    /*
+     * Hide the filtered rows again.  Rows are only re-evaluated if
+     * there are new ones or the data source changed (forceUpdate).
+     */
+    if (tablePtr->filterPtr != NULL) {
+	TableFilterUpdate(tablePtr, (tablePtr->rows != oldRows) || forceUpdate);
+	if (tablePtr->rows != oldVisible) {
+	    forceUpdate = 1;
+	}
+    }
+
     /*
      * Handle change of default border style
      * The default borderwidth must be >= 0.
@@ -833,6 +871,10 @@ static int TableConfigure(
 	}
     }
     if (forceUpdate) {
+	/* the default font or text attributes may have changed */
+	TableFlushLayoutCache(tablePtr);
+	/* a new scroll command must be told the view even if unchanged */
+	tablePtr->yScrollSent[0] = tablePtr->xScrollSent[0] = -1;
 	/*
 	 * Calculate the row and column starts
 	 * Adjust the top left corner of the internal display
@@ -917,8 +959,12 @@ static int TableWidgetObjCmd(
 		Tcl_WrongNumArgs(interp, 2, objv, "option");
 		result = TCL_ERROR;
 	    } else {
+		/* -rows always reports the rows hidden by a filter too */
+		int visible = tablePtr->rows;
+		tablePtr->rows = TableAllRows(tablePtr);
 		result = Tk_ConfigureValue(interp, tablePtr->tkwin, tableSpecs,
 		    (char *) tablePtr, Tcl_GetString(objv[2]), 0);
+		tablePtr->rows = visible;
 	    }
 	    break;
 
@@ -928,9 +974,12 @@ static int TableWidgetObjCmd(
 
 	case CMD_CONFIGURE:
 	    if (objc < 4) {
+		int visible = tablePtr->rows;
+		tablePtr->rows = TableAllRows(tablePtr);
 		result = Tk_ConfigureInfo(interp, tablePtr->tkwin, tableSpecs,
 			(char *) tablePtr, (objc == 3) ?
 			Tcl_GetString(objv[2]) : (char *) NULL, 0);
+		tablePtr->rows = visible;
 	    } else {
 		result = TableConfigure(interp, tablePtr, objc - 2, objv + 2,
 			TK_CONFIG_ARGV_ONLY, 0);
@@ -950,6 +999,23 @@ static int TableWidgetObjCmd(
 	    result = Table_EditCmd(clientData, interp, objc, objv);
 	    break;
 
+	case CMD_FILTER:
+	    result = Table_FilterCmd(clientData, interp, objc, objv);
+	    break;
+
+	case CMD_FLUSH:
+	    if (objc != 2) {
+		Tcl_WrongNumArgs(interp, 2, objv, NULL);
+		result = TCL_ERROR;
+	    } else if (tablePtr->flags & REDRAW_PENDING) {
+		/* draw the damage now instead of waiting for -maxfps */
+		TableCancelRedraw(tablePtr);
+		tablePtr->flags |= FLUSHING;
+		TableDisplay((ClientData) tablePtr);
+		tablePtr->flags &= ~FLUSHING;
+	    }
+	    break;
+
 	case CMD_GET:
 	    result = Table_GetCmd(clientData, interp, objc, objv);
 	    break;
@@ -1013,6 +1079,10 @@ static int TableWidgetObjCmd(
 	    break;
 #endif
 
+	case CMD_REORDER:
+	    result = Table_ReorderCmd(clientData, interp, objc, objv);
+	    break;
+
 	case CMD_REREAD:
 	    if (objc != 2) {
 		Tcl_WrongNumArgs(interp, 2, objv, NULL);
@@ -1041,6 +1111,8 @@ static int TableWidgetObjCmd(
 		if (!TableCellVCoords(tablePtr, row, col, &i, &i, &i, &i, 1)) {
 		    tablePtr->topRow  = row-1;
 		    tablePtr->leftCol = col-1;
+		    tablePtr->topRowShift = tablePtr->leftColShift = 0;
+		    tablePtr->flags |= SCROLL_VIEW;
 		    TableAdjustParams(tablePtr);
 		}
 	    }
@@ -1084,6 +1156,14 @@ static int TableWidgetObjCmd(
 	    result = Table_SetCmd(clientData, interp, objc, objv);
 	    break;
 
+	case CMD_SNAPSHOT:
+	    result = Table_SnapshotCmd(clientData, interp, objc, objv);
+	    break;
+
+	case CMD_SORT:
+	    result = Table_SortCmd(clientData, interp, objc, objv);
+	    break;
+
 	case CMD_SPANS:
 	    result = Table_SpanCmd(clientData, interp, objc, objv);
 	    break;
@@ -1158,1714 +1238,3644 @@ static void TableRedrawHighlight(Table *tablePtr) {
 /*
  *----------------------------------------------------------------------
  *
- * TableDestroy --
- *	This procedure is invoked by Tcl_EventuallyFree
- *	to clean up the internal structure of a table at a safe time
- *	(when no-one is using it anymore).
+ * TableScreenPos --
+ *	Finds the screen position of a cell, counting the title
+ *	rows/cols first and then the scrolled ones from topRow/leftCol.
+ *	row and col are in real coords.
+ *
+ * Results:
+ *	0 if the cell is scrolled out of view, else 1 with the
+ *	position in *rPtr and *cPtr.
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableScreenPos(Table *tablePtr, int row, int col, int *rPtr, int *cPtr) {
+    if (row < 0 || col < 0
+	    || (row >= tablePtr->titleRows && row < tablePtr->topRow)
+	    || (col >= tablePtr->titleCols && col < tablePtr->leftCol)) {
+	return 0;
+    }
+    *rPtr = (row < tablePtr->titleRows) ? row : tablePtr->titleRows + row - tablePtr->topRow;
+    *cPtr = (col < tablePtr->titleCols) ? col : tablePtr->titleCols + col - tablePtr->leftCol;
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGrowDrawSlots --
+ *	Makes sure the per pass arrays of TableDisplay cover the
+ *	screen position r,c.
  *
  * Results:
  *	None
  *
  * Side effects:
- *	Everything associated with the table is freed up (hopefully).
+ *	May reallocate drawnStamps, colTagCache and colTagStamps,
+ *	keeping what the current pass has recorded.
  *
  *----------------------------------------------------------------------
  */
-static void TableDestroy(ClientData clientdata) {
-    Table *tablePtr = (Table *) clientdata;
-    Tcl_HashEntry *entryPtr;
-    Tcl_HashSearch search;
+static void TableGrowDrawSlots(Table *tablePtr, int r, int c) {
+    int *stamps, i, numRows, numCols;
 
-    /* These may be repetitive from DestroyNotify, but it doesn't hurt */
-    /* cancel any pending update or timer */
-    if (tablePtr->flags & REDRAW_PENDING) {
-	Tcl_CancelIdleCall(TableDisplay, (ClientData) tablePtr);
-	tablePtr->flags &= ~REDRAW_PENDING;
+    if (r < tablePtr->drawRows && c < tablePtr->drawCols) {
+	return;
     }
-    Tcl_DeleteTimerHandler(tablePtr->cursorTimer);
-    Tcl_DeleteTimerHandler(tablePtr->flashTimer);
-
-    /* delete the variable trace */
-    if (tablePtr->arrayVar != NULL) {
-	Tcl_UntraceVar(tablePtr->interp, tablePtr->arrayVar,
-		TCL_TRACE_WRITES | TCL_TRACE_UNSETS | TCL_GLOBAL_ONLY,
-		TableVarProc, (ClientData) tablePtr);
+    numRows = (r < tablePtr->drawRows) ? tablePtr->drawRows : MAX(r+1, 2*tablePtr->drawRows);
+    numCols = (c < tablePtr->drawCols) ? tablePtr->drawCols : MAX(c+1, 2*tablePtr->drawCols);
+
+    stamps = (int *) Tcl_Alloc(numRows * numCols * sizeof(int));
+    memset((void *) stamps, 0, numRows * numCols * sizeof(int));
+    for (i = 0; i < tablePtr->drawRows; i++) {
+	memcpy((void *) (stamps + i * numCols),
+		(void *) (tablePtr->drawnStamps + i * tablePtr->drawCols),
+		tablePtr->drawCols * sizeof(int));
     }
+    if (tablePtr->drawnStamps != NULL) {
+	Tcl_Free((char *) tablePtr->drawnStamps);
+    }
+    tablePtr->drawnStamps = stamps;
+
+    if (numCols > tablePtr->drawCols) {
+	tablePtr->colTagCache = (TableTag **) Tcl_Realloc((char *) tablePtr->colTagCache,
+		numCols * sizeof(TableTag *));
+	tablePtr->colTagStamps = (int *) Tcl_Realloc((char *) tablePtr->colTagStamps,
+		numCols * sizeof(int));
+	for (i = tablePtr->drawCols; i < numCols; i++) {
+	    tablePtr->colTagStamps[i] = 0;
+	}
+    }
+    tablePtr->drawRows = numRows;
+    tablePtr->drawCols = numCols;
+}
 
-    /* free the int arrays */
-    if (tablePtr->colPixels) Tcl_Free((char *) tablePtr->colPixels);
-    if (tablePtr->rowPixels) Tcl_Free((char *) tablePtr->rowPixels);
-    if (tablePtr->colStarts) Tcl_Free((char *) tablePtr->colStarts);
-    if (tablePtr->rowStarts) Tcl_Free((char *) tablePtr->rowStarts);
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableCellDrawn --
+ *	Checks whether the current TableDisplay pass already drew the
+ *	position of a cell, as part of another rectangle or of a span.
+ *	row and col are in real coords.
+ *
+ * Results:
+ *	1 if it was drawn, 0 otherwise.
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableCellDrawn(Table *tablePtr, int row, int col) {
+    int r, c;
 
-    /* delete cached active tag and string */
-    if (tablePtr->activeTagPtr) Tcl_Free((char *) tablePtr->activeTagPtr);
-    if (tablePtr->activeBuf != NULL) Tcl_Free(tablePtr->activeBuf);
+    return TableScreenPos(tablePtr, row, col, &r, &c)
+	&& r < tablePtr->drawRows && c < tablePtr->drawCols
+	&& tablePtr->drawnStamps[r * tablePtr->drawCols + c] == tablePtr->drawStamp;
+}
 
-    /*
-     * Delete the various hash tables, make sure to clear the STRING_KEYS
-     * tables that allocate their strings:
-     *   cache, spanTbl (spanAffTbl shares spanTbl info)
-     */
-    Table_ClearHashTable(tablePtr->cache);
-    Tcl_Free((char *) (tablePtr->cache));
-    Tcl_DeleteHashTable(tablePtr->rowStyles);
-    Tcl_Free((char *) (tablePtr->rowStyles));
-    Tcl_DeleteHashTable(tablePtr->colStyles);
-    Tcl_Free((char *) (tablePtr->colStyles));
-    Tcl_DeleteHashTable(tablePtr->cellStyles);
-    Tcl_Free((char *) (tablePtr->cellStyles));
-    Tcl_DeleteHashTable(tablePtr->flashCells);
-    Tcl_Free((char *) (tablePtr->flashCells));
-    Tcl_DeleteHashTable(tablePtr->selCells);
-    Tcl_Free((char *) (tablePtr->selCells));
-    Tcl_DeleteHashTable(tablePtr->colWidths);
-    Tcl_Free((char *) (tablePtr->colWidths));
-    Tcl_DeleteHashTable(tablePtr->rowHeights);
-    Tcl_Free((char *) (tablePtr->rowHeights));
-#ifdef PROCS
-    Tcl_DeleteHashTable(tablePtr->inProc);
-    Tcl_Free((char *) (tablePtr->inProc));
-#endif
-    if (tablePtr->spanTbl) {
-	Table_ClearHashTable(tablePtr->spanTbl);
-	Tcl_Free((char *) (tablePtr->spanTbl));
-	Tcl_DeleteHashTable(tablePtr->spanAffTbl);
-	Tcl_Free((char *) (tablePtr->spanAffTbl));
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableMarkDrawn --
+ *	Records that the current TableDisplay pass drew a cell, which
+ *	covers rs more rows and cs more cols if it is a span.
+ *	row and col are in real coords.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Updates drawnStamps.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableMarkDrawn(Table *tablePtr, int row, int col, int rs, int cs) {
+    int i, j, r, c, firstRow, firstCol, lastRow, lastCol;
+
+    firstRow = row;
+    firstCol = col;
+    lastRow = MIN(tablePtr->rows-1, row + MAX(0, rs));
+    lastCol = MIN(tablePtr->cols-1, col + MAX(0, cs));
+    if (lastRow > row || lastCol > col) {
+	/* only the part of a span in view has screen positions */
+	if (row >= tablePtr->titleRows) firstRow = MAX(row, tablePtr->topRow);
+	if (col >= tablePtr->titleCols) firstCol = MAX(col, tablePtr->leftCol);
+	tablePtr->flags |= AVOID_SPANS;
+	TableGetLastCell(tablePtr, &r, &c);
+	tablePtr->flags &= ~AVOID_SPANS;
+	lastRow = MIN(lastRow, r);
+	lastCol = MIN(lastCol, c);
     }
-
-    /* Now free up all the tag information */
-    for (entryPtr = Tcl_FirstHashEntry(tablePtr->tagTable, &search);
-	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
-	TableCleanupTag(tablePtr, (TableTag *) Tcl_GetHashValue(entryPtr));
-	Tcl_Free((char *) Tcl_GetHashValue(entryPtr));
+    for (i = firstRow; i <= lastRow; i++) {
+	for (j = firstCol; j <= lastCol; j++) {
+	    if (TableScreenPos(tablePtr, i, j, &r, &c)) {
+		TableGrowDrawSlots(tablePtr, r, c);
+		tablePtr->drawnStamps[r * tablePtr->drawCols + c] = tablePtr->drawStamp;
+	    }
+	}
     }
-    /* free up the stuff in the default tag */
-    TableCleanupTag(tablePtr, &(tablePtr->defaultTag));
-    /* And delete the actual hash table */
-    Tcl_DeleteHashTable(tablePtr->tagTable);
-    Tcl_Free((char *) (tablePtr->tagTable));
-    Tcl_Free((char *) (tablePtr->tagPrios));
-    Tcl_Free((char *) (tablePtr->tagPrioNames));
+}
 
-    /* Now free up all the embedded window info */
-    for (entryPtr = Tcl_FirstHashEntry(tablePtr->winTable, &search);
-	entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
-	EmbWinDelete(tablePtr, (TableEmbWindow *) Tcl_GetHashValue(entryPtr));
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetColTag --
+ *	Returns the col tag of a cell, looked up once per screen col
+ *	position and TableDisplay pass.  col is in real coords.
+ *
+ * Results:
+ *	The tag as from FindRowColTag.
+ *
+ * Side effects:
+ *	May update colTagCache.
+ *
+ *----------------------------------------------------------------------
+ */
+static TableTag *TableGetColTag(Table *tablePtr, int col) {
+    int c;
+
+    if (col < 0 || (col >= tablePtr->titleCols && col < tablePtr->leftCol)) {
+	return FindRowColTag(tablePtr, col+tablePtr->colOffset, COL);
     }
-    /* And delete the actual hash table */
-    Tcl_DeleteHashTable(tablePtr->winTable);
-    Tcl_Free((char *) (tablePtr->winTable));
+    c = (col < tablePtr->titleCols) ? col : tablePtr->titleCols + col - tablePtr->leftCol;
+    TableGrowDrawSlots(tablePtr, 0, c);
+    if (tablePtr->colTagStamps[c] != tablePtr->drawStamp) {
+	tablePtr->colTagCache[c]  = FindRowColTag(tablePtr, col+tablePtr->colOffset, COL);
+	tablePtr->colTagStamps[c] = tablePtr->drawStamp;
+    }
+    return tablePtr->colTagCache[c];
+}
 
-    /* free the configuration options in the widget */
-    Tk_FreeOptions(tableSpecs, (char *) tablePtr, tablePtr->display, 0);
+/*
+ * The fills and border segments the fast and single drawmodes collect
+ * for one GC during a TableDisplay pass, see TableFlushBatches.
+ */
+typedef struct TableBatch {
+    GC gc;
+    XRectangle *rects;		/* deferred fills */
+    int numRects, rectSpace;
+    XSegment *segs;		/* deferred border lines */
+    int numSegs, segSpace;
+} TableBatch;
 
-    /* Free selection */
-    if (tablePtr->haveSelection) {
-	Tcl_DStringFree(&tablePtr->selection);
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetBatch --
+ *	Returns the batch collecting primitives for gc, creating it
+ *	if needed.  A pass uses only a handful of GCs.
+ *
+ * Results:
+ *	The batch, owned by the table.
+ *
+ * Side effects:
+ *	May grow the batches array.
+ *
+ *----------------------------------------------------------------------
+ */
+static TableBatch *TableGetBatch(Table *tablePtr, GC gc) {
+    TableBatch *batchPtr;
+    int i;
+
+    for (i = 0; i < tablePtr->numBatches; i++) {
+	if (tablePtr->batches[i].gc == gc) {
+	    return &(tablePtr->batches[i]);
+	}
+    }
+    if (tablePtr->numBatches == tablePtr->batchSpace) {
+	tablePtr->batchSpace = MAX(8, 2 * tablePtr->batchSpace);
+	tablePtr->batches = (TableBatch *) Tcl_Realloc((char *) tablePtr->batches,
+		tablePtr->batchSpace * sizeof(TableBatch));
+	memset((void *) (tablePtr->batches + tablePtr->numBatches), 0,
+		(tablePtr->batchSpace - tablePtr->numBatches) * sizeof(TableBatch));
     }
+    batchPtr = &(tablePtr->batches[tablePtr->numBatches++]);
+    batchPtr->gc = gc;
+    return batchPtr;
+}
 
-    /* and free the widget memory at last! */
-    Tcl_Free((char *) (tablePtr));
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableBatchFill --
+ *	Defers filling a rectangle with gc until TableFlushBatches.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May grow the batch.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableBatchFill(Table *tablePtr, GC gc, int x, int y, int width, int height) {
+    TableBatch *batchPtr = TableGetBatch(tablePtr, gc);
+    XRectangle *rectPtr;
+
+    if (width <= 0 || height <= 0) {
+	return;
+    }
+    if (batchPtr->numRects == batchPtr->rectSpace) {
+	batchPtr->rectSpace = MAX(32, 2 * batchPtr->rectSpace);
+	batchPtr->rects = (XRectangle *) Tcl_Realloc((char *) batchPtr->rects,
+		batchPtr->rectSpace * sizeof(XRectangle));
+    }
+    rectPtr = &(batchPtr->rects[batchPtr->numRects++]);
+    rectPtr->x	    = x;
+    rectPtr->y	    = y;
+    rectPtr->width  = width;
+    rectPtr->height = height;
 }
 
 /*
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  *
- * TableEventProc --
- *	This procedure is invoked by the Tk dispatcher for various
- *	events on tables.
+ * TableBatchLine --
+ *	Defers drawing a one pixel wide horizontal or vertical line with
+ *	gc until TableFlushBatches.  Both end points are drawn, and
+ *	x1 <= x2, y1 <= y2 is assumed.
  *
  * Results:
- *	None
+ *	None.
  *
  * Side effects:
- *	When the window gets deleted, internal structures get
- *	cleaned up.  When it gets exposed, it is redisplayed.
+ *	May grow the batch.
  *
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  */
-static void TableEventProc(
-    ClientData clientData,	/* Information about window. */
-    XEvent *eventPtr) {		/* Information about event. */
+static void TableBatchLine(Table *tablePtr, GC gc, int x1, int y1, int x2, int y2) {
+    TableBatch *batchPtr = TableGetBatch(tablePtr, gc);
+    XSegment *segPtr;
 
-    Table *tablePtr = (Table *) clientData;
-    int row, col;
+    if (x1 > x2 || y1 > y2) {
+	return;
+    }
+    if (batchPtr->numSegs == batchPtr->segSpace) {
+	batchPtr->segSpace = MAX(64, 2 * batchPtr->segSpace);
+	batchPtr->segs = (XSegment *) Tcl_Realloc((char *) batchPtr->segs,
+		batchPtr->segSpace * sizeof(XSegment));
+    }
+    segPtr = &(batchPtr->segs[batchPtr->numSegs++]);
+    segPtr->x1 = x1;
+    segPtr->y1 = y1;
+    segPtr->x2 = x2;
+    segPtr->y2 = y2;
+}
 
-    switch (eventPtr->type) {
-	case MotionNotify:
-	    if (!(tablePtr->resize & SEL_NONE) && (tablePtr->bdcursor != NULL) &&
-		TableAtBorder(tablePtr, eventPtr->xmotion.x, eventPtr->xmotion.y, &row, &col) &&
-		((row>=0 && (tablePtr->resize & SEL_ROW)) || (col>=0 && (tablePtr->resize & SEL_COL)))) {
-		/*
-		 * The bordercursor is defined and we meet the criteria for
-		 * being over a border.  Set the cursor to border if not
-		 * already done.
-		 */
-		if (!(tablePtr->flags & OVER_BORDER)) {
-		    tablePtr->flags |= OVER_BORDER;
-		    Tk_DefineCursor(tablePtr->tkwin, tablePtr->bdcursor);
-		}
-	    } else if (tablePtr->flags & OVER_BORDER) {
-		tablePtr->flags &= ~OVER_BORDER;
-		if (tablePtr->cursor != NULL) {
-		    Tk_DefineCursor(tablePtr->tkwin, tablePtr->cursor);
-		} else {
-		    Tk_UndefineCursor(tablePtr->tkwin);
-		}
-#ifdef TITLE_CURSOR
-	    } else if (tablePtr->flags & (OVER_BORDER|OVER_TITLE)) {
-		Tk_Cursor cursor = tablePtr->cursor;
+/*
+ * qsort comparison of XSegments: vertical lines before horizontal ones,
+ * each ordered along the line they lie on and then by start.
+ */
+static int TableCompareSegs(const void *a, const void *b) {
+    const XSegment *s1 = (const XSegment *) a, *s2 = (const XSegment *) b;
+    int v1 = (s1->x1 == s1->x2), v2 = (s2->x1 == s2->x2);
 
-		//tablePtr->flags &= ~(OVER_BORDER|OVER_TITLE);
+    if (v1 != v2) {
+	return v2 - v1;
+    }
+    if (v1) {
+	return (s1->x1 != s2->x1) ? s1->x1 - s2->x1 : s1->y1 - s2->y1;
+    }
+    return (s1->y1 != s2->y1) ? s1->y1 - s2->y1 : s1->x1 - s2->x1;
+}
 
-		if (tablePtr->titleCursor != NULL) {
-		    TableWhatCell(tablePtr, eventPtr->xmotion.x, eventPtr->xmotion.y, &row, &col);
-		    if ((row < tablePtr->titleRows) || (col < tablePtr->titleCols)) {
-			if (tablePtr->flags & OVER_TITLE) {
-			    break;
-			}
-			tablePtr->flags |= OVER_TITLE;
-			cursor = tablePtr->titleCursor;
-		    }
-		}
-		if (cursor != NULL) {
-		    Tk_DefineCursor(tablePtr->tkwin, cursor);
-		} else {
-		    Tk_UndefineCursor(tablePtr->tkwin);
-		}
-	    } else if (tablePtr->titleCursor != NULL) {
-		Tk_Cursor cursor = tablePtr->cursor;
-
-		TableWhatCell(tablePtr, eventPtr->xmotion.x, eventPtr->xmotion.y, &row, &col);
-		if ((row < tablePtr->titleRows) || (col < tablePtr->titleCols)) {
-		    if (tablePtr->flags & OVER_TITLE) {
-			break;
-		    }
-		    tablePtr->flags |= OVER_TITLE;
-		    cursor = tablePtr->titleCursor;
-		}
-#endif
-	    }
-	    break;
-
-	case Expose:
-	    TableInvalidate(tablePtr, eventPtr->xexpose.x, eventPtr->xexpose.y,
-		    eventPtr->xexpose.width, eventPtr->xexpose.height, INV_HIGHLIGHT);
-	    break;
-
-	case DestroyNotify:
-	    /* remove the command from the interpreter */
-	    if (tablePtr->tkwin != NULL) {
-		tablePtr->tkwin = NULL;
-		Tcl_DeleteCommandFromToken(tablePtr->interp, tablePtr->widgetCmd);
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFlushBatches --
+ *	Draws the deferred fills of all batches, then their border
+ *	lines.  Lines of one GC that continue each other, as the grid
+ *	lines of neighbouring cells do, are joined first, so a uniform
+ *	grid takes one segment per visible row and col boundary.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Draws into d and empties the batches (keeping their storage).
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableFlushBatches(Table *tablePtr, Drawable d) {
+    Display *display = tablePtr->display;
+    TableBatch *batchPtr;
+    XSegment *segs;
+    int i, j, n;
+
+    for (i = 0; i < tablePtr->numBatches; i++) {
+	batchPtr = &(tablePtr->batches[i]);
+	if (batchPtr->numRects) {
+	    XFillRectangles(display, d, batchPtr->gc, batchPtr->rects,
+		    batchPtr->numRects);
+	    batchPtr->numRects = 0;
+	}
+    }
+    for (i = 0; i < tablePtr->numBatches; i++) {
+	batchPtr = &(tablePtr->batches[i]);
+	if (batchPtr->numSegs == 0) {
+	    continue;
+	}
+	segs = batchPtr->segs;
+	qsort((void *) segs, (size_t) batchPtr->numSegs, sizeof(XSegment),
+		TableCompareSegs);
+	for (n = 0, j = 1; j < batchPtr->numSegs; j++) {
+	    if (segs[n].x1 == segs[n].x2 && segs[j].x1 == segs[j].x2
+		    && segs[j].x1 == segs[n].x1 && segs[j].y1 <= segs[n].y2 + 1) {
+		segs[n].y2 = MAX(segs[n].y2, segs[j].y2);
+	    } else if (segs[n].y1 == segs[n].y2 && segs[j].y1 == segs[j].y2
+		    && segs[n].x1 != segs[n].x2 && segs[j].x1 != segs[j].x2
+		    && segs[j].y1 == segs[n].y1 && segs[j].x1 <= segs[n].x2 + 1) {
+		segs[n].x2 = MAX(segs[n].x2, segs[j].x2);
+	    } else {
+		segs[++n] = segs[j];
 	    }
+	}
+	XDrawSegments(display, d, batchPtr->gc, segs, n + 1);
+	batchPtr->numSegs = 0;
+    }
+    tablePtr->numBatches = 0;
+}
 
-	    /* cancel any pending update or timer */
-	    if (tablePtr->flags & REDRAW_PENDING) {
-		Tcl_CancelIdleCall(TableDisplay, (ClientData) tablePtr);
-		tablePtr->flags &= ~REDRAW_PENDING;
-	    }
-	    Tcl_DeleteTimerHandler(tablePtr->cursorTimer);
-	    Tcl_DeleteTimerHandler(tablePtr->flashTimer);
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFreeBatches --
+ *	Frees the storage of all batches.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableFreeBatches(Table *tablePtr) {
+    int i;
 
-	    Tcl_EventuallyFree((ClientData) tablePtr, (Tcl_FreeProc *) TableDestroy);
-	    break;
+    for (i = 0; i < tablePtr->batchSpace; i++) {
+	if (tablePtr->batches[i].rects) Tcl_Free((char *) tablePtr->batches[i].rects);
+	if (tablePtr->batches[i].segs) Tcl_Free((char *) tablePtr->batches[i].segs);
+    }
+    if (tablePtr->batches) Tcl_Free((char *) tablePtr->batches);
+    tablePtr->batches = NULL;
+    tablePtr->numBatches = tablePtr->batchSpace = 0;
+}
 
-	case MapNotify: /* redraw table when remapped if it changed */
-	    if (tablePtr->flags & REDRAW_ON_MAP) {
-		tablePtr->flags &= ~REDRAW_ON_MAP;
-		Tcl_Preserve((ClientData) tablePtr);
-		TableAdjustParams(tablePtr);
-		TableInvalidateAll(tablePtr, INV_HIGHLIGHT);
-		Tcl_Release((ClientData) tablePtr);
-	    }
-	    break;
+/*
+ * The signature of a cell as it was last drawn into the backing pixmap,
+ * kept per screen cell position.  A cell that is to be drawn there again
+ * with the same geometry, merged style and value is already in place.
+ */
+typedef struct TableCellSig {
+    int valid;			/* whether backPixmap holds the cell */
+    int x, y, width, height;	/* where it was drawn */
+    TableTag tag;		/* the merged style it was drawn with */
+    char *value;		/* copy of the value it showed */
+    size_t valueSpace;		/* bytes allocated for value */
+} TableCellSig;
 
-	case ConfigureNotify:
-	    Tcl_Preserve((ClientData) tablePtr);
-	    TableAdjustParams(tablePtr);
-	    TableInvalidateAll(tablePtr, INV_HIGHLIGHT);
-	    Tcl_Release((ClientData) tablePtr);
-	    break;
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFreeCellSigs --
+ *	Releases the cell signatures of the backing pixmap.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	All cells of the next redisplay are drawn.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableFreeCellSigs(Table *tablePtr) {
+    int i;
 
-	case FocusIn:
-	case FocusOut:
-	    if (eventPtr->xfocus.detail != NotifyInferior) {
-		tablePtr->flags |= REDRAW_BORDER;
-		if (eventPtr->type == FocusOut) {
-		    tablePtr->flags &= ~HAS_FOCUS;
-		} else {
-		    tablePtr->flags |= HAS_FOCUS;
-		}
-		TableRedrawHighlight(tablePtr);
-		/* cancel the timer */
-		TableConfigCursor(tablePtr);
+    if (tablePtr->cellSigs != NULL) {
+	for (i = 0; i < tablePtr->sigRows * tablePtr->sigCols; i++) {
+	    if (tablePtr->cellSigs[i].value != NULL) {
+		Tcl_Free(tablePtr->cellSigs[i].value);
 	    }
-	    break;
+	}
+	Tcl_Free((char *) tablePtr->cellSigs);
+	tablePtr->cellSigs = NULL;
     }
+    tablePtr->sigRows = tablePtr->sigCols = 0;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * TableCmdDeletedProc --
- *
- *	This procedure is invoked when a widget command is deleted.  If
- *	the widget isn't already in the process of being destroyed,
- *	this command destroys it.
+ * TableFlushCellSigs --
+ *	Forgets how the cells were drawn into the backing pixmap.
+ *	This must be called whenever its pixels are changed other than
+ *	by drawing cells, or the fonts and colors the signatures refer
+ *	to may have been freed.
  *
  * Results:
  *	None
  *
  * Side effects:
- *	The widget is destroyed.
+ *	All cells of the next redisplay are drawn.
  *
  *----------------------------------------------------------------------
  */
-static void TableCmdDeletedProc(ClientData clientData) {
-    Table *tablePtr = (Table *) clientData;
-    Tk_Window tkwin;
+static void TableFlushCellSigs(Table *tablePtr) {
+    int i;
 
-    /*
-     * This procedure could be invoked either because the window was
-     * destroyed and the command was then deleted (in which case tkwin
-     * is NULL) or because the command was deleted, and then this procedure
-     * destroys the widget.
-     */
+    for (i = 0; i < tablePtr->sigRows * tablePtr->sigCols; i++) {
+	tablePtr->cellSigs[i].valid = 0;
+    }
+}
 
-    if (tablePtr->tkwin != NULL) {
-	tkwin = tablePtr->tkwin;
-	tablePtr->tkwin = NULL;
-	Tk_DestroyWindow(tkwin);
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetCellSig --
+ *	Returns the signature slot for the screen position of a cell,
+ *	growing the slots as needed.  row and col are in real coords.
+ *
+ * Results:
+ *	The slot, or NULL if the cell is scrolled out of view.
+ *
+ * Side effects:
+ *	May reallocate cellSigs.
+ *
+ *----------------------------------------------------------------------
+ */
+static TableCellSig *TableGetCellSig(Table *tablePtr, int row, int col) {
+    TableCellSig *sigs;
+    int r, c, i, numRows, numCols;
+
+    if (!TableScreenPos(tablePtr, row, col, &r, &c)) {
+	return NULL;
     }
+    if (r >= tablePtr->sigRows || c >= tablePtr->sigCols) {
+	numRows = (r < tablePtr->sigRows) ? tablePtr->sigRows : MAX(r+1, 2*tablePtr->sigRows);
+	numCols = (c < tablePtr->sigCols) ? tablePtr->sigCols : MAX(c+1, 2*tablePtr->sigCols);
+	sigs = (TableCellSig *) Tcl_Alloc(numRows * numCols * sizeof(TableCellSig));
+	memset((void *) sigs, 0, numRows * numCols * sizeof(TableCellSig));
+	for (i = 0; i < tablePtr->sigRows; i++) {
+	    memcpy((void *) (sigs + i * numCols),
+		    (void *) (tablePtr->cellSigs + i * tablePtr->sigCols),
+		    tablePtr->sigCols * sizeof(TableCellSig));
+	}
+	if (tablePtr->cellSigs != NULL) {
+	    Tcl_Free((char *) tablePtr->cellSigs);
+	}
+	tablePtr->cellSigs = sigs;
+	tablePtr->sigRows = numRows;
+	tablePtr->sigCols = numCols;
+    }
+    return tablePtr->cellSigs + r * tablePtr->sigCols + c;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * TableFetchSelection --
- *	This procedure is called back by Tk when the selection is
- *	requested by someone.  It returns part or all of the selection
- *	in a buffer provided by the caller.
+ * TableCheckCellSig --
+ *	Compares a cell about to be drawn with its signature slot.
+ *	If it differs, the slot is set to the new cell, but stays
+ *	invalid until the caller has drawn it.
  *
  * Results:
- *	The return value is the number of non-NULL bytes stored
- *	at buffer.  Buffer is filled (or partially filled) with a
- *	NULL-terminated string containing part or all of the selection,
- *	as given by offset and maxBytes.
+ *	1 if the backing pixmap already holds the cell, 0 otherwise.
  *
  * Side effects:
+ *	May update the slot.
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableCheckCellSig(TableCellSig *sigPtr, int x, int y, int width, int height,
+	TableTag *tagPtr, const char *string, size_t len) {
+
+    if (sigPtr->valid && sigPtr->x == x && sigPtr->y == y
+	    && sigPtr->width == width && sigPtr->height == height
+	    && memcmp((void *) &(sigPtr->tag), (void *) tagPtr, sizeof(TableTag)) == 0
+	    && strcmp(sigPtr->value, string) == 0) {
+	return 1;
+    }
+    sigPtr->valid	= 0;
+    sigPtr->x		= x;
+    sigPtr->y		= y;
+    sigPtr->width	= width;
+    sigPtr->height	= height;
+    memcpy((void *) &(sigPtr->tag), (void *) tagPtr, sizeof(TableTag));
+    if (len >= sigPtr->valueSpace) {
+	if (sigPtr->value != NULL) {
+	    Tcl_Free(sigPtr->value);
+	}
+	sigPtr->valueSpace = len + 1;
+	sigPtr->value = (char *) Tcl_Alloc(sigPtr->valueSpace);
+    }
+    memcpy(sigPtr->value, string, len + 1);
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFreeBackPixmap --
+ *	Releases the backing pixmap, if any.
+ *
+ * Results:
  *	None
  *
+ * Side effects:
+ *	The next redisplay draws the whole window again.
+ *
  *----------------------------------------------------------------------
  */
+static void TableFreeBackPixmap(Table *tablePtr) {
+    if (tablePtr->backPixmap != None) {
+	Tk_FreePixmap(tablePtr->display, tablePtr->backPixmap);
+	tablePtr->backPixmap = None;
+    }
+    TableFreeCellSigs(tablePtr);
+}
 
-static Tcl_Size TableFetchSelection(
-     ClientData clientData,	/* Information about table widget. */
-     Tcl_Size offset,		/* Offset within selection of first character to be returned. */
-     char *buffer,		/* Location in which to place selection. */
-     Tcl_Size maxBytes) {	/* Maximum number of bytes to place at buffer, not including
-				 * terminating NULL. */
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableExposeBackPixmap --
+ *	Repairs an exposed area straight from the backing pixmap,
+ *	without drawing any cell.  Parts of the area that still have
+ *	to be redrawn are covered by the pending redisplay.
+ *
+ * Results:
+ *	1 if the area was repaired, 0 if it has to be redrawn.
+ *
+ * Side effects:
+ *	Copies to the window and may redraw the highlight.
+ *
+ *----------------------------------------------------------------------
+ */
+#ifndef _WIN32
+static int TableExposeBackPixmap(Table *tablePtr, XExposeEvent *exposePtr) {
+    Tk_Window tkwin = tablePtr->tkwin;
+    int hl = tablePtr->highlightWidth;
+    int x0, y0, x1, y1;
 
-    Table *tablePtr = (Table *) clientData;
-    Tcl_Interp *interp = tablePtr->interp;
-    char *value, *data, *rowsep = tablePtr->rowSep, *colsep = tablePtr->colSep;
+    if ((tablePtr->backPixmap == None)
+	    || (tablePtr->backWidth != Tk_Width(tkwin))
+	    || (tablePtr->backHeight != Tk_Height(tkwin))) {
+	return 0;
+    }
+
+    /* the highlight ring is never kept in the pixmap */
+    x0 = MAX(hl, exposePtr->x);
+    y0 = MAX(hl, exposePtr->y);
+    x1 = MIN(Tk_Width(tkwin) - hl, exposePtr->x + exposePtr->width);
+    y1 = MIN(Tk_Height(tkwin) - hl, exposePtr->y + exposePtr->height);
+    if (x0 < x1 && y0 < y1) {
+	XCopyArea(tablePtr->display, tablePtr->backPixmap, Tk_WindowId(tkwin),
+		Tk_3DBorderGC(tkwin, tablePtr->defaultTag.bg, TK_3D_FLAT_GC),
+		x0, y0, (unsigned) (x1 - x0), (unsigned) (y1 - y0), x0, y0);
+    }
+    if (x0 != exposePtr->x || y0 != exposePtr->y
+	    || x1 != exposePtr->x + exposePtr->width
+	    || y1 != exposePtr->y + exposePtr->height) {
+	tablePtr->flags |= REDRAW_BORDER;
+	TableRedrawHighlight(tablePtr);
+    }
+    return 1;
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableDestroy --
+ *	This procedure is invoked by Tcl_EventuallyFree
+ *	to clean up the internal structure of a table at a safe time
+ *	(when no-one is using it anymore).
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Everything associated with the table is freed up (hopefully).
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableDestroy(ClientData clientdata) {
+    Table *tablePtr = (Table *) clientdata;
     Tcl_HashEntry *entryPtr;
     Tcl_HashSearch search;
-    int lastrow=0, needcs=0, r, c, rslen=0, cslen=0;
-    Tcl_Size count, length, listArgc;
-    int numcols, numrows, code;
-    const char **listArgv;
 
-    /* if we are not exporting the selection ||
-     * we have no data source, return */
-    if (!tablePtr->exportSelection ||
-	(tablePtr->dataSource == DATA_NONE)) {
-	return -1;
+    /* These may be repetitive from DestroyNotify, but it doesn't hurt */
+    /* cancel any pending update or timer */
+    TableCancelRedraw(tablePtr);
+    Tcl_DeleteTimerHandler(tablePtr->cursorTimer);
+    Tcl_DeleteTimerHandler(tablePtr->flashTimer);
+    TableFreeBackPixmap(tablePtr);
+    if (tablePtr->clipPixmap != None) {
+	Tk_FreePixmap(tablePtr->display, tablePtr->clipPixmap);
+	tablePtr->clipPixmap = None;
+    }
+    if (tablePtr->cellPixmap != None) {
+	Tk_FreePixmap(tablePtr->display, tablePtr->cellPixmap);
+	tablePtr->cellPixmap = None;
+    }
+    if (tablePtr->cursorSave != None) {
+	Tk_FreePixmap(tablePtr->display, tablePtr->cursorSave);
+	tablePtr->cursorSave = None;
     }
 
-    if ((offset == 0) || !tablePtr->haveSelection) {
-	/* First Time through, get the selection, otherwise, just use the
-	 * selection obtained before */
+    /* delete the variable trace */
+    if (tablePtr->arrayVar != NULL) {
+	Tcl_UntraceVar(tablePtr->interp, tablePtr->arrayVar,
+		TCL_TRACE_WRITES | TCL_TRACE_UNSETS | TCL_GLOBAL_ONLY,
+		TableVarProc, (ClientData) tablePtr);
+    }
 
-	/* If we have fetched a selection before, free it */
-	if (tablePtr->haveSelection) {
-	    Tcl_DStringFree(&tablePtr->selection);
-	    tablePtr->haveSelection = 0;
-	}
+    /* free the int arrays */
+    if (tablePtr->colPixels) Tcl_Free((char *) tablePtr->colPixels);
+    if (tablePtr->rowPixels) Tcl_Free((char *) tablePtr->rowPixels);
+    if (tablePtr->colStarts) Tcl_Free((char *) tablePtr->colStarts);
+    if (tablePtr->rowStarts) Tcl_Free((char *) tablePtr->rowStarts);
+    if (tablePtr->drawnStamps) Tcl_Free((char *) tablePtr->drawnStamps);
+    if (tablePtr->colTagCache) Tcl_Free((char *) tablePtr->colTagCache);
+    if (tablePtr->colTagStamps) Tcl_Free((char *) tablePtr->colTagStamps);
+    TableFreeBatches(tablePtr);
 
-	/* First get a sorted list of the selected elements */
-	Tcl_DStringInit(&tablePtr->selection);
-	for (entryPtr = Tcl_FirstHashEntry(tablePtr->selCells, &search);
-	     entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
-	    Tcl_DStringAppendElement(&tablePtr->selection,
-		    Tcl_GetHashKey(tablePtr->selCells, entryPtr));
-	}
-	value = TableCellSort(tablePtr, Tcl_DStringValue(&tablePtr->selection));
-	Tcl_DStringFree(&tablePtr->selection);
-
-	/* Abort if no data or conversion to list fails */
-	if (value == NULL) {
-	    return -1;
-	}
-	if (Tcl_SplitList(interp, value, &listArgc, &listArgv) != TCL_OK) {
-	    Tcl_Free(value);
-	    return -1;
-	}
-	Tcl_Free(value);
-
-	/* Add elements to selection */
-	Tcl_DStringInit(&tablePtr->selection);
-	tablePtr->haveSelection = 1;
-	rslen = (rowsep?((int) strlen(rowsep)):0);
-	cslen = (colsep?((int) strlen(colsep)):0);
-	numrows = numcols = 0;
-	for (count = 0; count < listArgc; count++) {
-	    TableParseArrayIndex(&r, &c, listArgv[count]);
-	    if (count) {
-		if (lastrow != r) {
-		    lastrow = r;
-		    needcs = 0;
-		    if (rslen) {
-			Tcl_DStringAppend(&tablePtr->selection, rowsep, (Tcl_Size)rslen);
-		    } else {
-			Tcl_DStringEndSublist(&tablePtr->selection);
-			Tcl_DStringStartSublist(&tablePtr->selection);
-		    }
-		    ++numrows;
-		} else {
-		    if (++needcs > numcols)
-			numcols = needcs;
-		}
-	    } else {
-		lastrow = r;
-		needcs = 0;
-		if (!rslen) {
-		    Tcl_DStringStartSublist(&tablePtr->selection);
-		}
-	    }
-	    data = TableGetCellValue(tablePtr, r, c);
-	    if (cslen) {
-		if (needcs) {
-		    Tcl_DStringAppend(&tablePtr->selection, colsep, (Tcl_Size)cslen);
-		}
-		Tcl_DStringAppend(&tablePtr->selection, data, -1);
-	    } else {
-		Tcl_DStringAppendElement(&tablePtr->selection, data);
-	    }
-	}
-	if (!rslen && count) {
-	    Tcl_DStringEndSublist(&tablePtr->selection);
-	}
-	Tcl_Free((char *) listArgv);
+    /* delete cached active tag and string */
+    if (tablePtr->activeTagPtr) Tcl_Free((char *) tablePtr->activeTagPtr);
+    if (tablePtr->activeBuf != NULL) Tcl_Free(tablePtr->activeBuf);
 
-	if (tablePtr->selCmd != NULL) {
-	    Tcl_DString script;
-	    Tcl_DStringInit(&script);
-	    ExpandPercents(tablePtr, tablePtr->selCmd, numrows+1, numcols+1,
-		    Tcl_DStringValue(&tablePtr->selection), (char *)NULL,
-		    listArgc, &script, CMD_ACTIVATE);
-	    if ((code = Tcl_EvalEx(interp, Tcl_DStringValue(&script), -1, TCL_EVAL_GLOBAL)) == TCL_ERROR) {
-		Tcl_AddErrorInfo(interp, "\n    (error in table selection command)");
-		Tcl_BackgroundException(interp, code);
-		Tcl_DStringFree(&script);
-		Tcl_DStringFree(&tablePtr->selection);
-		tablePtr->haveSelection = 0;
-		return -1;
-	    } else {
-		Tcl_DStringGetResult(interp, &tablePtr->selection);
-	    }
-	    Tcl_DStringFree(&script);
-	}
+    /*
+     * Delete the various hash tables, make sure to clear the STRING_KEYS
+     * tables that allocate their strings:
+     *   cache, spanTbl (spanAffTbl shares spanTbl info)
+     */
+    TableClearValueCache(tablePtr->cache);
+    Tcl_Free((char *) (tablePtr->cache));
+    Tcl_DeleteHashTable(tablePtr->rowStyles);
+    Tcl_Free((char *) (tablePtr->rowStyles));
+    Tcl_DeleteHashTable(tablePtr->colStyles);
+    Tcl_Free((char *) (tablePtr->colStyles));
+    Tcl_DeleteHashTable(tablePtr->cellStyles);
+    Tcl_Free((char *) (tablePtr->cellStyles));
+    TableClearFlashes(tablePtr);
+    Tcl_DeleteHashTable(tablePtr->flashCells);
+    Tcl_Free((char *) (tablePtr->flashCells));
+    Tcl_DeleteHashTable(tablePtr->selCells);
+    Tcl_Free((char *) (tablePtr->selCells));
+    Tcl_DeleteHashTable(tablePtr->measureCache);
+    Tcl_Free((char *) (tablePtr->measureCache));
+    TableFlushLayoutCache(tablePtr);
+    Tcl_DeleteHashTable(tablePtr->layoutCache);
+    Tcl_Free((char *) (tablePtr->layoutCache));
+    Tcl_DeleteHashTable(tablePtr->fitCache);
+    Tcl_Free((char *) (tablePtr->fitCache));
+    TableFlushStyleCache(tablePtr);
+    Tcl_DeleteHashTable(tablePtr->styleCache);
+    Tcl_Free((char *) (tablePtr->styleCache));
+    TableFlushGcCache(tablePtr);
+    Tcl_DeleteHashTable(tablePtr->gcCache);
+    Tcl_Free((char *) (tablePtr->gcCache));
+    Tcl_DeleteHashTable(tablePtr->colWidths);
+    Tcl_Free((char *) (tablePtr->colWidths));
+    Tcl_DeleteHashTable(tablePtr->rowHeights);
+    Tcl_Free((char *) (tablePtr->rowHeights));
+    TableFilterClear(tablePtr);
+    TableSetPerm(tablePtr, ROW, NULL, 0);
+    TableSetPerm(tablePtr, COL, NULL, 0);
+#ifdef PROCS
+    Tcl_DeleteHashTable(tablePtr->inProc);
+    Tcl_Free((char *) (tablePtr->inProc));
+#endif
+    if (tablePtr->spanTbl) {
+	Table_ClearHashTable(tablePtr->spanTbl);
+	Tcl_Free((char *) (tablePtr->spanTbl));
+	Tcl_DeleteHashTable(tablePtr->spanAffTbl);
+	Tcl_Free((char *) (tablePtr->spanAffTbl));
     }
 
-    /* Get selection length */
-    if (tablePtr->haveSelection) {
-	length = Tcl_DStringLength(&tablePtr->selection);
-    } else {
-	length = 0;
+    /* Now free up all the tag information */
+    for (entryPtr = Tcl_FirstHashEntry(tablePtr->tagTable, &search);
+	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	TableCleanupTag(tablePtr, (TableTag *) Tcl_GetHashValue(entryPtr));
+	Tcl_Free((char *) Tcl_GetHashValue(entryPtr));
     }
+    /* free up the stuff in the default tag */
+    TableCleanupTag(tablePtr, &(tablePtr->defaultTag));
+    /* And delete the actual hash table */
+    Tcl_DeleteHashTable(tablePtr->tagTable);
+    Tcl_Free((char *) (tablePtr->tagTable));
+    Tcl_Free((char *) (tablePtr->tagPrios));
+    Tcl_Free((char *) (tablePtr->tagPrioNames));
 
-    /* If no selection, abort */
-    if (length == 0) {
-	if (tablePtr->haveSelection) {
-	    Tcl_DStringFree(&tablePtr->selection);
-	    tablePtr->haveSelection = 0;
-	}
-	return -1;
+    /* Now free up all the embedded window info */
+    for (entryPtr = Tcl_FirstHashEntry(tablePtr->winTable, &search);
+	entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	EmbWinDelete(tablePtr, (TableEmbWindow *) Tcl_GetHashValue(entryPtr));
     }
+    /* And delete the actual hash table */
+    Tcl_DeleteHashTable(tablePtr->winTable);
+    Tcl_Free((char *) (tablePtr->winTable));
 
-    /* Copy the requested portion of the selection to the buffer. */
-    count = length - offset;
-    if (count <= 0) {
-	count = 0;
-    } else {
-	if (count > maxBytes) {
-	    count = maxBytes;
-	}
-	memcpy((void *) buffer,
-	       (void *) (Tcl_DStringValue(&tablePtr->selection) + offset),
-	       (size_t) count);
-    }
-    buffer[count] = '\0';
-    if (count < maxBytes) {
-	/*
-	 * This should be the last call in this range, so free selection now.
-	 */
+    /* free the configuration options in the widget */
+    Tk_FreeOptions(tableSpecs, (char *) tablePtr, tablePtr->display, 0);
+
+    /* Free selection */
+    if (tablePtr->haveSelection) {
 	Tcl_DStringFree(&tablePtr->selection);
-	tablePtr->haveSelection = 0;
     }
-    return count;
+
+    /* and free the widget memory at last! */
+    Tcl_Free((char *) (tablePtr));
 }
 
 /*
  *--------------------------------------------------------------
  *
- * Tk_TableObjCmd --
- *	This procedure is invoked to process the "table" Tcl
- *	command.  See the user documentation for details on what
- *	it does.
+ * TableEventProc --
+ *	This procedure is invoked by the Tk dispatcher for various
+ *	events on tables.
  *
  * Results:
- *	A standard Tcl result.
+ *	None
  *
  * Side effects:
- *	See the user documentation.
+ *	When the window gets deleted, internal structures get
+ *	cleaned up.  When it gets exposed, it is redisplayed.
  *
  *--------------------------------------------------------------
  */
-static int Tk_TableObjCmd(
-    ClientData clientData,	/* Main window associated with interpreter. */
-    Tcl_Interp *interp,
-    int objc,			/* Number of arguments. */
-    Tcl_Obj *const objv[]) {	/* Argument objects. */
-
-    Table *tablePtr;
-    Tk_Window tkwin, mainWin = (Tk_Window) clientData;
-    int offset;
+static void TableEventProc(
+    ClientData clientData,	/* Information about window. */
+    XEvent *eventPtr) {		/* Information about event. */
 
-    if (objc < 2) {
-	Tcl_WrongNumArgs(interp, 1, objv, "pathName ?options?");
-	return TCL_ERROR;
-    }
+    Table *tablePtr = (Table *) clientData;
+    int row, col;
 
-    tkwin = Tk_CreateWindowFromPath(interp, mainWin, Tcl_GetString(objv[1]), (char *)NULL);
-    if (tkwin == NULL) {
-	return TCL_ERROR;
-    }
+    switch (eventPtr->type) {
+	case MotionNotify:
+	    if (!(tablePtr->resize & SEL_NONE) && (tablePtr->bdcursor != NULL) &&
+		TableAtBorder(tablePtr, eventPtr->xmotion.x, eventPtr->xmotion.y, &row, &col) &&
+		((row>=0 && (tablePtr->resize & SEL_ROW)) || (col>=0 && (tablePtr->resize & SEL_COL)))) {
+		/*
+		 * The bordercursor is defined and we meet the criteria for
+		 * being over a border.  Set the cursor to border if not
+		 * already done.
+		 */
+		if (!(tablePtr->flags & OVER_BORDER)) {
+		    tablePtr->flags |= OVER_BORDER;
+		    Tk_DefineCursor(tablePtr->tkwin, tablePtr->bdcursor);
+		}
+	    } else if (tablePtr->flags & OVER_BORDER) {
+		tablePtr->flags &= ~OVER_BORDER;
+		if (tablePtr->cursor != NULL) {
+		    Tk_DefineCursor(tablePtr->tkwin, tablePtr->cursor);
+		} else {
+		    Tk_UndefineCursor(tablePtr->tkwin);
+		}
+#ifdef TITLE_CURSOR
+	    } else if (tablePtr->flags & (OVER_BORDER|OVER_TITLE)) {
+		Tk_Cursor cursor = tablePtr->cursor;
 
-    tablePtr = (Table *) Tcl_Alloc(sizeof(Table));
-    if (tablePtr == NULL) {
-	return TCL_ERROR;
-    }
-    memset((void *) tablePtr, 0, sizeof(Table));
+		//tablePtr->flags &= ~(OVER_BORDER|OVER_TITLE);
 
-    /*
-     * Set the structure elements that aren't 0/NULL by default,
-     * and that won't be set by the initial configure call.
-     */
-    tablePtr->tkwin		= tkwin;
-    tablePtr->display		= Tk_Display(tkwin);
-    tablePtr->interp		= interp;
-    tablePtr->widgetCmd	= Tcl_CreateObjCommand(interp, Tk_PathName(tablePtr->tkwin),
-	TableWidgetObjCmd, (ClientData) tablePtr, (Tcl_CmdDeleteProc *) TableCmdDeletedProc);
+		if (tablePtr->titleCursor != NULL) {
+		    TableWhatCell(tablePtr, eventPtr->xmotion.x, eventPtr->xmotion.y, &row, &col);
+		    if ((row < tablePtr->titleRows) || (col < tablePtr->titleCols)) {
+			if (tablePtr->flags & OVER_TITLE) {
+			    break;
+			}
+			tablePtr->flags |= OVER_TITLE;
+			cursor = tablePtr->titleCursor;
+		    }
+		}
+		if (cursor != NULL) {
+		    Tk_DefineCursor(tablePtr->tkwin, cursor);
+		} else {
+		    Tk_UndefineCursor(tablePtr->tkwin);
+		}
+	    } else if (tablePtr->titleCursor != NULL) {
+		Tk_Cursor cursor = tablePtr->cursor;
 
-    tablePtr->anchorRow		= -1;
-    tablePtr->anchorCol		= -1;
-    tablePtr->activeRow		= -1;
-    tablePtr->activeCol		= -1;
-    tablePtr->oldTopRow		= -1;
-    tablePtr->oldLeftCol	= -1;
-    tablePtr->oldActRow		= -1;
-    tablePtr->oldActCol		= -1;
-    tablePtr->seen[0]		= -1;
-
-    tablePtr->dataSource	= DATA_NONE;
-    tablePtr->activeBuf		= Tcl_Alloc(1);
-    *(tablePtr->activeBuf)	= '\0';
-
-    tablePtr->cursor		= NULL;
-    tablePtr->bdcursor		= NULL;
-
-    tablePtr->defaultTag.justify	= TK_JUSTIFY_LEFT;
-    tablePtr->defaultTag.state		= STATE_UNKNOWN;
-
-    /* misc tables */
-    tablePtr->tagTable	= (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->tagTable, TCL_STRING_KEYS);
-    tablePtr->winTable	= (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->winTable, TCL_STRING_KEYS);
-
-    /* internal value cache */
-    tablePtr->cache	= (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->cache, TCL_STRING_KEYS);
+		TableWhatCell(tablePtr, eventPtr->xmotion.x, eventPtr->xmotion.y, &row, &col);
+		if ((row < tablePtr->titleRows) || (col < tablePtr->titleCols)) {
+		    if (tablePtr->flags & OVER_TITLE) {
+			break;
+		    }
+		    tablePtr->flags |= OVER_TITLE;
+		    cursor = tablePtr->titleCursor;
+		}
+#endif
+	    }
+	    break;
 
-    /* style hash tables */
-    tablePtr->colWidths = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->colWidths, TCL_ONE_WORD_KEYS);
-    tablePtr->rowHeights = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->rowHeights, TCL_ONE_WORD_KEYS);
+	case Expose:
+#ifndef _WIN32
+	    if (TableExposeBackPixmap(tablePtr, &(eventPtr->xexpose))) {
+		break;
+	    }
+#endif
+	    TableInvalidate(tablePtr, eventPtr->xexpose.x, eventPtr->xexpose.y,
+		    eventPtr->xexpose.width, eventPtr->xexpose.height, INV_HIGHLIGHT);
+	    break;
 
-    /* style hash tables */
-    tablePtr->rowStyles = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->rowStyles, TCL_ONE_WORD_KEYS);
-    tablePtr->colStyles = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->colStyles, TCL_ONE_WORD_KEYS);
-    tablePtr->cellStyles = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->cellStyles, TCL_STRING_KEYS);
+	case GraphicsExpose:
+	    /* parts of a scrolling XCopyArea that couldn't be copied */
+	    TableInvalidate(tablePtr, eventPtr->xgraphicsexpose.x,
+		    eventPtr->xgraphicsexpose.y, eventPtr->xgraphicsexpose.width,
+		    eventPtr->xgraphicsexpose.height, 0);
+	    break;
 
-    /* special style hash tables */
-    tablePtr->flashCells = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->flashCells, TCL_STRING_KEYS);
-    tablePtr->selCells = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->selCells, TCL_STRING_KEYS);
+	case DestroyNotify:
+	    /* remove the command from the interpreter */
+	    if (tablePtr->tkwin != NULL) {
+		tablePtr->tkwin = NULL;
+		Tcl_DeleteCommandFromToken(tablePtr->interp, tablePtr->widgetCmd);
+	    }
 
-    /*
-     * List of tags in priority order.  30 is a good default number to alloc.
-     */
-    tablePtr->tagPrioMax = 30;
-    tablePtr->tagPrioNames = (char **) Tcl_Alloc(sizeof(char *) * tablePtr->tagPrioMax);
-    tablePtr->tagPrios = (TableTag **) Tcl_Alloc(sizeof(TableTag *) * tablePtr->tagPrioMax);
-    tablePtr->tagPrioSize = 0;
-    for (offset = 0; offset < tablePtr->tagPrioMax; offset++) {
-	tablePtr->tagPrioNames[offset] = (char *) NULL;
-	tablePtr->tagPrios[offset] = (TableTag *) NULL;
-    }
+	    /* cancel any pending update or timer */
+	    TableCancelRedraw(tablePtr);
+	    if (tablePtr->flags & UPDATE_SCROLLBAR) {
+		Tcl_CancelIdleCall(TableUpdateScrollbars, (ClientData) tablePtr);
+		tablePtr->flags &= ~UPDATE_SCROLLBAR;
+	    }
+	    Tcl_DeleteTimerHandler(tablePtr->cursorTimer);
+	    Tcl_DeleteTimerHandler(tablePtr->flashTimer);
+	    TableFreeBackPixmap(tablePtr);
+	    if (tablePtr->clipPixmap != None) {
+		Tk_FreePixmap(tablePtr->display, tablePtr->clipPixmap);
+		tablePtr->clipPixmap = None;
+	    }
+	    if (tablePtr->cellPixmap != None) {
+		Tk_FreePixmap(tablePtr->display, tablePtr->cellPixmap);
+		tablePtr->cellPixmap = None;
+	    }
+	    if (tablePtr->cursorSave != None) {
+		Tk_FreePixmap(tablePtr->display, tablePtr->cursorSave);
+		tablePtr->cursorSave = None;
+	    }
 
-#ifdef PROCS
-    tablePtr->inProc = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(tablePtr->inProc, TCL_STRING_KEYS);
-#endif
+	    Tcl_EventuallyFree((ClientData) tablePtr, (Tcl_FreeProc *) TableDestroy);
+	    break;
 
-    tablePtr->haveSelection = 0;
-    Tcl_DStringInit(&tablePtr->selection);
+	case MapNotify: /* redraw table when remapped if it changed */
+	    if (tablePtr->flags & REDRAW_ON_MAP) {
+		tablePtr->flags &= ~REDRAW_ON_MAP;
+		Tcl_Preserve((ClientData) tablePtr);
+		TableAdjustParams(tablePtr);
+		TableInvalidateAll(tablePtr, INV_HIGHLIGHT);
+		Tcl_Release((ClientData) tablePtr);
+	    }
+	    break;
 
-    /*
-     * Handle class name and selection handlers
-     */
-    offset = 2 + Tk_ClassOptionObjCmd(tkwin, "Table", objc, objv);
-    Tk_SetClassProcs(tkwin, &tableClass, (ClientData) tablePtr);
-    Tk_CreateEventHandler(tablePtr->tkwin,
-	    PointerMotionMask|ExposureMask|StructureNotifyMask|FocusChangeMask|VisibilityChangeMask,
-	    TableEventProc, (ClientData) tablePtr);
-    Tk_CreateSelHandler(tablePtr->tkwin, XA_PRIMARY, XA_STRING, TableFetchSelection,
-	(ClientData) tablePtr, XA_STRING);
+	case ConfigureNotify:
+	    Tcl_Preserve((ClientData) tablePtr);
+	    /* wrapped cell text depends on the geometry */
+	    TableFlushLayoutCache(tablePtr);
+	    TableAdjustParams(tablePtr);
+	    TableInvalidateAll(tablePtr, INV_HIGHLIGHT);
+	    Tcl_Release((ClientData) tablePtr);
+	    break;
 
-    /* Use 1 to force update */
-    if (TableConfigure(interp, tablePtr, objc - offset, objv + offset, 0, 1) != TCL_OK) {
-	Tk_DestroyWindow(tkwin);
-	return TCL_ERROR;
-    }
-    if (TableInitTags(interp, tablePtr) != TCL_OK) {
-	Tk_DestroyWindow(tkwin);
-	return TCL_ERROR;
+	case FocusIn:
+	case FocusOut:
+	    if (eventPtr->xfocus.detail != NotifyInferior) {
+		tablePtr->flags |= REDRAW_BORDER;
+		if (eventPtr->type == FocusOut) {
+		    tablePtr->flags &= ~HAS_FOCUS;
+		} else {
+		    tablePtr->flags |= HAS_FOCUS;
+		}
+		TableRedrawHighlight(tablePtr);
+		/* cancel the timer */
+		TableConfigCursor(tablePtr);
+	    }
+	    break;
     }
-
-    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tk_PathName(tablePtr->tkwin), -1));
-    return TCL_OK;
 }
 
 /*
- *---------------------------------------------------------------------------
+ *----------------------------------------------------------------------
  *
- * TableWorldChanged --
+ * TableCmdDeletedProc --
  *
- *      This procedure is called when the world has changed in some
- *      way and the widget needs to recompute all its graphics contexts
- *	and determine its new geometry.
+ *	This procedure is invoked when a widget command is deleted.  If
+ *	the widget isn't already in the process of being destroyed,
+ *	this command destroys it.
  *
  * Results:
- *      None
+ *	None
  *
  * Side effects:
- *      Entry will be relayed out and redisplayed.
+ *	The widget is destroyed.
  *
- *---------------------------------------------------------------------------
+ *----------------------------------------------------------------------
  */
-
-static void TableWorldChanged(
-    ClientData instanceData) {	/* Information about widget. */
-
-    Table *tablePtr = (Table *) instanceData;
-    Tk_FontMetrics fm;
-
-    /*
-     * Set up the default column width and row height
-     */
-    Tk_GetFontMetrics(tablePtr->defaultTag.tkfont, &fm);
-    tablePtr->charWidth  = Tk_TextWidth(tablePtr->defaultTag.tkfont, "0", 1);
-    tablePtr->charHeight = fm.linespace + 2;
+static void TableCmdDeletedProc(ClientData clientData) {
+    Table *tablePtr = (Table *) clientData;
+    Tk_Window tkwin;
 
     /*
-     * Recompute the window's geometry and arrange for it to be redisplayed.
+     * This procedure could be invoked either because the window was
+     * destroyed and the command was then deleted (in which case tkwin
+     * is NULL) or because the command was deleted, and then this procedure
+     * destroys the widget.
      */
 
-    TableAdjustParams(tablePtr);
-    TableGeometryRequest(tablePtr);
-    Tk_SetInternalBorder(tablePtr->tkwin, tablePtr->highlightWidth);
-    /* invalidate the whole table */
-    TableInvalidateAll(tablePtr, INV_HIGHLIGHT);
+    if (tablePtr->tkwin != NULL) {
+	tkwin = tablePtr->tkwin;
+	tablePtr->tkwin = NULL;
+	Tk_DestroyWindow(tkwin);
+    }
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * TableRefresh --
- *	Refreshes an area of the table based on the mode.
- *	row,col in real coords (0-based)
+ * TableFetchSelection --
+ *	This procedure is called back by Tk when the selection is
+ *	requested by someone.  It returns part or all of the selection
+ *	in a buffer provided by the caller.
  *
  * Results:
- *	Will cause redraw for visible cells
+ *	The return value is the number of non-NULL bytes stored
+ *	at buffer.  Buffer is filled (or partially filled) with a
+ *	NULL-terminated string containing part or all of the selection,
+ *	as given by offset and maxBytes.
  *
  * Side effects:
  *	None
  *
  *----------------------------------------------------------------------
  */
-void TableRefresh(Table *tablePtr, int row, int col, int mode) {
-    int x, y, w, h;
 
-    if ((row < 0) || (col < 0)) {
-	/*
-	 * Invalid coords passed in.  This can happen when the "active" cell
-	 * is refreshed, but doesn't really exist (row==-1 && col==-1).
-	 */
-	return;
+static Tcl_Size TableFetchSelection(
+     ClientData clientData,	/* Information about table widget. */
+     Tcl_Size offset,		/* Offset within selection of first character to be returned. */
+     char *buffer,		/* Location in which to place selection. */
+     Tcl_Size maxBytes) {	/* Maximum number of bytes to place at buffer, not including
+				 * terminating NULL. */
+
+    Table *tablePtr = (Table *) clientData;
+    Tcl_Interp *interp = tablePtr->interp;
+    char *value, *data, *rowsep = tablePtr->rowSep, *colsep = tablePtr->colSep;
+    Tcl_HashEntry *entryPtr;
+    Tcl_HashSearch search;
+    int lastrow=0, needcs=0, r, c, rslen=0, cslen=0;
+    Tcl_Size count, length, listArgc;
+    int numcols, numrows, code;
+    const char **listArgv;
+
+    /* if we are not exporting the selection ||
+     * we have no data source, return */
+    if (!tablePtr->exportSelection ||
+	(tablePtr->dataSource == DATA_NONE)) {
+	return -1;
     }
-    if (mode & CELL) {
-	if (TableCellVCoords(tablePtr, row, col, &x, &y, &w, &h, 0)) {
-	    TableInvalidate(tablePtr, x, y, w, h, mode);
+
+    if ((offset == 0) || !tablePtr->haveSelection) {
+	/* First Time through, get the selection, otherwise, just use the
+	 * selection obtained before */
+
+	/* If we have fetched a selection before, free it */
+	if (tablePtr->haveSelection) {
+	    Tcl_DStringFree(&tablePtr->selection);
+	    tablePtr->haveSelection = 0;
 	}
-    } else if (mode & ROW) {
-	/* get the position of the leftmost cell in the row */
-	if ((mode & INV_FILL) && row < tablePtr->topRow) {
-	    /* Invalidate whole table */
-	    TableInvalidateAll(tablePtr, mode);
-	} else if (TableCellVCoords(tablePtr, row, tablePtr->leftCol, &x, &y, &w, &h, 0)) {
-	    /* Invalidate from this row, maybe to end */
-	    TableInvalidate(tablePtr, 0, y, Tk_Width(tablePtr->tkwin),
-		    (mode&INV_FILL)?Tk_Height(tablePtr->tkwin):h, mode);
+
+	/* First get a sorted list of the selected elements */
+	Tcl_DStringInit(&tablePtr->selection);
+	for (entryPtr = Tcl_FirstHashEntry(tablePtr->selCells, &search);
+	     entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	    Tcl_DStringAppendElement(&tablePtr->selection,
+		    Tcl_GetHashKey(tablePtr->selCells, entryPtr));
 	}
-    } else if (mode & COL) {
-	/* get the position of the topmost cell on the column */
-	if ((mode & INV_FILL) && col < tablePtr->leftCol) {
-	    /* Invalidate whole table */
-	    TableInvalidateAll(tablePtr, mode);
-	} else if (TableCellVCoords(tablePtr, tablePtr->topRow, col, &x, &y, &w, &h, 0)) {
-	    /* Invalidate from this column, maybe to end */
-	    TableInvalidate(tablePtr, x, 0, (mode&INV_FILL)?Tk_Width(tablePtr->tkwin):w,
-		    Tk_Height(tablePtr->tkwin), mode);
+	value = TableCellSort(tablePtr, Tcl_DStringValue(&tablePtr->selection));
+	Tcl_DStringFree(&tablePtr->selection);
+
+	/* Abort if no data or conversion to list fails */
+	if (value == NULL) {
+	    return -1;
+	}
+	if (Tcl_SplitList(interp, value, &listArgc, &listArgv) != TCL_OK) {
+	    Tcl_Free(value);
+	    return -1;
+	}
+	Tcl_Free(value);
+
+	/* Add elements to selection */
+	Tcl_DStringInit(&tablePtr->selection);
+	tablePtr->haveSelection = 1;
+	rslen = (rowsep?((int) strlen(rowsep)):0);
+	cslen = (colsep?((int) strlen(colsep)):0);
+	numrows = numcols = 0;
+	for (count = 0; count < listArgc; count++) {
+	    TableParseArrayIndex(&r, &c, listArgv[count]);
+	    if (count) {
+		if (lastrow != r) {
+		    lastrow = r;
+		    needcs = 0;
+		    if (rslen) {
+			Tcl_DStringAppend(&tablePtr->selection, rowsep, (Tcl_Size)rslen);
+		    } else {
+			Tcl_DStringEndSublist(&tablePtr->selection);
+			Tcl_DStringStartSublist(&tablePtr->selection);
+		    }
+		    ++numrows;
+		} else {
+		    if (++needcs > numcols)
+			numcols = needcs;
+		}
+	    } else {
+		lastrow = r;
+		needcs = 0;
+		if (!rslen) {
+		    Tcl_DStringStartSublist(&tablePtr->selection);
+		}
+	    }
+	    data = TableGetCellValue(tablePtr, r, c);
+	    if (cslen) {
+		if (needcs) {
+		    Tcl_DStringAppend(&tablePtr->selection, colsep, (Tcl_Size)cslen);
+		}
+		Tcl_DStringAppend(&tablePtr->selection, data, -1);
+	    } else {
+		Tcl_DStringAppendElement(&tablePtr->selection, data);
+	    }
+	}
+	if (!rslen && count) {
+	    Tcl_DStringEndSublist(&tablePtr->selection);
+	}
+	Tcl_Free((char *) listArgv);
+
+	if (tablePtr->selCmd != NULL) {
+	    Tcl_DString script;
+	    Tcl_DStringInit(&script);
+	    ExpandPercents(tablePtr, tablePtr->selCmd, numrows+1, numcols+1,
+		    Tcl_DStringValue(&tablePtr->selection), (char *)NULL,
+		    listArgc, &script, CMD_ACTIVATE);
+	    if ((code = Tcl_EvalEx(interp, Tcl_DStringValue(&script), -1, TCL_EVAL_GLOBAL)) == TCL_ERROR) {
+		Tcl_AddErrorInfo(interp, "\n    (error in table selection command)");
+		Tcl_BackgroundException(interp, code);
+		Tcl_DStringFree(&script);
+		Tcl_DStringFree(&tablePtr->selection);
+		tablePtr->haveSelection = 0;
+		return -1;
+	    } else {
+		Tcl_DStringGetResult(interp, &tablePtr->selection);
+	    }
+	    Tcl_DStringFree(&script);
 	}
     }
-}
 
-/*
- *----------------------------------------------------------------------
- *
- * TableGetGc --
- *	Gets a GC corresponding to the tag structure passed.
- *
- * Results:
- *	Returns usable GC.
- *
- * Side effects:
- *	None
- *
- *----------------------------------------------------------------------
- */
-static void TableGetGc(Display *display, Drawable d, TableTag *tagPtr, GC *tagGc) {
-    XGCValues gcValues;
-    gcValues.foreground = Tk_3DBorderColor(tagPtr->fg)->pixel;
-    gcValues.background = Tk_3DBorderColor(tagPtr->bg)->pixel;
-    gcValues.font = Tk_FontId(tagPtr->tkfont);
-    if (*tagGc == NULL) {
-	gcValues.graphics_exposures = False;
-	*tagGc = XCreateGC(display, d, GCForeground|GCBackground|GCFont|GCGraphicsExposures,
-		&gcValues);
+    /* Get selection length */
+    if (tablePtr->haveSelection) {
+	length = Tcl_DStringLength(&tablePtr->selection);
     } else {
-	XChangeGC(display, *tagGc, GCForeground|GCBackground|GCFont, &gcValues);
+	length = 0;
     }
-}
-
-#define TableFreeGc	XFreeGC
-
-/*
- *--------------------------------------------------------------
- *
- * TableUndisplay --
- *	This procedure removes the contents of a table window
- *	that have been moved offscreen.
- *
- * Results:
- *	Embedded windows can be unmapped.
- *
- * Side effects:
- *	Information disappears from the screen.
- *
- *--------------------------------------------------------------
- */
-static void TableUndisplay(Table *tablePtr) {
-    int *seen = tablePtr->seen;
-    int row, col;
-
-    /* We need to find out the true last cell, not considering spans */
-    tablePtr->flags |= AVOID_SPANS;
-    TableGetLastCell(tablePtr, &row, &col);
-    tablePtr->flags &= ~AVOID_SPANS;
 
-    if (seen[0] != -1) {
-	if (seen[0] < tablePtr->topRow) {
-	    /* Remove now hidden rows */
-	    EmbWinUnmap(tablePtr, seen[0], MIN(seen[2],tablePtr->topRow-1), seen[1], seen[3]);
-	    /* Also account for the title area */
-	    EmbWinUnmap(tablePtr, seen[0], MIN(seen[2],tablePtr->topRow-1), 0, tablePtr->titleCols-1);
-	}
-	if (seen[1] < tablePtr->leftCol) {
-	    /* Remove now hidden cols */
-	    EmbWinUnmap(tablePtr, seen[0], seen[2], seen[1], MAX(seen[3],tablePtr->leftCol-1));
-	    /* Also account for the title area */
-	    EmbWinUnmap(tablePtr, 0, tablePtr->titleRows-1, seen[1], MAX(seen[3],tablePtr->leftCol-1));
-	}
-	if (seen[2] > row) {
-	    /* Remove now off-screen rows */
-	    EmbWinUnmap(tablePtr, MAX(seen[0],row+1), seen[2], seen[1], seen[3]);
-	    /* Also account for the title area */
-	    EmbWinUnmap(tablePtr, MAX(seen[0],row+1), seen[2], 0, tablePtr->titleCols-1);
+    /* If no selection, abort */
+    if (length == 0) {
+	if (tablePtr->haveSelection) {
+	    Tcl_DStringFree(&tablePtr->selection);
+	    tablePtr->haveSelection = 0;
 	}
-	if (seen[3] > col) {
-	    /* Remove now off-screen cols */
-	    EmbWinUnmap(tablePtr, seen[0], seen[2], MAX(seen[1],col+1), seen[3]);
-	    /* Also account for the title area */
-	    EmbWinUnmap(tablePtr, 0, tablePtr->titleRows-1, MAX(seen[1],col+1), seen[3]);
+	return -1;
+    }
+
+    /* Copy the requested portion of the selection to the buffer. */
+    count = length - offset;
+    if (count <= 0) {
+	count = 0;
+    } else {
+	if (count > maxBytes) {
+	    count = maxBytes;
 	}
+	memcpy((void *) buffer,
+	       (void *) (Tcl_DStringValue(&tablePtr->selection) + offset),
+	       (size_t) count);
     }
-    seen[0] = tablePtr->topRow;
-    seen[1] = tablePtr->leftCol;
-    seen[2] = row;
-    seen[3] = col;
+    buffer[count] = '\0';
+    if (count < maxBytes) {
+	/*
+	 * This should be the last call in this range, so free selection now.
+	 */
+	Tcl_DStringFree(&tablePtr->selection);
+	tablePtr->haveSelection = 0;
+    }
+    return count;
 }
 
-/*
- * Generally we should be able to use XSetClipRectangles on X11, but
- * the addition of Xft drawing to Tk 8.5+ completely ignores the clip
- * rectangles.  Thus turn it off for all cases until clip rectangles
- * are known to be respected. [Bug 1805350]
- */
-#if !defined(MAC_OSX_TK)
-#define NO_XSETCLIP
-#endif
 /*
  *--------------------------------------------------------------
  *
- * TableDisplay --
- *	This procedure redraws the contents of a table window.
- *	The conditional code in this function is due to these factors:
- *		o Lack of XSetClipRectangles on Macintosh
- *		o Use of alternative routine for Windows
+ * Tk_TableObjCmd --
+ *	This procedure is invoked to process the "table" Tcl
+ *	command.  See the user documentation for details on what
+ *	it does.
  *
  * Results:
- *	None
+ *	A standard Tcl result.
  *
  * Side effects:
- *	Information appears on the screen.
+ *	See the user documentation.
  *
  *--------------------------------------------------------------
  */
-static void TableDisplay(ClientData clientdata) {
-    Table *tablePtr = (Table *) clientdata;
-    Tk_Window tkwin = tablePtr->tkwin;
-    Display *display = tablePtr->display;
-    Drawable window;
-#ifdef NO_XSETCLIP
-    Drawable clipWind;
-#elif defined(_WIN32)
-    TkWinDrawable *twdPtr;
-    HDC dc;
-    HRGN clipR;
-#else
-    XRectangle clipRect;
-#endif
-    int rowFrom, rowTo, colFrom, colTo, invalidX, invalidY, invalidWidth, invalidHeight,
-	x, y, width, height, itemX, itemY, itemW, itemH,
-	row, col, urow, ucol, hrow=0, hcol=0, cx, cy, cw, ch, borders, bd[6],
-	new, boundW, boundH, maxW, maxH, cellType,
-	originX, originY, activeCell, shouldInvert, ipadx, ipady, padx, pady;
-    Tcl_Size numChars;
-    GC tagGc = NULL, topGc, bottomGc;
-    char *string = NULL;
-    char buf[INDEX_BUFSIZE];
-    TableTag *tagPtr = NULL, *titlePtr, *selPtr, *activePtr, *flashPtr, *rowPtr, *colPtr;
-    Tcl_HashEntry *entryPtr;
-    XPoint rect[3];
-    Tcl_HashTable *colTagsCache = NULL;
-    Tcl_HashTable *drawnCache = NULL;
-    Tk_TextLayout textLayout = NULL;
-    TableEmbWindow *ewPtr;
-    Tk_FontMetrics fm;
-    Tk_Font ellFont = NULL;
-    char *ellipsis = NULL;
-    int ellLen = 0, useEllLen = 0, ellEast = 0;
-    int leftoverWidth, leftoverHeight;
+static int Tk_TableObjCmd(
+    ClientData clientData,	/* Main window associated with interpreter. */
+    Tcl_Interp *interp,
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[]) {	/* Argument objects. */
 
-    tablePtr->flags &= ~REDRAW_PENDING;
-    if ((tkwin == NULL) || !Tk_IsMapped(tkwin)) {
-	return;
+    Table *tablePtr;
+    Tk_Window tkwin, mainWin = (Tk_Window) clientData;
+    int offset;
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "pathName ?options?");
+	return TCL_ERROR;
     }
 
-    boundW = Tk_Width(tkwin) - tablePtr->highlightWidth;
-    boundH = Tk_Height(tkwin) - tablePtr->highlightWidth;
-
-    /* Constrain drawable to not include highlight borders */
-    invalidX = MAX(tablePtr->highlightWidth, tablePtr->invalidX);
-    invalidY = MAX(tablePtr->highlightWidth, tablePtr->invalidY);
-    invalidWidth  = MIN(tablePtr->invalidWidth, MAX(1, boundW-invalidX));
-    invalidHeight = MIN(tablePtr->invalidHeight, MAX(1, boundH-invalidY));
+    tkwin = Tk_CreateWindowFromPath(interp, mainWin, Tcl_GetString(objv[1]), (char *)NULL);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
 
-    ipadx = tablePtr->ipadX;
-    ipady = tablePtr->ipadY;
-    padx  = tablePtr->padX;
-    pady  = tablePtr->padY;
+    tablePtr = (Table *) Tcl_Alloc(sizeof(Table));
+    if (tablePtr == NULL) {
+	return TCL_ERROR;
+    }
+    memset((void *) tablePtr, 0, sizeof(Table));
 
-#ifndef _WIN32
-    /*
-     * if we are using the slow drawing mode with a pixmap
-     * create the pixmap and adjust x && y for offset in pixmap
-     * FIX: Ignore slow mode for Win32 as the fast ClipRgn trick
-     * below does not work for bitmaps.
-     */
-    if (tablePtr->drawMode == DRAW_MODE_SLOW) {
-	window = Tk_GetPixmap(display, Tk_WindowId(tkwin),
-		invalidWidth, invalidHeight, Tk_Depth(tkwin));
-    } else
-#endif
-	window = Tk_WindowId(tkwin);
-#ifdef NO_XSETCLIP
     /*
-     * Ensure clipWind is large enough for changed cell, which at the
-     * extreme is the full displayed window size.
+     * Set the structure elements that aren't 0/NULL by default,
+     * and that won't be set by the initial configure call.
      */
-    clipWind = Tk_GetPixmap(display, window, boundW, boundH, Tk_Depth(tkwin));
-#endif
+    tablePtr->tkwin		= tkwin;
+    tablePtr->display		= Tk_Display(tkwin);
+    tablePtr->interp		= interp;
+    tablePtr->widgetCmd	= Tcl_CreateObjCommand(interp, Tk_PathName(tablePtr->tkwin),
+	TableWidgetObjCmd, (ClientData) tablePtr, (Tcl_CmdDeleteProc *) TableCmdDeletedProc);
 
-    /* set up the permanent tag styles */
-    entryPtr	= Tcl_FindHashEntry(tablePtr->tagTable, "title");
-    titlePtr	= (TableTag *) Tcl_GetHashValue(entryPtr);
-    entryPtr	= Tcl_FindHashEntry(tablePtr->tagTable, "sel");
-    selPtr	= (TableTag *) Tcl_GetHashValue(entryPtr);
-    entryPtr	= Tcl_FindHashEntry(tablePtr->tagTable, "active");
-    activePtr	= (TableTag *) Tcl_GetHashValue(entryPtr);
-    entryPtr	= Tcl_FindHashEntry(tablePtr->tagTable, "flash");
-    flashPtr	= (TableTag *) Tcl_GetHashValue(entryPtr);
+    tablePtr->anchorRow		= -1;
+    tablePtr->anchorCol		= -1;
+    tablePtr->activeRow		= -1;
+    tablePtr->activeCol		= -1;
+    tablePtr->oldTopRow		= -1;
+    tablePtr->oldLeftCol	= -1;
+    tablePtr->oldActRow		= -1;
+    tablePtr->oldActCol		= -1;
+    tablePtr->seen[0]		= -1;
 
-    /* We need to find out the true cell span, not considering spans */
-    tablePtr->flags |= AVOID_SPANS;
-    /* find out the cells represented by the invalid region */
-    TableWhatCell(tablePtr, invalidX, invalidY, &rowFrom, &colFrom);
-    TableWhatCell(tablePtr, invalidX+invalidWidth-1, invalidY+invalidHeight-1, &rowTo, &colTo);
-    tablePtr->flags &= ~AVOID_SPANS;
+    tablePtr->dataSource	= DATA_NONE;
+    tablePtr->activeBuf		= Tcl_Alloc(1);
+    *(tablePtr->activeBuf)	= '\0';
 
-    /*
-     * Initialize colTagsCache hash table to cache column tag names.
-     */
-    colTagsCache = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(colTagsCache, TCL_ONE_WORD_KEYS);
-    /*
-     * Initialize drawnCache hash table to cache drawn cells.
-     * This is necessary to prevent spanning cells being drawn multiple times.
-     */
-    drawnCache = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
-    Tcl_InitHashTable(drawnCache, TCL_STRING_KEYS);
+    tablePtr->cursor		= NULL;
+    tablePtr->bdcursor		= NULL;
 
-    /*
-     * Create the tag here.  This will actually create a JoinTag
-     * That will handle the priority management of merging for us.
-     * We only need one allocated, and we'll reset it for each cell.
-     */
-    tagPtr = TableNewTag(tablePtr);
+    tablePtr->defaultTag.justify	= TK_JUSTIFY_LEFT;
+    tablePtr->defaultTag.state		= STATE_UNKNOWN;
 
-    /* Cycle through the cells and display them */
-    for (row = rowFrom; row <= rowTo; row++) {
-	/*
-	 * are we in the 'dead zone' between the
-	 * title rows and the first displayed row
-	 */
-	if (row < tablePtr->topRow && row >= tablePtr->titleRows) {
-	    row = tablePtr->topRow;
-	}
+    /* misc tables */
+    tablePtr->tagTable	= (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->tagTable, TCL_STRING_KEYS);
+    tablePtr->winTable	= (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->winTable, TCL_STRING_KEYS);
 
-	/* Cache the row in user terms */
-	urow = row+tablePtr->rowOffset;
+    /* internal value cache */
+    tablePtr->cache	= (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->cache, TCL_STRING_KEYS);
 
-	/* Get the row tag once for all iterations of col */
-	rowPtr = FindRowColTag(tablePtr, urow, ROW);
+    /* style hash tables */
+    tablePtr->colWidths = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->colWidths, TCL_ONE_WORD_KEYS);
+    tablePtr->rowHeights = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->rowHeights, TCL_ONE_WORD_KEYS);
 
-	for (col = colFrom; col <= colTo; col++) {
-	    activeCell = 0;
-	    /*
-	     * Adjust to first viewable column if we are in the 'dead zone'
-	     * between the title cols and the first displayed column.
-	     */
-	    if (col < tablePtr->leftCol && col >= tablePtr->titleCols) {
-		col = tablePtr->leftCol;
-	    }
+    /* style hash tables */
+    tablePtr->rowStyles = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->rowStyles, TCL_ONE_WORD_KEYS);
+    tablePtr->colStyles = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->colStyles, TCL_ONE_WORD_KEYS);
+    tablePtr->cellStyles = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->cellStyles, TCL_STRING_KEYS);
 
-	    /*
-	     * Get the coordinates for the cell before possible rearrangement
-	     * of row,col due to spanning cells
-	     */
-	    cellType = TableCellCoords(tablePtr, row, col, &x, &y, &width, &height);
-	    if (cellType == CELL_HIDDEN) {
-		/*
-		 * width,height holds the real start row,col of the span.
-		 * Put the use cell ref into a buffer for the hash lookups.
-		 */
-		TableMakeArrayIndex(width, height, buf);
-		Tcl_CreateHashEntry(drawnCache, buf, &new);
-		if (!new) {
-		    /* Not new in the entry, so it's already drawn */
-		    continue;
-		}
-		hrow = row; hcol = col;
-		row = width-tablePtr->rowOffset;
-		col = height-tablePtr->colOffset;
-		TableCellVCoords(tablePtr, row, col, &x, &y, &width, &height, 0);
-		/* We have to adjust the coords back onto the visual display */
-		urow = row+tablePtr->rowOffset;
-		rowPtr = FindRowColTag(tablePtr, urow, ROW);
-	    }
+    /* special style hash tables */
+    tablePtr->flashCells = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->flashCells, FLASH_KEY_WORDS);
+    tablePtr->selCells = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->selCells, TCL_STRING_KEYS);
 
-	    /* Constrain drawn size to the visual boundaries */
-	    if (tablePtr->colStretch == STRETCH_MODE_NONE) {
-		if (x >= boundW && width > boundW - x) {
-		    width = boundW - x;
-		}
-	    } else {
-		if (width > boundW - x) {
-		    width = boundW - x;
-		}
-	    }
-	    if (tablePtr->rowStretch == STRETCH_MODE_NONE) {
-		if (y >= boundH && height > boundH - y) {
-		    height = boundH - y;
-		}
-	    } else {
-		if (height > boundH - y) {
-		    height = boundH - y;
-		}
-	    }
+    /* text measurement and layout caches */
+    tablePtr->measureCache = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->measureCache, TCL_STRING_KEYS);
+    tablePtr->layoutCache = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->layoutCache, TCL_STRING_KEYS);
+    tablePtr->fitCache = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->fitCache, TCL_STRING_KEYS);
+    tablePtr->styleCache = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->styleCache, STYLE_KEY_WORDS);
+    tablePtr->gcCache = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->gcCache, GC_KEY_WORDS);
 
-	    /* Cache the col in user terms */
-	    ucol = col+tablePtr->colOffset;
+    /*
+     * List of tags in priority order.  30 is a good default number to alloc.
+     */
+    tablePtr->tagPrioMax = 30;
+    tablePtr->tagPrioNames = (char **) Tcl_Alloc(sizeof(char *) * tablePtr->tagPrioMax);
+    tablePtr->tagPrios = (TableTag **) Tcl_Alloc(sizeof(TableTag *) * tablePtr->tagPrioMax);
+    tablePtr->tagPrioSize = 0;
+    for (offset = 0; offset < tablePtr->tagPrioMax; offset++) {
+	tablePtr->tagPrioNames[offset] = (char *) NULL;
+	tablePtr->tagPrios[offset] = (TableTag *) NULL;
+    }
 
-	    /* put the use cell ref into a buffer for the hash lookups */
-	    TableMakeArrayIndex(urow, ucol, buf);
-	    if (cellType != CELL_HIDDEN) {
-		Tcl_CreateHashEntry(drawnCache, buf, &new);
-	    }
+#ifdef PROCS
+    tablePtr->inProc = (Tcl_HashTable *) Tcl_Alloc(sizeof(Tcl_HashTable));
+    Tcl_InitHashTable(tablePtr->inProc, TCL_STRING_KEYS);
+#endif
 
-	    /*
-	     * Make sure we start with a clean tag (set to table defaults).
-	     */
-	    TableResetTag(tablePtr, tagPtr);
+    tablePtr->haveSelection = 0;
+    Tcl_DStringInit(&tablePtr->selection);
 
-	    /*
-	     * Check to see if we have an embedded window in this cell.
-	     */
-	    entryPtr = Tcl_FindHashEntry(tablePtr->winTable, buf);
-	    if (entryPtr != NULL) {
-		ewPtr = (TableEmbWindow *) Tcl_GetHashValue(entryPtr);
+    /*
+     * Handle class name and selection handlers
+     */
+    offset = 2 + Tk_ClassOptionObjCmd(tkwin, "Table", objc, objv);
+    Tk_SetClassProcs(tkwin, &tableClass, (ClientData) tablePtr);
+    Tk_CreateEventHandler(tablePtr->tkwin,
+	    PointerMotionMask|ExposureMask|StructureNotifyMask|FocusChangeMask|VisibilityChangeMask,
+	    TableEventProc, (ClientData) tablePtr);
+    Tk_CreateSelHandler(tablePtr->tkwin, XA_PRIMARY, XA_STRING, TableFetchSelection,
+	(ClientData) tablePtr, XA_STRING);
 
-		if (ewPtr->tkwin != NULL) {
-		    /* Display embedded window instead of text */
+    /* Use 1 to force update */
+    if (TableConfigure(interp, tablePtr, objc - offset, objv + offset, 0, 1) != TCL_OK) {
+	Tk_DestroyWindow(tkwin);
+	return TCL_ERROR;
+    }
+    if (TableInitTags(interp, tablePtr) != TCL_OK) {
+	Tk_DestroyWindow(tkwin);
+	return TCL_ERROR;
+    }
 
-		    /* if active, make it disabled to avoid
-		     * unnecessary editing */
-		    if ((tablePtr->flags & HAS_ACTIVE) && row == tablePtr->activeRow
-			    && col == tablePtr->activeCol) {
-			tablePtr->flags |= ACTIVE_DISABLED;
-		    }
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tk_PathName(tablePtr->tkwin), -1));
+    return TCL_OK;
+}
 
-		    /*
-		     * The EmbWinDisplay function may modify values in
-		     * tagPtr, so reference those after this call.
-		     */
-		    EmbWinDisplay(tablePtr, window, ewPtr, tagPtr, x, y, width, height);
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TableWorldChanged --
+ *
+ *      This procedure is called when the world has changed in some
+ *      way and the widget needs to recompute all its graphics contexts
+ *	and determine its new geometry.
+ *
+ * Results:
+ *      None
+ *
+ * Side effects:
+ *      Entry will be relayed out and redisplayed.
+ *
+ *---------------------------------------------------------------------------
+ */
 
-#ifndef _WIN32
-		    if (tablePtr->drawMode == DRAW_MODE_SLOW) {
-			/* Correctly adjust x && y with the offset */
-			x -= invalidX;
-			y -= invalidY;
-		    }
-#endif
+static void TableWorldChanged(
+    ClientData instanceData) {	/* Information about widget. */
 
-		    Tk_Fill3DRectangle(tkwin, window, tagPtr->bg, x, y, width, height, 0,
-			TK_RELIEF_FLAT);
+    Table *tablePtr = (Table *) instanceData;
+    Tk_FontMetrics fm;
 
-		    /* border width for cell should now be properly set */
-		    borders = TableGetTagBorders(tagPtr, &bd[0], &bd[1], &bd[2], &bd[3]);
-		    bd[4] = (bd[0] + bd[1])/2;
-		    bd[5] = (bd[2] + bd[3])/2;
+    /*
+     * Set up the default column width and row height
+     */
+    Tk_GetFontMetrics(tablePtr->defaultTag.tkfont, &fm);
+    tablePtr->charWidth  = Tk_TextWidth(tablePtr->defaultTag.tkfont, "0", 1);
+    tablePtr->charHeight = fm.linespace + 2;
 
-		    goto DrawBorder;
-		}
-	    }
+    /*
+     * Font metrics may have changed, so drop all cached text widths
+     * and layouts
+     */
+    Tcl_DeleteHashTable(tablePtr->measureCache);
+    Tcl_InitHashTable(tablePtr->measureCache, TCL_STRING_KEYS);
+    TableFlushLayoutCache(tablePtr);
 
-	    /*
-	     * Don't draw what won't be seen.
-	     * Embedded windows handle this in EmbWinDisplay.
-	     */
-	    if ((width <= 0) || (height <= 0)) { continue; }
-
-#ifndef _WIN32
-	    if (tablePtr->drawMode == DRAW_MODE_SLOW) {
-		/* Correctly adjust x && y with the offset */
-		x -= invalidX;
-		y -= invalidY;
-	    }
-#endif
-
-	    shouldInvert = 0;
-	    /*
-	     * Get the combined tag structure for the cell.
-	     * First clear out a new tag structure that we will build in
-	     * then add tags as we realize they belong.
-	     *
-	     * Tags have their own priorities which TableMergeTag will
-	     * take into account when merging tags.
-	     */
+    /*
+     * Recompute the window's geometry and arrange for it to be redisplayed.
+     */
 
-	    /*
-	     * Merge colPtr if it exists
-	     * let's see if we have the value cached already
-	     * if not, run the findColTag routine and cache the value
-	     */
-	    entryPtr = Tcl_CreateHashEntry(colTagsCache, INT2PTR(ucol), &new);
-	    if (new) {
-		colPtr = FindRowColTag(tablePtr, ucol, COL);
-		Tcl_SetHashValue(entryPtr, colPtr);
-	    } else {
-		colPtr = (TableTag *) Tcl_GetHashValue(entryPtr);
-	    }
-	    if (colPtr != (TableTag *) NULL) {
-		TableMergeTag(tablePtr, tagPtr, colPtr);
-	    }
-	    /* Merge rowPtr if it exists */
-	    if (rowPtr != (TableTag *) NULL) {
-		TableMergeTag(tablePtr, tagPtr, rowPtr);
-	    }
-	    /* Am I in the titles */
-	    if (row < tablePtr->titleRows || col < tablePtr->titleCols) {
-		TableMergeTag(tablePtr, tagPtr, titlePtr);
-	    }
-	    /* Does this have a cell tag */
-	    entryPtr = Tcl_FindHashEntry(tablePtr->cellStyles, buf);
-	    if (entryPtr != NULL) {
-		TableMergeTag(tablePtr, tagPtr, (TableTag *) Tcl_GetHashValue(entryPtr));
-	    }
-	    /* is this cell active? */
-	    if ((tablePtr->flags & HAS_ACTIVE) && (tablePtr->state == STATE_NORMAL) &&
-		    row == tablePtr->activeRow && col == tablePtr->activeCol) {
-		if (tagPtr->state == STATE_DISABLED) {
-		    tablePtr->flags |= ACTIVE_DISABLED;
-		} else {
-		    TableMergeTag(tablePtr, tagPtr, activePtr);
-		    activeCell = 1;
-		    tablePtr->flags &= ~ACTIVE_DISABLED;
-		}
-	    }
-	    /* is this cell selected? */
-	    if (Tcl_FindHashEntry(tablePtr->selCells, buf) != NULL) {
-		if (tablePtr->invertSelected && !activeCell) {
-		    shouldInvert = 1;
-		} else {
-		    TableMergeTag(tablePtr, tagPtr, selPtr);
-		}
-	    }
-	    /* if flash mode is on, is this cell flashing? */
-	    if (tablePtr->flashMode && Tcl_FindHashEntry(tablePtr->flashCells, buf) != NULL) {
-		TableMergeTag(tablePtr, tagPtr, flashPtr);
-	    }
+    TableAdjustParams(tablePtr);
+    TableGeometryRequest(tablePtr);
+    Tk_SetInternalBorder(tablePtr->tkwin, tablePtr->highlightWidth);
+    /* invalidate the whole table */
+    TableInvalidateAll(tablePtr, INV_HIGHLIGHT);
+}
 
-	    if (shouldInvert) {
-		TableInvertTag(tagPtr);
-	    }
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableRefresh --
+ *	Refreshes an area of the table based on the mode.
+ *	row,col in real coords (0-based)
+ *
+ * Results:
+ *	Will cause redraw for visible cells
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+void TableRefresh(Table *tablePtr, int row, int col, int mode) {
+    int x, y, w, h;
 
-	    /*
-	     * Borders for cell should now be properly set
-	     */
-	    borders = TableGetTagBorders(tagPtr, &bd[0], &bd[1], &bd[2], &bd[3]);
-	    bd[4] = (bd[0] + bd[1])/2;
-	    bd[5] = (bd[2] + bd[3])/2;
+    if ((row < 0) || (col < 0)) {
+	/*
+	 * Invalid coords passed in.  This can happen when the "active" cell
+	 * is refreshed, but doesn't really exist (row==-1 && col==-1).
+	 */
+	return;
+    }
+    if (mode & CELL) {
+	if (TableCellVCoords(tablePtr, row, col, &x, &y, &w, &h, 0)) {
+	    TableInvalidate(tablePtr, x, y, w, h, mode);
+	}
+    } else if (mode & ROW) {
+	/* get the position of the leftmost cell in the row */
+	if ((mode & INV_FILL) && row < tablePtr->topRow) {
+	    /* Invalidate whole table */
+	    TableInvalidateAll(tablePtr, mode);
+	} else if (TableCellVCoords(tablePtr, row, tablePtr->leftCol, &x, &y, &w, &h, 0)) {
+	    /* Invalidate from this row, maybe to end */
+	    TableInvalidate(tablePtr, 0, y, Tk_Width(tablePtr->tkwin),
+		    (mode&INV_FILL)?Tk_Height(tablePtr->tkwin):h, mode);
+	}
+    } else if (mode & COL) {
+	/* get the position of the topmost cell on the column */
+	if ((mode & INV_FILL) && col < tablePtr->leftCol) {
+	    /* Invalidate whole table */
+	    TableInvalidateAll(tablePtr, mode);
+	} else if (TableCellVCoords(tablePtr, tablePtr->topRow, col, &x, &y, &w, &h, 0)) {
+	    /* Invalidate from this column, maybe to end */
+	    TableInvalidate(tablePtr, x, 0, (mode&INV_FILL)?Tk_Width(tablePtr->tkwin):w,
+		    Tk_Height(tablePtr->tkwin), mode);
+	}
+    }
+}
 
-	    /*
-	     * First fill in a blank rectangle.
-	     */
-	    Tk_Fill3DRectangle(tkwin, window, tagPtr->bg, x, y, width, height, 0, TK_RELIEF_FLAT);
+/*
+ * The maximum number of GCs kept in the gcCache.  A table rarely
+ * shows more than a handful of distinct fg/bg/font combinations.
+ */
+#define GC_CACHE_MAX	64
 
-	    /*
-	     * Correct the dimensions to enforce padding constraints
-	     */
-	    width  -= bd[0] + bd[1] + (2 * padx);
-	    height -= bd[2] + bd[3] + (2 * pady);
+#define TableFreeGc	XFreeGC
 
-	    /*
-	     * Don't draw what won't be seen, based on border constraints.
-	     */
-	    if ((width <= 0) || (height <= 0)) {
-		/*
-		 * Re-Correct the dimensions before border drawing
-		 */
-		width  += bd[0] + bd[1] + (2 * padx);
-		height += bd[2] + bd[3] + (2 * pady);
-		goto DrawBorder;
-	    }
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetGc --
+ *	Gets a GC corresponding to the tag structure passed.  GCs are
+ *	kept in the gcCache by foreground, background and font, so
+ *	drawing a cell does not need to change a GC on the server.
+ *
+ * Results:
+ *	Returns usable GC owned by the gcCache, which must not be
+ *	freed by the caller.  Any clipping set on it must be reset.
+ *
+ * Side effects:
+ *	A GC may be created, or the gcCache flushed if it got too large.
+ *
+ *----------------------------------------------------------------------
+ */
+static GC TableGetGc(Table *tablePtr, Drawable d, TableTag *tagPtr) {
+    XGCValues gcValues;
+    TableGcKey key;
+    Tcl_HashEntry *entryPtr;
+    GC gc;
+    int new;
 
-	    /*
-	     * If an image is in the tag, draw it
-	     */
-	    if (tagPtr->image != NULL) {
-		Tk_SizeOfImage(tagPtr->image, &itemW, &itemH);
-		/* Handle anchoring of image in cell space */
-		switch (tagPtr->anchor) {
-		    case TK_ANCHOR_NW:
-		    case TK_ANCHOR_W:
-		    case TK_ANCHOR_SW:		/* western position */
-			originX = itemX = 0;
-			break;
-		    case TK_ANCHOR_N:
-		    case TK_ANCHOR_S:
-		    case TK_ANCHOR_CENTER:	/* centered position */
-			itemX	= MAX(0, (itemW - width) / 2);
-			originX	= MAX(0, (width - itemW) / 2);
-			break;
-		    default:			/* eastern position */
-			itemX	= MAX(0, itemW - width);
-			originX	= MAX(0, width - itemW);
-		}
-		switch (tagPtr->anchor) {
-		    case TK_ANCHOR_N:
-		    case TK_ANCHOR_NE:
-		    case TK_ANCHOR_NW:		/* northern position */
-			originY = itemY = 0;
-			break;
-		    case TK_ANCHOR_W:
-		    case TK_ANCHOR_E:
-		    case TK_ANCHOR_CENTER:	/* centered position */
-			itemY	= MAX(0, (itemH - height) / 2);
-			originY	= MAX(0, (height - itemH) / 2);
-			break;
-		    default:			/* southern position */
-			itemY	= MAX(0, itemH - height);
-			originY	= MAX(0, height - itemH);
-		}
-		Tk_RedrawImage(tagPtr->image, itemX, itemY,
-			MIN(itemW, width-originX), MIN(itemH, height-originY),
-			window, x + originX + bd[0] + padx,
-			y + originY + bd[2] + pady);
-		/*
-		 * If we don't want to display the text as well, then jump.
-		 */
-		if (tagPtr->showtext == 0) {
-		    /*
-		     * Re-Correct the dimensions before border drawing
-		     */
-		    width  += bd[0] + bd[1] + (2 * padx);
-		    height += bd[2] + bd[3] + (2 * pady);
-		    goto DrawBorder;
-		}
-	    }
+    memset((void *) &key, 0, sizeof(key));
+    key.fg	= Tk_3DBorderColor(tagPtr->fg)->pixel;
+    key.bg	= Tk_3DBorderColor(tagPtr->bg)->pixel;
+    key.font	= (unsigned long) Tk_FontId(tagPtr->tkfont);
 
-	    /*
-	     * Get the GC for this particular blend of tags.
-	     * This creates the GC if it never existed, otherwise it
-	     * modifies the one we have, so we only need the one
-	     */
-	    TableGetGc(display, window, tagPtr, &tagGc);
+    entryPtr = Tcl_FindHashEntry(tablePtr->gcCache, (char *) &key);
+    if (entryPtr != NULL) {
+	return (GC) Tcl_GetHashValue(entryPtr);
+    }
+    if (tablePtr->gcCache->numEntries >= GC_CACHE_MAX) {
+	TableFlushGcCache(tablePtr);
+    }
 
-	    /* if this is the active cell, use the buffer */
-	    if (activeCell) {
-		string = tablePtr->activeBuf;
-	    } else {
-		/* Is there a value in the cell? If so, draw it  */
-		string = TableGetCellValue(tablePtr, urow, ucol);
-	    }
+    gcValues.foreground = key.fg;
+    gcValues.background = key.bg;
+    gcValues.font = Tk_FontId(tagPtr->tkfont);
+    gcValues.graphics_exposures = False;
+    gc = XCreateGC(tablePtr->display, d,
+	    GCForeground|GCBackground|GCFont|GCGraphicsExposures, &gcValues);
+    entryPtr = Tcl_CreateHashEntry(tablePtr->gcCache, (char *) &key, &new);
+    Tcl_SetHashValue(entryPtr, (ClientData) gc);
+    return gc;
+}
 
-	    /*
-	     * We have to use strlen here because otherwise it stops
-	     * at the first \x00 unicode char it finds (!= '\0'),
-	     * although there can be more to the string than that
-	     */
-	    numChars = Tcl_NumUtfChars(string, (Tcl_Size) strlen(string));
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFlushGcCache --
+ *	Frees all GCs in the gcCache.  This must be called whenever a
+ *	font used by the table or its tags may have been released.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The gcCache is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableFlushGcCache(Table *tablePtr) {
+    Tcl_HashEntry *entryPtr;
+    Tcl_HashSearch search;
 
-	    /* If there is a string, show it */
-	    if (activeCell || numChars) {
-		int x0 = x + bd[0] + padx;
-		int y0 = y + bd[2] + pady;
+    if (tablePtr->gcCache->numEntries == 0) {
+	return;
+    }
+    for (entryPtr = Tcl_FirstHashEntry(tablePtr->gcCache, &search);
+	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	TableFreeGc(tablePtr->display, (GC) Tcl_GetHashValue(entryPtr));
+    }
+    Tcl_DeleteHashTable(tablePtr->gcCache);
+    Tcl_InitHashTable(tablePtr->gcCache, GC_KEY_WORDS);
+}
 
-		/* get the dimensions of the string */
-		textLayout = Tk_ComputeTextLayout(tagPtr->tkfont,
-			string, numChars, (tagPtr->wrap > 0) ? width : 0, tagPtr->justify,
-			(tagPtr->multiline > 0) ? 0 : TK_IGNORE_NEWLINES, &itemW, &itemH);
+/*
+ *--------------------------------------------------------------
+ *
+ * TableUndisplay --
+ *	This procedure removes the contents of a table window
+ *	that have been moved offscreen.
+ *
+ * Results:
+ *	Embedded windows can be unmapped.
+ *
+ * Side effects:
+ *	Information disappears from the screen.
+ *
+ *--------------------------------------------------------------
+ */
+static void TableUndisplay(Table *tablePtr) {
+    int *seen = tablePtr->seen;
+    int row, col;
 
-		/*
-		 * Set the origin coordinates of the string to draw using
-		 * the anchor.  origin represents the (x,y) coordinate of
-		 * the lower left corner of the text box, relative to the
-		 * internal (inside the border) window
-		 */
+    /* We need to find out the true last cell, not considering spans */
+    tablePtr->flags |= AVOID_SPANS;
+    TableGetLastCell(tablePtr, &row, &col);
+    tablePtr->flags &= ~AVOID_SPANS;
 
-		/* set the X origin first */
-		switch (tagPtr->anchor) {
-		    case TK_ANCHOR_NW:
-		    case TK_ANCHOR_W:
-		    case TK_ANCHOR_SW:		/* western position */
+    if (seen[0] != -1) {
+	if (seen[0] < tablePtr->topRow) {
+	    /* Remove now hidden rows */
+	    EmbWinUnmap(tablePtr, seen[0], MIN(seen[2],tablePtr->topRow-1), seen[1], seen[3]);
+	    /* Also account for the title area */
+	    EmbWinUnmap(tablePtr, seen[0], MIN(seen[2],tablePtr->topRow-1), 0, tablePtr->titleCols-1);
+	}
+	if (seen[1] < tablePtr->leftCol) {
+	    /* Remove now hidden cols */
+	    EmbWinUnmap(tablePtr, seen[0], seen[2], seen[1], MAX(seen[3],tablePtr->leftCol-1));
+	    /* Also account for the title area */
+	    EmbWinUnmap(tablePtr, 0, tablePtr->titleRows-1, seen[1], MAX(seen[3],tablePtr->leftCol-1));
+	}
+	if (seen[2] > row) {
+	    /* Remove now off-screen rows */
+	    EmbWinUnmap(tablePtr, MAX(seen[0],row+1), seen[2], seen[1], seen[3]);
+	    /* Also account for the title area */
+	    EmbWinUnmap(tablePtr, MAX(seen[0],row+1), seen[2], 0, tablePtr->titleCols-1);
+	}
+	if (seen[3] > col) {
+	    /* Remove now off-screen cols */
+	    EmbWinUnmap(tablePtr, seen[0], seen[2], MAX(seen[1],col+1), seen[3]);
+	    /* Also account for the title area */
+	    EmbWinUnmap(tablePtr, 0, tablePtr->titleRows-1, MAX(seen[1],col+1), seen[3]);
+	}
+    }
+    seen[0] = tablePtr->topRow;
+    seen[1] = tablePtr->leftCol;
+    seen[2] = row;
+    seen[3] = col;
+}
+
+/*
+ * The maximum number of text layouts kept in the layoutCache.  This
+ * is well above the number of cells a typical window shows at once.
+ */
+#define LAYOUT_CACHE_MAX	4096
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFlushFitCache --
+ *	Frees all fitted text in the fitCache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The fitCache is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableFlushFitCache(Table *tablePtr) {
+    Tcl_HashEntry *entryPtr;
+    Tcl_HashSearch search;
+
+    if (tablePtr->fitCache->numEntries == 0) {
+	return;
+    }
+    for (entryPtr = Tcl_FirstHashEntry(tablePtr->fitCache, &search);
+	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	Tcl_Free((char *) Tcl_GetHashValue(entryPtr));
+    }
+    Tcl_DeleteHashTable(tablePtr->fitCache);
+    Tcl_InitHashTable(tablePtr->fitCache, TCL_STRING_KEYS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFlushLayoutCache --
+ *	Frees all text layouts in the layoutCache, and all fitted text
+ *	in the fitCache.  This must be called
+ *	whenever a font used by the table may have changed or been freed.
+ *	The cell signatures of the backing pixmap are dropped as well.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	The layoutCache is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableFlushLayoutCache(Table *tablePtr) {
+    Tcl_HashEntry *entryPtr;
+    Tcl_HashSearch search;
+    TableLayout *lPtr;
+
+    /* the cell signatures refer to the same fonts and colors */
+    TableFlushCellSigs(tablePtr);
+    TableFlushFitCache(tablePtr);
+    if (tablePtr->layoutCache->numEntries == 0) {
+	return;
+    }
+    for (entryPtr = Tcl_FirstHashEntry(tablePtr->layoutCache, &search);
+	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	lPtr = (TableLayout *) Tcl_GetHashValue(entryPtr);
+	Tk_FreeTextLayout(lPtr->layout);
+	Tcl_Free((char *) lPtr);
+    }
+    Tcl_DeleteHashTable(tablePtr->layoutCache);
+    Tcl_InitHashTable(tablePtr->layoutCache, TCL_STRING_KEYS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetTextLayout --
+ *	Returns the text layout for a cell string displayed with the
+ *	given tag in a cell of the given width.  Layouts are cached by
+ *	font, wrap width, justify, multiline and string, so unchanged
+ *	text does not need to be laid out again on each redraw.
+ *
+ * Results:
+ *	A text layout owned by the layoutCache, which must not be freed
+ *	by the caller.  Its dimensions are stored in widthPtr/heightPtr.
+ *
+ * Side effects:
+ *	The layoutCache may grow, or be flushed if it got too large.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tk_TextLayout TableGetTextLayout(Table *tablePtr, TableTag *tagPtr, char *string,
+	Tcl_Size numChars, int width, int *widthPtr, int *heightPtr) {
+    Tcl_HashEntry *entryPtr;
+    TableLayout *lPtr;
+    Tcl_DString key;
+    char buf[3*INDEX_BUFSIZE];
+    int new, prefixLen, wrapLength, flags;
+
+    wrapLength	= (tagPtr->wrap > 0) ? width : 0;
+    flags	= (tagPtr->multiline > 0) ? 0 : TK_IGNORE_NEWLINES;
+
+    Tcl_DStringInit(&key);
+    Tcl_DStringAppend(&key, Tk_NameOfFont(tagPtr->tkfont), -1);
+    sprintf(buf, "\t%d,%d,%d\t", wrapLength, (int) tagPtr->justify, flags);
+    Tcl_DStringAppend(&key, buf, -1);
+    prefixLen = Tcl_DStringLength(&key);
+    Tcl_DStringAppend(&key, string, -1);
+
+    entryPtr = Tcl_FindHashEntry(tablePtr->layoutCache, Tcl_DStringValue(&key));
+    if (entryPtr == NULL) {
+	if (tablePtr->layoutCache->numEntries >= LAYOUT_CACHE_MAX) {
+	    TableFlushLayoutCache(tablePtr);
+	}
+	entryPtr = Tcl_CreateHashEntry(tablePtr->layoutCache, Tcl_DStringValue(&key), &new);
+	lPtr = (TableLayout *) Tcl_Alloc(sizeof(TableLayout));
+	/*
+	 * The layout keeps pointers into the string it was computed from,
+	 * so lay out the copy of the string held in the hash key.
+	 */
+	lPtr->layout = Tk_ComputeTextLayout(tagPtr->tkfont,
+		(char *) Tcl_GetHashKey(tablePtr->layoutCache, entryPtr) + prefixLen,
+		numChars, wrapLength, tagPtr->justify, flags, &(lPtr->width), &(lPtr->height));
+	Tcl_SetHashValue(entryPtr, (ClientData) lPtr);
+    } else {
+	lPtr = (TableLayout *) Tcl_GetHashValue(entryPtr);
+    }
+    Tcl_DStringFree(&key);
+
+    *widthPtr  = lPtr->width;
+    *heightPtr = lPtr->height;
+    return lPtr->layout;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableDrawText --
+ *	Draws cell text with its text layout, or as a single line with
+ *	Tk_DrawChars for text that was measured without a layout.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Text is drawn with its top left corner at x,y.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableDrawText(Display *display, Drawable drawable, GC gc,
+	Tk_Font tkfont, Tk_TextLayout layout, const char *string, int length,
+	int x, int y) {
+    Tk_FontMetrics fm;
+
+    if (layout != NULL) {
+	Tk_DrawTextLayout(display, drawable, gc, layout, x, y, 0, -1);
+    } else {
+	Tk_GetFontMetrics(tkfont, &fm);
+	Tk_DrawChars(display, drawable, gc, tkfont, string, length, x, y + fm.ascent);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFitText --
+ *	Finds the part of a single line of cell text that fits in
+ *	maxWidth pixels: the longest prefix, or with fromEnd the longest
+ *	suffix.  The prefix is measured by Tk_MeasureChars directly,
+ *	the suffix by a binary search over its start.  Results are
+ *	cached by font, maxWidth, side and string, so a clipped cell is
+ *	only fitted once.
+ *
+ * Results:
+ *	The byte offset and length of the fitting part are stored in
+ *	startPtr/lengthPtr, and its width in pixels in widthPtr.
+ *
+ * Side effects:
+ *	The fitCache may grow, or be flushed if it got too large.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableFitText(Table *tablePtr, Tk_Font tkfont, char *string,
+	TableValueInfo *infoPtr, int maxWidth, int fromEnd,
+	int *startPtr, int *lengthPtr, int *widthPtr) {
+    Tcl_HashEntry *entryPtr;
+    TableFit *fitPtr;
+    Tcl_DString key;
+    char buf[3*INDEX_BUFSIZE];
+    const char *p;
+    int new, low, high, mid, byteLen = infoPtr->length;
+
+    Tcl_DStringInit(&key);
+    Tcl_DStringAppend(&key, Tk_NameOfFont(tkfont), -1);
+    sprintf(buf, "\t%d,%d\t", maxWidth, fromEnd);
+    Tcl_DStringAppend(&key, buf, -1);
+    Tcl_DStringAppend(&key, string, byteLen);
+
+    entryPtr = Tcl_FindHashEntry(tablePtr->fitCache, Tcl_DStringValue(&key));
+    if (entryPtr == NULL) {
+	if (tablePtr->fitCache->numEntries >= LAYOUT_CACHE_MAX) {
+	    TableFlushFitCache(tablePtr);
+	}
+	fitPtr	= (TableFit *) Tcl_Alloc(sizeof(TableFit));
+	if (maxWidth <= 0) {
+	    fitPtr->start  = fromEnd ? byteLen : 0;
+	    fitPtr->length = fitPtr->width = 0;
+	} else if (!fromEnd) {
+	    fitPtr->start  = 0;
+	    fitPtr->length = Tk_MeasureChars(tkfont, string, byteLen, maxWidth, 0,
+		    &(fitPtr->width));
+	} else {
+	    /* find the first char from which the rest fits */
+	    low = 0;
+	    high = infoPtr->numChars;
+	    while (low < high) {
+		mid = (low + high) / 2;
+		p = string + TableValueOffset(string, infoPtr, mid);
+		if (Tk_TextWidth(tkfont, p, byteLen - (int) (p - string)) <= maxWidth) {
+		    high = mid;
+		} else {
+		    low = mid + 1;
+		}
+	    }
+	    p = string + TableValueOffset(string, infoPtr, low);
+	    fitPtr->start  = (int) (p - string);
+	    fitPtr->length = byteLen - fitPtr->start;
+	    fitPtr->width  = Tk_TextWidth(tkfont, p, fitPtr->length);
+	}
+	entryPtr = Tcl_CreateHashEntry(tablePtr->fitCache, Tcl_DStringValue(&key), &new);
+	Tcl_SetHashValue(entryPtr, (ClientData) fitPtr);
+    } else {
+	fitPtr = (TableFit *) Tcl_GetHashValue(entryPtr);
+    }
+    Tcl_DStringFree(&key);
+
+    *startPtr  = fitPtr->start;
+    *lengthPtr = fitPtr->length;
+    *widthPtr  = fitPtr->width;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableBudgetSpent --
+ *	Checks whether the current TableDisplay has used up the time
+ *	given by -renderbudget.
+ *
+ * Results:
+ *	1 if the budget is spent, 0 if not or there is no budget,
+ *	as for snapshots and the flush method.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableBudgetSpent(Table *tablePtr) {
+    Tcl_Time now;
+    Tcl_WideInt elapsed;
+
+    if ((tablePtr->renderBudget <= 0) || (tablePtr->flags & (SNAPSHOT|FLUSHING))) {
+	return 0;
+    }
+    Tcl_GetTime(&now);
+    elapsed = ((Tcl_WideInt) now.sec - tablePtr->renderStart.sec) * 1000
+	+ ((Tcl_WideInt) now.usec - tablePtr->renderStart.usec) / 1000;
+    return (elapsed >= tablePtr->renderBudget);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableSaveCursor --
+ *	Remembers where the insert cursor of the active cell goes and
+ *	what lies beneath it, so that TableBlinkCursor can switch the
+ *	cursor on and off without redrawing the cell.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May allocate tablePtr->cursorSave.  Sets cursorValid.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableSaveCursor(Table *tablePtr, Drawable window,
+	TableRect *cursorPtr, TableRect *cellPtr, TableRect *innerPtr) {
+    int x = MAX(cursorPtr->x, innerPtr->x);
+    int y = MAX(cursorPtr->y, innerPtr->y);
+    int w = MIN(cursorPtr->x + cursorPtr->width, innerPtr->x + innerPtr->width) - x;
+    int h = MIN(cursorPtr->y + cursorPtr->height, innerPtr->y + innerPtr->height) - y;
+
+    if (w <= 0 || h <= 0) {
+	return;
+    }
+    if ((tablePtr->cursorSave == None)
+	    || (tablePtr->cursorSaveWidth < w) || (tablePtr->cursorSaveHeight < h)) {
+	if (tablePtr->cursorSave != None) {
+	    Tk_FreePixmap(tablePtr->display, tablePtr->cursorSave);
+	}
+	tablePtr->cursorSaveWidth  = w;
+	tablePtr->cursorSaveHeight = h;
+	tablePtr->cursorSave = Tk_GetPixmap(tablePtr->display,
+		Tk_WindowId(tablePtr->tkwin), w, h, Tk_Depth(tablePtr->tkwin));
+    }
+    XCopyArea(tablePtr->display, window, tablePtr->cursorSave,
+	    Tk_3DBorderGC(tablePtr->tkwin, tablePtr->defaultTag.bg, TK_3D_FLAT_GC),
+	    x, y, (unsigned) w, (unsigned) h, 0, 0);
+    tablePtr->cursorRect.x	= x;
+    tablePtr->cursorRect.y	= y;
+    tablePtr->cursorRect.width	= w;
+    tablePtr->cursorRect.height	= h;
+    tablePtr->cursorCell	= *cellPtr;
+    tablePtr->cursorValid	= 1;
+}
+
+/*
+ * Generally we should be able to use XSetClipRectangles on X11, but
+ * the addition of Xft drawing to Tk 8.5+ completely ignores the clip
+ * rectangles.  Thus turn it off for all cases until clip rectangles
+ * are known to be respected. [Bug 1805350]
+ */
+#if !defined(MAC_OSX_TK)
+#define NO_XSETCLIP
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetScratchPixmap --
+ *	Returns one of the scratch pixmaps of the table (*pixPtr, of
+ *	size *widthPtr x *heightPtr).  It is kept across redisplays and
+ *	only reallocated when it is smaller than the area it must cover.
+ *
+ * Results:
+ *	A pixmap of at least width x height, owned by the table.
+ *
+ * Side effects:
+ *	May allocate a new pixmap.
+ *
+ *----------------------------------------------------------------------
+ */
+static Pixmap TableGetScratchPixmap(Table *tablePtr, Pixmap *pixPtr,
+	int *widthPtr, int *heightPtr, int width, int height) {
+    if ((*pixPtr == None) || (*widthPtr < width) || (*heightPtr < height)) {
+	if (*pixPtr != None) {
+	    Tk_FreePixmap(tablePtr->display, *pixPtr);
+	}
+	*widthPtr  = MAX(MAX(1, width), *widthPtr);
+	*heightPtr = MAX(MAX(1, height), *heightPtr);
+	*pixPtr = Tk_GetPixmap(tablePtr->display, Tk_WindowId(tablePtr->tkwin),
+		*widthPtr, *heightPtr, Tk_Depth(tablePtr->tkwin));
+    }
+    return *pixPtr;
+}
+/*
+ *--------------------------------------------------------------
+ *
+ * TableDisplayRect --
+ *	This procedure redraws the cells of a table window that
+ *	intersect one invalid rectangle.
+ *	The conditional code in this function is due to these factors:
+ *		o Lack of XSetClipRectangles on Macintosh
+ *		o Use of alternative routine for Windows
+ *
+ * Results:
+ *	1 if the -renderbudget ran out before all rows were drawn, in
+ *	which case the part left to draw is stored in restPtr, else 0.
+ *
+ * Side effects:
+ *	Information appears on the screen.  Drawn cells are recorded
+ *	with TableMarkDrawn, so a cell spanning several rectangles of
+ *	the same TableDisplay pass is only drawn once.
+ *
+ *--------------------------------------------------------------
+ */
+static int TableDisplayRect(Table *tablePtr, Drawable window,
+	int rectX, int rectY, int rectWidth, int rectHeight, TableRect *restPtr) {
+    Tk_Window tkwin = tablePtr->tkwin;
+    Display *display = tablePtr->display;
+#ifdef NO_XSETCLIP
+    Drawable clipWind;
+#elif defined(_WIN32)
+    TkWinDrawable *twdPtr;
+    HDC dc;
+    HRGN clipR;
+#else
+    XRectangle clipRect;
+#endif
+    int rowFrom, rowTo, colFrom, colTo, invalidX, invalidY, invalidWidth, invalidHeight,
+	x, y, width, height, itemX, itemY, itemW, itemH,
+	row, col, urow, ucol, hrow=0, hcol=0, cx, cy, cw, ch, borders, bd[6],
+	rs, cs, boundW, boundH, maxW, maxH, cellType,
+	originX, originY, activeCell, styleState, ipadx, ipady, padx, pady;
+    Tcl_Size numChars;
+    GC tagGc, topGc, bottomGc;
+    char *string = NULL;
+    char buf[INDEX_BUFSIZE];
+    TableTag *tagPtr = NULL, *cellPtr, *rowPtr, *colPtr;
+    Tcl_HashEntry *entryPtr;
+    XPoint rect[3];
+    Tk_TextLayout textLayout = NULL;
+    int cachedLayout = 0;
+    TableEmbWindow *ewPtr;
+    Tk_FontMetrics fm, lineFm;
+    Tk_Font ellFont = NULL;
+    char *ellipsis = NULL;
+    int ellLen = 0, useEllLen = 0, ellEast = 0;
+    int titleX, titleY, clipX = 0, clipY = 0;
+    TableCellSig *sigPtr;
+    int useSigs, sigUse, haveString, batch, spans, fillY, stopped = 0;
+    TableValueInfo valInfo;
+    Drawable passWindow = window;
+#ifndef _WIN32
+    Drawable cellWindow = None;
+    int cellX = 0, cellY = 0;
+#endif
+
+    boundW = Tk_Width(tkwin) - tablePtr->highlightWidth;
+    boundH = Tk_Height(tkwin) - tablePtr->highlightWidth;
+
+    /* Constrain drawable to not include highlight borders */
+    invalidX = MAX(tablePtr->highlightWidth, rectX);
+    invalidY = MAX(tablePtr->highlightWidth, rectY);
+    invalidWidth  = MIN(rectWidth - (invalidX - rectX), MAX(1, boundW-invalidX));
+    invalidHeight = MIN(rectHeight - (invalidY - rectY), MAX(1, boundH-invalidY));
+    if (invalidWidth <= 0 || invalidHeight <= 0) {
+	return 0;
+    }
+
+    /* the fast and single drawmodes batch fills and borders per GC */
+    batch = (tablePtr->drawMode & (DRAW_MODE_FAST|DRAW_MODE_SINGLE)) != 0;
+    spans = (tablePtr->spanTbl && tablePtr->spanTbl->numEntries);
+
+    /*
+     * Without spans, cells drawn into the backing pixmap are recorded.
+     * Batching fills cells before they are checked, so it can't skip any.
+     */
+    useSigs = (window == tablePtr->backPixmap) && !batch && !spans;
+
+    ipadx = tablePtr->ipadX;
+    ipady = tablePtr->ipadY;
+    padx  = tablePtr->padX;
+    pady  = tablePtr->padY;
+
+    /* where the scrolled area starts, past the title rows and cols */
+    titleX = tablePtr->highlightWidth + (int) tablePtr->colStarts[tablePtr->titleCols];
+    titleY = tablePtr->highlightWidth + (int) tablePtr->rowStarts[tablePtr->titleRows];
+
+#ifdef NO_XSETCLIP
+    /*
+     * Ensure clipWind is large enough for changed cell, which at the
+     * extreme is the full displayed window size.
+     */
+    clipWind = TableGetScratchPixmap(tablePtr, &(tablePtr->clipPixmap),
+	    &(tablePtr->clipWidth), &(tablePtr->clipHeight), boundW, boundH);
+#endif
+
+    /* We need to find out the true cell span, not considering spans */
+    tablePtr->flags |= AVOID_SPANS;
+    /* find out the cells represented by the invalid region */
+    TableWhatCell(tablePtr, invalidX, invalidY, &rowFrom, &colFrom);
+    TableWhatCell(tablePtr, invalidX+invalidWidth-1, invalidY+invalidHeight-1, &rowTo, &colTo);
+    tablePtr->flags &= ~AVOID_SPANS;
+
+    /*
+     * Create the tag here.  This will actually create a JoinTag
+     * That will handle the priority management of merging for us.
+     * We only need one allocated, and we'll reset it for each cell.
+     */
+    tagPtr = TableNewTag(tablePtr);
+
+    /*
+     * When batching, the area is filled with the default background
+     * so cells that use it need not be filled one by one.  This is
+     * done a row band at a time, so rows left undrawn by the render
+     * budget keep their pixels, except that spans reaching into later
+     * rows need the whole area filled at once.
+     */
+    fillY = invalidY;
+    if (batch && spans) {
+	XFillRectangle(display, window,
+		Tk_3DBorderGC(tkwin, tablePtr->defaultTag.bg, TK_3D_FLAT_GC),
+		invalidX, invalidY, (unsigned) invalidWidth, (unsigned) invalidHeight);
+	fillY = invalidY + invalidHeight;
+    }
+
+    /* Cycle through the cells and display them */
+    for (row = rowFrom; row <= rowTo; row++) {
+	/*
+	 * are we in the 'dead zone' between the
+	 * title rows and the first displayed row
+	 */
+	if (row < tablePtr->topRow && row >= tablePtr->titleRows) {
+	    row = tablePtr->topRow;
+	}
+
+	if (batch && fillY < invalidY + invalidHeight) {
+	    /* the last band also covers the area past the last row */
+	    y = invalidY + invalidHeight;
+	    if (row < rowTo) {
+		tablePtr->flags |= AVOID_SPANS;
+		TableCellCoords(tablePtr, row, 0, &x, &y, &width, &height);
+		tablePtr->flags &= ~AVOID_SPANS;
+		y = MIN(y + height, invalidY + invalidHeight);
+	    }
+	    if (y > fillY) {
+		XFillRectangle(display, window,
+			Tk_3DBorderGC(tkwin, tablePtr->defaultTag.bg, TK_3D_FLAT_GC),
+			invalidX, fillY, (unsigned) invalidWidth, (unsigned) (y - fillY));
+		fillY = y;
+	    }
+	}
+
+	/* Cache the row in user terms */
+	urow = row+tablePtr->rowOffset;
+
+	/* Get the row tag once for all iterations of col */
+	rowPtr = FindRowColTag(tablePtr, urow, ROW);
+
+	for (col = colFrom; col <= colTo; col++) {
+	    activeCell = 0;
+	    /*
+	     * Adjust to first viewable column if we are in the 'dead zone'
+	     * between the title cols and the first displayed column.
+	     */
+	    if (col < tablePtr->leftCol && col >= tablePtr->titleCols) {
+		col = tablePtr->leftCol;
+	    }
+
+	    /*
+	     * Skip positions this pass already drew, for another
+	     * rectangle or as part of a span.
+	     */
+	    if (TableCellDrawn(tablePtr, row, col)) {
+		continue;
+	    }
+
+	    /*
+	     * Get the coordinates for the cell before possible rearrangement
+	     * of row,col due to spanning cells
+	     */
+	    cellType = TableCellCoords(tablePtr, row, col, &x, &y, &width, &height);
+	    if (cellType == CELL_HIDDEN) {
+		/* width,height holds the real start row,col of the span */
+		hrow = row; hcol = col;
+		row = width-tablePtr->rowOffset;
+		col = height-tablePtr->colOffset;
+		TableCellVCoords(tablePtr, row, col, &x, &y, &width, &height, 0);
+		/* We have to adjust the coords back onto the visual display */
+		urow = row+tablePtr->rowOffset;
+		rowPtr = FindRowColTag(tablePtr, urow, ROW);
+	    }
+
+	    /* Constrain drawn size to the visual boundaries */
+	    if (tablePtr->colStretch == STRETCH_MODE_NONE) {
+		if (x >= boundW && width > boundW - x) {
+		    width = boundW - x;
+		}
+	    } else {
+		if (width > boundW - x) {
+		    width = boundW - x;
+		}
+	    }
+	    if (tablePtr->rowStretch == STRETCH_MODE_NONE) {
+		if (y >= boundH && height > boundH - y) {
+		    height = boundH - y;
+		}
+	    } else {
+		if (height > boundH - y) {
+		    height = boundH - y;
+		}
+	    }
+
+	    /*
+	     * A partially scrolled leftCol or topRow must not paint
+	     * over the titles, so work out how much of it is hidden.
+	     */
+	    clipX = clipY = 0;
+	    if (cellType != CELL_HIDDEN) {
+		if (col >= tablePtr->titleCols && x < titleX) {
+		    clipX = MIN(width, titleX - x);
+		}
+		if (row >= tablePtr->titleRows && y < titleY) {
+		    clipY = MIN(height, titleY - y);
+		}
+	    }
+
+	    /* Cache the col in user terms */
+	    ucol = col+tablePtr->colOffset;
+
+	    /* put the use cell ref into a buffer for the hash lookups */
+	    TableMakeArrayIndex(urow, ucol, buf);
+
+	    /* Record the positions this draws, all of them for a span */
+	    rs = cs = 0;
+	    if (cellType & (CELL_SPAN|CELL_HIDDEN)) {
+		entryPtr = Tcl_FindHashEntry(tablePtr->spanTbl, buf);
+		if (entryPtr != NULL) {
+		    TableParseArrayIndex(&rs, &cs, (char *) Tcl_GetHashValue(entryPtr));
+		}
+	    }
+	    TableMarkDrawn(tablePtr, row, col, rs, cs);
+
+	    /* the slot recording how this position was drawn */
+	    sigPtr = useSigs ? TableGetCellSig(tablePtr, row, col) : NULL;
+	    sigUse = 0;
+	    haveString = 0;
+
+	    /*
+	     * Check to see if we have an embedded window in this cell.
+	     */
+	    entryPtr = Tcl_FindHashEntry(tablePtr->winTable, buf);
+	    if (entryPtr != NULL) {
+		ewPtr = (TableEmbWindow *) Tcl_GetHashValue(entryPtr);
+
+		if (ewPtr->tkwin != NULL) {
+		    /* Display embedded window instead of text */
+
+		    /*
+		     * Make sure we start with a clean tag (set to table defaults).
+		     */
+		    TableResetTag(tablePtr, tagPtr);
+
+		    /* if active, make it disabled to avoid
+		     * unnecessary editing */
+		    if ((tablePtr->flags & HAS_ACTIVE) && row == tablePtr->activeRow
+			    && col == tablePtr->activeCol) {
+			tablePtr->flags |= ACTIVE_DISABLED;
+		    }
+
+		    /* embedded windows can't be clipped, only shrunk */
+		    x += clipX; width -= clipX;
+		    y += clipY; height -= clipY;
+		    clipX = clipY = 0;
+
+		    /*
+		     * The EmbWinDisplay function may modify values in
+		     * tagPtr, so reference those after this call.
+		     */
+		    if (!(tablePtr->flags & SNAPSHOT)) {
+			/* a snapshot must not move the window */
+			EmbWinDisplay(tablePtr, window, ewPtr, tagPtr, x, y, width, height);
+		    }
+
+		    Tk_Fill3DRectangle(tkwin, window, tagPtr->bg, x, y, width, height, 0,
+			TK_RELIEF_FLAT);
+
+		    /* border width for cell should now be properly set */
+		    borders = TableGetTagBorders(tagPtr, &bd[0], &bd[1], &bd[2], &bd[3]);
+		    bd[4] = (bd[0] + bd[1])/2;
+		    bd[5] = (bd[2] + bd[3])/2;
+
+		    goto DrawBorder;
+		}
+	    }
+
+#ifdef _WIN32
+	    /* no clipping pixmap on Win32 (see SLOW mode), shrink the cell */
+	    x += clipX; width -= clipX;
+	    y += clipY; height -= clipY;
+	    clipX = clipY = 0;
+#endif
+
+	    /*
+	     * Don't draw what won't be seen.
+	     * Embedded windows handle this in EmbWinDisplay.
+	     */
+	    if ((width <= clipX) || (height <= clipY)) { continue; }
+
+#ifndef _WIN32
+	    /*
+	     * Draw a partially hidden cell on the cell scratch pixmap and
+	     * copy over only the visible part once done (after the borders).
+	     */
+	    if (clipX || clipY) {
+		cellWindow = window;
+		cellX = x;
+		cellY = y;
+		window = TableGetScratchPixmap(tablePtr, &(tablePtr->cellPixmap),
+			&(tablePtr->cellPixWidth), &(tablePtr->cellPixHeight),
+			width, height);
+		x = y = 0;
+	    }
+#endif
+
+	    /*
+	     * Get the combined tag structure for the cell.  Collect the
+	     * col, row and cell tags and the state of the cell, then let
+	     * TableResolveTag merge them (or reuse an earlier merge of
+	     * the same combination).
+	     */
+	    styleState = 0;
+
+	    /* colPtr is looked up once per pass */
+	    colPtr = TableGetColTag(tablePtr, col);
+	    /* Am I in the titles */
+	    if (row < tablePtr->titleRows || col < tablePtr->titleCols) {
+		styleState |= STYLE_TITLE;
+	    }
+	    /* Does this have a cell tag (kept by data index) */
+	    if (tablePtr->rowPerm != NULL || tablePtr->colPerm != NULL ||
+		    tablePtr->rowFilter != NULL) {
+		char dataBuf[INDEX_BUFSIZE];
+		TableMakeDataIndex(tablePtr, urow, ucol, dataBuf);
+		entryPtr = Tcl_FindHashEntry(tablePtr->cellStyles, dataBuf);
+	    } else {
+		entryPtr = Tcl_FindHashEntry(tablePtr->cellStyles, buf);
+	    }
+	    cellPtr = (entryPtr != NULL) ?
+		(TableTag *) Tcl_GetHashValue(entryPtr) : (TableTag *) NULL;
+	    /* is this cell active? */
+	    if ((tablePtr->flags & HAS_ACTIVE) && (tablePtr->state == STATE_NORMAL) &&
+		    row == tablePtr->activeRow && col == tablePtr->activeCol) {
+		styleState |= STYLE_ACTIVE;
+	    }
+	    /* is this cell selected? */
+	    if (Tcl_FindHashEntry(tablePtr->selCells, buf) != NULL) {
+		styleState |= STYLE_SEL;
+	    }
+	    /* if flash mode is on, is this cell flashing? */
+	    if (tablePtr->flashMode && TableFindFlash(tablePtr, urow, ucol) != NULL) {
+		styleState |= STYLE_FLASH;
+	    }
+
+	    styleState = TableResolveTag(tablePtr, tagPtr, colPtr, rowPtr,
+		    cellPtr, styleState);
+	    if ((styleState & STYLE_DISABLED) || ((styleState & STYLE_ACTIVE)
+		    && TableIsFilterEmptyRow(tablePtr, row))) {
+		/* the empty row of a filter that hides all rows is read-only */
+		tablePtr->flags |= ACTIVE_DISABLED;
+	    } else if (styleState & STYLE_ACTIVE) {
+		activeCell = 1;
+		tablePtr->flags &= ~ACTIVE_DISABLED;
+		/* the remembered cursor spot is redrawn now */
+		tablePtr->cursorValid = 0;
+	    }
+
+	    /*
+	     * Skip the cell if the backing pixmap already shows it this way.
+	     * The active cell, images and clipped cells are always drawn.
+	     */
+	    if (sigPtr != NULL && !activeCell && !clipX && !clipY
+		    && tagPtr->image == NULL) {
+		string = TableGetCellValueInfo(tablePtr, urow, ucol, &valInfo);
+		if (TableCheckCellSig(sigPtr, x, y, width, height, tagPtr, string,
+			(size_t) valInfo.length)) {
+		    goto NextCell;
+		}
+		sigUse = haveString = 1;
+	    }
+
+	    /*
+	     * Borders for cell should now be properly set
+	     */
+	    borders = TableGetTagBorders(tagPtr, &bd[0], &bd[1], &bd[2], &bd[3]);
+	    bd[4] = (bd[0] + bd[1])/2;
+	    bd[5] = (bd[2] + bd[3])/2;
+
+	    /*
+	     * First fill in a blank rectangle.  When batching, cells with
+	     * the default background are already filled, and the fill of
+	     * an empty cell can wait until the end of the pass.
+	     */
+	    if (!batch || window != passWindow) {
+		Tk_Fill3DRectangle(tkwin, window, tagPtr->bg, x, y, width, height, 0,
+			TK_RELIEF_FLAT);
+	    } else if (tagPtr->bg != tablePtr->defaultTag.bg) {
+		if (!activeCell && tagPtr->image == NULL) {
+		    string = TableGetCellValueInfo(tablePtr, urow, ucol, &valInfo);
+		    haveString = 1;
+		}
+		if (haveString && *string == '\0') {
+		    TableBatchFill(tablePtr, Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_FLAT_GC),
+			    x, y, width, height);
+		} else {
+		    Tk_Fill3DRectangle(tkwin, window, tagPtr->bg, x, y, width, height, 0,
+			    TK_RELIEF_FLAT);
+		}
+	    }
+
+	    /*
+	     * Correct the dimensions to enforce padding constraints
+	     */
+	    width  -= bd[0] + bd[1] + (2 * padx);
+	    height -= bd[2] + bd[3] + (2 * pady);
+
+	    /*
+	     * Don't draw what won't be seen, based on border constraints.
+	     */
+	    if ((width <= 0) || (height <= 0)) {
+		/*
+		 * Re-Correct the dimensions before border drawing
+		 */
+		width  += bd[0] + bd[1] + (2 * padx);
+		height += bd[2] + bd[3] + (2 * pady);
+		goto DrawBorder;
+	    }
+
+	    /*
+	     * If an image is in the tag, draw it
+	     */
+	    if (tagPtr->image != NULL) {
+		Tk_SizeOfImage(tagPtr->image, &itemW, &itemH);
+		/* Handle anchoring of image in cell space */
+		switch (tagPtr->anchor) {
+		    case TK_ANCHOR_NW:
+		    case TK_ANCHOR_W:
+		    case TK_ANCHOR_SW:		/* western position */
+			originX = itemX = 0;
+			break;
+		    case TK_ANCHOR_N:
+		    case TK_ANCHOR_S:
+		    case TK_ANCHOR_CENTER:	/* centered position */
+			itemX	= MAX(0, (itemW - width) / 2);
+			originX	= MAX(0, (width - itemW) / 2);
+			break;
+		    default:			/* eastern position */
+			itemX	= MAX(0, itemW - width);
+			originX	= MAX(0, width - itemW);
+		}
+		switch (tagPtr->anchor) {
+		    case TK_ANCHOR_N:
+		    case TK_ANCHOR_NE:
+		    case TK_ANCHOR_NW:		/* northern position */
+			originY = itemY = 0;
+			break;
+		    case TK_ANCHOR_W:
+		    case TK_ANCHOR_E:
+		    case TK_ANCHOR_CENTER:	/* centered position */
+			itemY	= MAX(0, (itemH - height) / 2);
+			originY	= MAX(0, (height - itemH) / 2);
+			break;
+		    default:			/* southern position */
+			itemY	= MAX(0, itemH - height);
+			originY	= MAX(0, height - itemH);
+		}
+		Tk_RedrawImage(tagPtr->image, itemX, itemY,
+			MIN(itemW, width-originX), MIN(itemH, height-originY),
+			window, x + originX + bd[0] + padx,
+			y + originY + bd[2] + pady);
+		/*
+		 * If we don't want to display the text as well, then jump.
+		 */
+		if (tagPtr->showtext == 0) {
+		    /*
+		     * Re-Correct the dimensions before border drawing
+		     */
+		    width  += bd[0] + bd[1] + (2 * padx);
+		    height += bd[2] + bd[3] + (2 * pady);
+		    goto DrawBorder;
+		}
+	    }
+
+	    /*
+	     * Get the GC for this particular blend of tags.
+	     * This creates the GC if it never existed, otherwise it
+	     * reuses the cached one
+	     */
+	    tagGc = TableGetGc(tablePtr, window, tagPtr);
+
+	    /* if this is the active cell, use the buffer */
+	    if (activeCell) {
+		string = tablePtr->activeBuf;
+		TableScanValue(string, &valInfo);
+	    } else if (!haveString) {
+		/* Is there a value in the cell? If so, draw it  */
+		string = TableGetCellValueInfo(tablePtr, urow, ucol, &valInfo);
+	    }
+
+	    /*
+	     * The length is based on strlen because otherwise it stops
+	     * at the first \x00 unicode char it finds (!= '\0'),
+	     * although there can be more to the string than that.
+	     * Cached values carry their length and char count.
+	     */
+	    numChars = valInfo.numChars;
+
+	    /* If there is a string, show it */
+	    if (activeCell || numChars) {
+		int x0 = x + bd[0] + padx;
+		int y0 = y + bd[2] + pady;
+
+		/*
+		 * Get the dimensions of the string.  The active cell text
+		 * is being edited, so it doesn't go through the layout cache.
+		 */
+		if (activeCell) {
+		    textLayout = Tk_ComputeTextLayout(tagPtr->tkfont,
+			    string, numChars, (tagPtr->wrap > 0) ? width : 0, tagPtr->justify,
+			    (tagPtr->multiline > 0) ? 0 : TK_IGNORE_NEWLINES, &itemW, &itemH);
+		} else if ((tagPtr->wrap <= 0) && (strpbrk(string, "\t\n") == NULL)) {
+		    /*
+		     * A single line without tabs needs no layout, it is
+		     * measured here and drawn with Tk_DrawChars.
+		     */
+		    Tk_GetFontMetrics(tagPtr->tkfont, &lineFm);
+		    itemW = Tk_TextWidth(tagPtr->tkfont, string, valInfo.length);
+		    itemH = lineFm.linespace;
+		} else {
+		    textLayout = TableGetTextLayout(tablePtr, tagPtr, string, numChars,
+			    width, &itemW, &itemH);
+		    cachedLayout = 1;
+		}
+
+		/*
+		 * Set the origin coordinates of the string to draw using
+		 * the anchor.  origin represents the (x,y) coordinate of
+		 * the lower left corner of the text box, relative to the
+		 * internal (inside the border) window
+		 */
+
+		/* set the X origin first */
+		switch (tagPtr->anchor) {
+		    case TK_ANCHOR_NW:
+		    case TK_ANCHOR_W:
+		    case TK_ANCHOR_SW:		/* western position */
 			originX = ipadx;
 			break;
-		    case TK_ANCHOR_N:
-		    case TK_ANCHOR_S:
-		    case TK_ANCHOR_CENTER:	/* centered position */
-			originX = (width - itemW) / 2;
+		    case TK_ANCHOR_N:
+		    case TK_ANCHOR_S:
+		    case TK_ANCHOR_CENTER:	/* centered position */
+			originX = (width - itemW) / 2;
+			break;
+		    default:			/* eastern position */
+			originX = width - itemW - ipadx;
+		}
+
+		/* then set the Y origin */
+		switch (tagPtr->anchor) {
+		    case TK_ANCHOR_N:
+		    case TK_ANCHOR_NE:
+		    case TK_ANCHOR_NW:		/* northern position */
+			originY = ipady;
+			break;
+		    case TK_ANCHOR_W:
+		    case TK_ANCHOR_E:
+		    case TK_ANCHOR_CENTER:	/* centered position */
+			originY = (height - itemH) / 2;
+			break;
+		    default:			/* southern position */
+			originY = height - itemH - ipady;
+		}
+
+		/*
+		 * If this is the active cell and we are editing,
+		 * ensure that the cursor will be displayed
+		 */
+		if (activeCell) {
+		    Tk_CharBbox(textLayout, tablePtr->icursor, &cx, &cy, &cw, &ch);
+		    /* we have to fudge with maxW because of odd width
+		     * determination for newlines at the end of a line */
+		    maxW = width - tablePtr->insertWidth - (cx + MIN(tablePtr->charWidth, cw));
+		    maxH = height - (cy + ch);
+		    if (originX < bd[0] - cx) {
+			/* cursor off cell to the left */
+			/* use western positioning to cet cursor at left
+			 * with slight variation to show some text */
+			originX = bd[0] - cx + MIN(cx, width - tablePtr->insertWidth);
+		    } else if (originX > maxW) {
+			/* cursor off cell to the right */
+			/* use eastern positioning to cet cursor at right */
+			originX = maxW;
+		    }
+		    if (originY < bd[2] - cy) {
+			/* cursor before top of cell */
+			/* use northern positioning to cet cursor at top */
+			originY = bd[2] - cy;
+		    } else if (originY > maxH) {
+			/* cursor beyond bottom of cell */
+			/* use southern positioning to cet cursor at bottom */
+			originY = maxH;
+		    }
+		    tablePtr->activeTagPtr	= tagPtr;
+		    tablePtr->activeX		= originX;
+		    tablePtr->activeY		= originY;
+		}
+
+		/*
+		 * Use a clip rectangle only if necessary as it means
+		 * updating the GC in the server which slows everything down.
+		 * We can't fudge the width or height, just in case the user
+		 * wanted empty pad space.
+		 */
+		if ((originX < 0) || (originY < 0) ||
+			(originX+itemW > width) || (originY+itemH > height)) {
+		    if (!activeCell && (tagPtr->ellipsis != NULL)
+			    && (tagPtr->wrap <= 0) && (tagPtr->multiline <= 0)
+			) {
+			/*
+			 * Check which side to draw ellipsis on
+			 */
+			switch (tagPtr->anchor) {
+			    case TK_ANCHOR_NE:
+			    case TK_ANCHOR_E:
+			    case TK_ANCHOR_SE:		/* eastern position */
+				ellEast = 0;
+				break;
+			    default:			/* western position */
+				ellEast = 1;
+			}
+			if ((ellipsis != tagPtr->ellipsis) || (ellFont != tagPtr->tkfont)) {
+			    /*
+			     * Different ellipsis from last cached
+			     */
+			    ellFont  = tagPtr->tkfont;
+			    ellipsis = tagPtr->ellipsis;
+			    ellLen = Tk_TextWidth(ellFont, ellipsis, (int) strlen(ellipsis));
+			    Tk_GetFontMetrics(tagPtr->tkfont, &fm);
+			}
+			useEllLen = MIN(ellLen, width);
+		    } else {
+			ellEast = 0;
+			useEllLen = 0;
+		    }
+
+		    /*
+		     * The text wants to overflow the boundaries of the
+		     * displayed cell, so we must clip in some way
+		     */
+		    if (!activeCell && (originY >= 0) && (originY+itemH <= height)
+			    && ((textLayout == NULL)
+				    || ((tagPtr->wrap <= 0)
+					    && (strpbrk(string, "\t\n") == NULL)))
+			    && ((useEllLen && !ellEast) ? (originX+itemW <= width)
+				    : (originX >= 0))) {
+			/*
+			 * A single line that only overflows on the side the
+			 * ellipsis (if any) goes.  Wrapped text keeps its
+			 * lines, so it is always clipped.  Draw just the characters
+			 * that fit next to it, which needs no clipping.
+			 */
+			Tk_FontMetrics tfm;
+			int fitStart, fitLen, fitWidth;
+
+			Tk_GetFontMetrics(tagPtr->tkfont, &tfm);
+			if (useEllLen && !ellEast) {
+			    TableFitText(tablePtr, tagPtr->tkfont, string, &valInfo,
+				    originX + itemW - useEllLen, 1,
+				    &fitStart, &fitLen, &fitWidth);
+			    Tk_DrawChars(display, window, tagGc, tagPtr->tkfont,
+				    string + fitStart, fitLen,
+				    x0 + originX + itemW - fitWidth, y0 + originY + tfm.ascent);
+			} else {
+			    TableFitText(tablePtr, tagPtr->tkfont, string, &valInfo,
+				    width - originX - useEllLen, 0,
+				    &fitStart, &fitLen, &fitWidth);
+			    Tk_DrawChars(display, window, tagGc, tagPtr->tkfont,
+				    string, fitLen, x0 + originX, y0 + originY + tfm.ascent);
+			}
+			if (useEllLen) {
+			    Tk_DrawChars(display, window, tagGc, ellFont,
+				    ellipsis, (int) strlen(ellipsis),
+				    x0 + (ellEast ? width - useEllLen : 0),
+				    y0 + originY + tfm.ascent);
+			}
+		    } else {
+#ifdef NO_XSETCLIP
+			/*
+			 * Copy the the current contents of the cell into the
+			 * clipped window area.  This keeps any fg/bg and image
+			 * data intact.
+			 * x0 - x == pad area
+			 */
+			XCopyArea(display, window, clipWind, tagGc, x0, y0,
+				width, height, x0 - x, y0 - y);
+			/*
+			 * Now draw into the cell space on the special window.
+			 * Don't use x,y base offset for clipWind.
+			 */
+			TableDrawText(display, clipWind, tagGc, tagPtr->tkfont,
+				textLayout, string, valInfo.length,
+				x0 - x + originX, y0 - y + originY);
+
+			if (useEllLen) {
+			    /*
+			     * Recopy area the ellipse covers (not efficient)
+			     */
+			    XCopyArea(display, window, clipWind, tagGc,
+				    x0 + (ellEast ? width - useEllLen : 0), y0, useEllLen, height,
+				    x0 - x + (ellEast ? width - useEllLen : 0),
+				    y0 - y);
+			    Tk_DrawChars(display, clipWind, tagGc, ellFont,
+				    ellipsis, (int) strlen(ellipsis),
+				    x0 - x + (ellEast ? width - useEllLen : 0),
+				    y0 - y + originY + fm.ascent);
+			}
+			/*
+			 * Now copy back only the area that we want the
+			 * text to be drawn on.
+			 */
+			XCopyArea(display, clipWind, window, tagGc,
+				x0 - x, y0 - y, width, height, x0, y0);
+#elif defined(_WIN32)
+			/*
+			 * This is evil, evil evil! but the XCopyArea
+			 * doesn't work in all cases - Michael Teske.
+			 * The general structure follows the comments below.
+			 */
+			twdPtr = (TkWinDrawable *) window;
+			dc     = GetDC(twdPtr->window.handle);
+
+			clipR = CreateRectRgn(x0 + (ellEast ? 0 : useEllLen), y0,
+			    x0 + width - (ellEast ? useEllLen : 0), y0 + height);
+
+			SelectClipRgn(dc, clipR);
+			DeleteObject(clipR);
+			/* OffsetClipRgn(dc, 0, 0); */
+
+			TableDrawText(display, window, tagGc, tagPtr->tkfont,
+				textLayout, string, valInfo.length,
+				x0 + originX, y0 + originY);
+
+			if (useEllLen) {
+			    clipR = CreateRectRgn(x0, y0, x0 + width, y0 + height);
+			    SelectClipRgn(dc, clipR);
+			    DeleteObject(clipR);
+			    Tk_DrawChars(display, window, tagGc, ellFont, ellipsis,
+				    (int) strlen(ellipsis), x0 + (ellEast? width-useEllLen : 0),
+				    y0 + originY + fm.ascent);
+			}
+			SelectClipRgn(dc, NULL);
+			ReleaseDC(twdPtr->window.handle, dc);
+#else
+			/*
+			 * Use an X clipping rectangle.  The clipping is the
+			 * rectangle just for the actual text space (to allow
+			 * for empty padding space).
+			 */
+			clipRect.x      = x0 + (ellEast ? 0 : useEllLen);
+			clipRect.y      = y0;
+			clipRect.width  = width - (ellEast ? useEllLen : 0);
+			clipRect.height = height;
+			XSetClipRectangles(display, tagGc, 0, 0, &clipRect, 1, Unsorted);
+			TableDrawText(display, window, tagGc, tagPtr->tkfont,
+				textLayout, string, valInfo.length,
+				x0 + originX, y0 + originY);
+			if (useEllLen) {
+			    clipRect.x     = x0;
+			    clipRect.width = width;
+			    XSetClipRectangles(display, tagGc, 0, 0, &clipRect, 1, Unsorted);
+			    Tk_DrawChars(display, window, tagGc, ellFont, ellipsis,
+				    (int) strlen(ellipsis), x0 + (ellEast? width-useEllLen : 0),
+				    y0 + originY + fm.ascent);
+			}
+			XSetClipMask(display, tagGc, None);
+#endif
+		    }
+		} else if (textLayout == NULL) {
+		    Tk_DrawChars(display, window, tagGc, tagPtr->tkfont,
+			    string, valInfo.length,
+			    x0 + originX, y0 + originY + lineFm.ascent);
+		} else {
+		    Tk_DrawTextLayout(display, window, tagGc, textLayout,
+			    x0 + originX, y0 + originY, 0, -1);
+		}
+
+		/* if this is the active cell draw the cursor if it's on.
+		 * this ignores clip rectangles. */
+		if (activeCell &&
+			(originY + cy + bd[2] + pady < height) &&
+			(originX + cx + bd[0] + padx - (tablePtr->insertWidth / 2) >= 0)) {
+		    /* make sure it will fit in the box */
+		    maxW = MAX(0, originY + cy + bd[2] + pady);
+		    maxH = MIN(ch, height - maxW + bd[2] + pady);
+		    if (!clipX && !clipY && !(tablePtr->flags & SNAPSHOT)) {
+			/*
+			 * Keep the spot (within the borders) so the cursor
+			 * can blink without redrawing the whole cell.
+			 */
+			TableRect cursor, cell, inner;
+
+			cursor.x	= x0 + originX + cx - (tablePtr->insertWidth/2);
+			cursor.y	= y + maxW;
+			cursor.width	= tablePtr->insertWidth;
+			cursor.height	= maxH;
+			cell.x		= x;
+			cell.y		= y;
+			cell.width	= width + bd[0] + bd[1] + (2 * padx);
+			cell.height	= height + bd[2] + bd[3] + (2 * pady);
+			inner.x		= x + bd[0];
+			inner.y		= y + bd[2];
+			inner.width	= width + (2 * padx);
+			inner.height	= height + (2 * pady);
+			TableSaveCursor(tablePtr, window, &cursor, &cell, &inner);
+		    }
+		    if ((tablePtr->flags & (CURSOR_ON|SNAPSHOT)) == CURSOR_ON) {
+			Tk_Fill3DRectangle(tkwin, window, tablePtr->insertBg,
+				x0 + originX + cx - (tablePtr->insertWidth/2),
+				y + maxW, tablePtr->insertWidth, maxH, 0, TK_RELIEF_FLAT);
+		    }
+		}
+	    }
+
+	    /*
+	     * Re-Correct the dimensions before border drawing
+	     */
+	    width  += bd[0] + bd[1] + (2 * padx);
+	    height += bd[2] + bd[3] + (2 * pady);
+
+	    DrawBorder:
+	    /* Draw the 3d border on the pixmap correctly offset */
+	    if (tablePtr->drawMode == DRAW_MODE_SINGLE) {
+		topGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
+		if (window == passWindow) {
+		    /* the left and top grid lines, joined with the others */
+		    TableBatchLine(tablePtr, topGc, x, y, x, y + height - 1);
+		    TableBatchLine(tablePtr, topGc, x, y, x + width - 1, y);
+		    goto BorderDone;
+		}
+		/* draw a line with single pixel width */
+		rect[0].x = x;
+		rect[0].y = y + height - 1;
+		rect[1].x = x;
+		rect[1].y = y;
+		rect[2].x = x + width - 1;
+		rect[2].y = y;
+		XDrawLines(display, window, topGc, rect, 3, CoordModeOrigin);
+	    } else if (tablePtr->drawMode == DRAW_MODE_FAST) {
+		/*
+		 * This depicts a full 1 pixel border.
+		 *
+		 * Choose the GCs to get the best approximation
+		 * to the desired drawing style.
+		 */
+		switch(tagPtr->relief) {
+		    case TK_RELIEF_FLAT:
+			topGc = bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_FLAT_GC);
+			break;
+		    case TK_RELIEF_RAISED:
+		    case TK_RELIEF_RIDGE:
+			topGc    = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_LIGHT_GC);
+			bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
 			break;
-		    default:			/* eastern position */
-			originX = width - itemW - ipadx;
+		    case TK_RELIEF_SOLID:
+			topGc = bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
+			break;
+		    default: /* TK_RELIEF_SUNKEN TK_RELIEF_GROOVE */
+			bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_LIGHT_GC);
+			topGc    = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
+			break;
+		}
+
+		if (window == passWindow) {
+		    /*
+		     * The top lines own the pixels they share with the
+		     * bottom lines, as when drawn over them.
+		     */
+		    if (width > 1) {
+			TableBatchLine(tablePtr, bottomGc,
+				x + width - 1, y + 1, x + width - 1, y + height - 1);
+		    }
+		    if (height > 1) {
+			TableBatchLine(tablePtr, bottomGc,
+				x + 1, y + height - 1, x + width - 2, y + height - 1);
+		    }
+		    TableBatchLine(tablePtr, topGc, x, y, x, y + height - 1);
+		    TableBatchLine(tablePtr, topGc, x, y, x + width - 1, y);
+		    goto BorderDone;
+		}
+		/* draw a line with single pixel width */
+		rect[0].x = x + width - 1;
+		rect[0].y = y;
+		rect[1].x = x + width - 1;
+		rect[1].y = y + height - 1;
+		rect[2].x = x;
+		rect[2].y = y + height - 1;
+		XDrawLines(display, window, bottomGc, rect, 3, CoordModeOrigin);
+		rect[0].x = x;
+		rect[0].y = y + height - 1;
+		rect[1].x = x;
+		rect[1].y = y;
+		rect[2].x = x + width - 1;
+		rect[2].y = y;
+		XDrawLines(display, window, topGc, rect, 3, CoordModeOrigin);
+	    } else {
+		if (borders > 1) {
+		    if (bd[0]) {
+			Tk_3DVerticalBevel(tkwin, window, tagPtr->bg,
+				x, y, bd[0], height, 1 /* left side */, tagPtr->relief);
+		    }
+		    if (bd[1]) {
+			Tk_3DVerticalBevel(tkwin, window, tagPtr->bg, x + width - bd[1], y,
+				bd[1], height, 0 /* right side */, tagPtr->relief);
+		    }
+		    if ((borders == 4) && bd[2]) {
+			Tk_3DHorizontalBevel(tkwin, window, tagPtr->bg, x, y, width, bd[2],
+				1, 1, 1 /* top */, tagPtr->relief);
+		    }
+		    if ((borders == 4) && bd[3]) {
+			Tk_3DHorizontalBevel(tkwin, window, tagPtr->bg, x, y + height - bd[3],
+				width, bd[3], 0, 0, 0 /* bottom */, tagPtr->relief);
+		    }
+		} else if (borders == 1) {
+		    Tk_Draw3DRectangle(tkwin, window, tagPtr->bg, x, y, width, height, bd[0],
+				tagPtr->relief);
+		}
+	    }
+	    BorderDone:
+
+#ifndef _WIN32
+	    if (clipX || clipY) {
+		XCopyArea(display, window, cellWindow,
+			Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_FLAT_GC),
+			clipX, clipY, (unsigned) (width - clipX),
+			(unsigned) (height - clipY), cellX + clipX, cellY + clipY);
+		window = cellWindow;
+	    }
+#endif
+
+	    if (sigPtr != NULL) {
+		/* the slot now describes the drawn cell, or nothing */
+		sigPtr->valid = sigUse;
+	    }
+
+	    NextCell:
+	    /* clean up the necessaries */
+	    if (tagPtr == tablePtr->activeTagPtr) {
+		/*
+		 * This means it was the activeCell with text displayed.
+		 * We buffer the active tag for the 'activate' command.
+		 */
+		tablePtr->activeTagPtr = TableNewTag(NULL);
+		memcpy((void *) tablePtr->activeTagPtr, (void *) tagPtr, sizeof(TableTag));
+	    }
+	    if (textLayout) {
+		if (!cachedLayout) {
+		    Tk_FreeTextLayout(textLayout);
 		}
+		textLayout = NULL;
+		cachedLayout = 0;
+	    }
+	    if (cellType == CELL_HIDDEN) {
+		/* the last cell was a hidden one,
+		 * rework row stuff back to normal */
+		row = hrow; col = hcol;
+		urow = row+tablePtr->rowOffset;
+		rowPtr = FindRowColTag(tablePtr, urow, ROW);
+	    }
+	}
+
+	/*
+	 * Once the render budget is spent, stop after this row and
+	 * leave the rows below to the next TableDisplay.  Rows already
+	 * filled by the batching can't be left.
+	 */
+	if (row < rowTo && !(batch && spans) && TableBudgetSpent(tablePtr)) {
+	    tablePtr->flags |= AVOID_SPANS;
+	    TableCellCoords(tablePtr, row, 0, &x, &y, &width, &height);
+	    tablePtr->flags &= ~AVOID_SPANS;
+	    if (y + height > invalidY && y + height < invalidY + invalidHeight) {
+		restPtr->x	= invalidX;
+		restPtr->y	= y + height;
+		restPtr->width	= invalidWidth;
+		restPtr->height	= invalidY + invalidHeight - restPtr->y;
+		invalidHeight	= restPtr->y - invalidY;
+		stopped = 1;
+		break;
+	    }
+	}
+    }
+    Tcl_Free((char *) tagPtr);
+
+    if (batch) {
+	/* draw the collected fills and borders, the rest is filled */
+	TableFlushBatches(tablePtr, window);
+    } else {
+	/*
+	 * If we are at the end of the table, clear the area after the last
+	 * row/col.  We discount spans here because we just need the coords
+	 * for the area that would be the last physical cell.
+	 */
+	tablePtr->flags |= AVOID_SPANS;
+	TableCellCoords(tablePtr, tablePtr->rows-1, tablePtr->cols-1, &x, &y, &width, &height);
+	tablePtr->flags &= ~AVOID_SPANS;
+
+	if (x+width < invalidX+invalidWidth) {
+	    Tk_Fill3DRectangle(tkwin, window, tablePtr->defaultTag.bg,
+		    x+width, invalidY, (unsigned) (invalidX+invalidWidth-x-width),
+		    (unsigned) invalidHeight,
+		    0, TK_RELIEF_FLAT);
+	}
+
+	if (y+height < invalidY+invalidHeight) {
+	    Tk_Fill3DRectangle(tkwin, window, tablePtr->defaultTag.bg,
+		    invalidX, y+height, (unsigned) invalidWidth,
+		    (unsigned) (invalidY+invalidHeight-y-height),
+		    0, TK_RELIEF_FLAT);
+	}
+    }
+
+#ifndef _WIN32
+    /* copy the redrawn area of the backing pixmap to the window */
+    if (passWindow == tablePtr->backPixmap) {
+	XCopyArea(display, passWindow, Tk_WindowId(tkwin),
+		Tk_3DBorderGC(tkwin, tablePtr->defaultTag.bg, TK_3D_FLAT_GC),
+		invalidX, invalidY, (unsigned) invalidWidth, (unsigned) invalidHeight,
+		invalidX, invalidY);
+    }
+#endif
+    return stopped;
+}
 
-		/* then set the Y origin */
-		switch (tagPtr->anchor) {
-		    case TK_ANCHOR_N:
-		    case TK_ANCHOR_NE:
-		    case TK_ANCHOR_NW:		/* northern position */
-			originY = ipady;
-			break;
-		    case TK_ANCHOR_W:
-		    case TK_ANCHOR_E:
-		    case TK_ANCHOR_CENTER:	/* centered position */
-			originY = (height - itemH) / 2;
-			break;
-		    default:			/* southern position */
-			originY = height - itemH - ipady;
-		}
+/*
+ *--------------------------------------------------------------
+ *
+ * TableNextPass --
+ *	Starts a new drawing pass.  A new pass number invalidates what
+ *	the drawnStamps and the colTagCache recorded for the previous one.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Bumps drawStamp.
+ *
+ *--------------------------------------------------------------
+ */
+static void TableNextPass(Table *tablePtr) {
+    if (++(tablePtr->drawStamp) <= 0) {
+	tablePtr->drawStamp = 1;
+	if (tablePtr->drawnStamps != NULL) {
+	    memset((void *) tablePtr->drawnStamps, 0,
+		    tablePtr->drawRows * tablePtr->drawCols * sizeof(int));
+	    memset((void *) tablePtr->colTagStamps, 0, tablePtr->drawCols * sizeof(int));
+	}
+    }
+}
 
-		/*
-		 * If this is the active cell and we are editing,
-		 * ensure that the cursor will be displayed
-		 */
-		if (activeCell) {
-		    Tk_CharBbox(textLayout, tablePtr->icursor, &cx, &cy, &cw, &ch);
-		    /* we have to fudge with maxW because of odd width
-		     * determination for newlines at the end of a line */
-		    maxW = width - tablePtr->insertWidth - (cx + MIN(tablePtr->charWidth, cw));
-		    maxH = height - (cy + ch);
-		    if (originX < bd[0] - cx) {
-			/* cursor off cell to the left */
-			/* use western positioning to cet cursor at left
-			 * with slight variation to show some text */
-			originX = bd[0] - cx + MIN(cx, width - tablePtr->insertWidth);
-		    } else if (originX > maxW) {
-			/* cursor off cell to the right */
-			/* use eastern positioning to cet cursor at right */
-			originX = maxW;
-		    }
-		    if (originY < bd[2] - cy) {
-			/* cursor before top of cell */
-			/* use northern positioning to cet cursor at top */
-			originY = bd[2] - cy;
-		    } else if (originY > maxH) {
-			/* cursor beyond bottom of cell */
-			/* use southern positioning to cet cursor at bottom */
-			originY = maxH;
-		    }
-		    tablePtr->activeTagPtr	= tagPtr;
-		    tablePtr->activeX		= originX;
-		    tablePtr->activeY		= originY;
+/*
+ *--------------------------------------------------------------
+ *
+ * TableDisplay --
+ *	This procedure redraws the invalid rectangles of a table
+ *	window that were collected by TableInvalidate.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Information appears on the screen.
+ *
+ *--------------------------------------------------------------
+ */
+static void TableDisplay(ClientData clientdata) {
+    Table *tablePtr = (Table *) clientdata;
+    Tk_Window tkwin = tablePtr->tkwin;
+    Drawable window;
+    TableRect rects[TABLE_MAX_INVALID], rest;
+    int i, numRects;
+
+    tablePtr->flags &= ~REDRAW_PENDING;
+    if (tablePtr->maxFps > 0) {
+	Tcl_GetTime(&(tablePtr->lastDisplay));
+    }
+    if ((tkwin == NULL) || !Tk_IsMapped(tkwin)) {
+	return;
+    }
+
+    /*
+     * Take over the rectangles, drawing may invalidate new ones.
+     */
+    numRects = tablePtr->numInvalid;
+    memcpy((void *) rects, (void *) tablePtr->invalid, numRects * sizeof(TableRect));
+    tablePtr->numInvalid = 0;
+
+#ifndef _WIN32
+    /*
+     * Whatever the drawmode, draw into the backing pixmap which is kept
+     * for the whole window, so that exposures only have to copy it back.
+     * A new one has to be drawn in full.
+     * FIX: Ignore the backing pixmap for Win32 as the fast ClipRgn trick
+     * below does not work for bitmaps.
+     */
+    if ((tablePtr->backPixmap == None)
+	    || (tablePtr->backWidth != Tk_Width(tkwin))
+	    || (tablePtr->backHeight != Tk_Height(tkwin))) {
+	TableFreeBackPixmap(tablePtr);
+	tablePtr->backWidth  = Tk_Width(tkwin);
+	tablePtr->backHeight = Tk_Height(tkwin);
+	tablePtr->backPixmap = Tk_GetPixmap(tablePtr->display,
+		Tk_WindowId(tkwin), tablePtr->backWidth,
+		tablePtr->backHeight, Tk_Depth(tkwin));
+	rects[0].x = rects[0].y = 0;
+	rects[0].width  = tablePtr->backWidth;
+	rects[0].height = tablePtr->backHeight;
+	numRects = 1;
+    }
+    window = tablePtr->backPixmap;
+#else
+    window = Tk_WindowId(tkwin);
+#endif
+
+    /*
+     * Spans draw over other cells and the area past the last cell gets
+     * cleared, so the cell signatures only hold without spans and for
+     * an unchanged table size.  The batching drawmodes don't keep them.
+     */
+    if ((tablePtr->spanTbl && tablePtr->spanTbl->numEntries)
+	    || (tablePtr->drawMode & (DRAW_MODE_FAST|DRAW_MODE_SINGLE))
+	    || (tablePtr->rows != tablePtr->sigTableRows)
+	    || (tablePtr->cols != tablePtr->sigTableCols)) {
+	TableFreeCellSigs(tablePtr);
+	tablePtr->sigTableRows = tablePtr->rows;
+	tablePtr->sigTableCols = tablePtr->cols;
+    }
+
+    TableNextPass(tablePtr);
+
+    if (tablePtr->renderBudget > 0) {
+	Tcl_GetTime(&(tablePtr->renderStart));
+    }
+    for (i = 0; i < numRects; i++) {
+	if (TableDisplayRect(tablePtr, window,
+		rects[i].x, rects[i].y, rects[i].width, rects[i].height, &rest)) {
+	    /* out of budget, keep what is left */
+	    rects[i] = rest;
+	    break;
+	}
+    }
+
+    /* Take care of removing embedded windows that are no longer in view */
+    TableUndisplay(tablePtr);
+
+    TableRedrawHighlight(tablePtr);
+
+    /*
+     * Continue with what the render budget left undrawn in the next
+     * idle callback, so that events are serviced in between.
+     */
+    for ( ; i < numRects; i++) {
+	TableInvalidate(tablePtr, rects[i].x, rects[i].y,
+		rects[i].width, rects[i].height, 0);
+    }
+}
+
+/*
+ * A run of rows (or cols) a snapshot copies out of one rendering of
+ * the table, see TableSnapshotBands.
+ */
+typedef struct {
+    int first;			/* topRow (leftCol) to render the run with */
+    int src;			/* where the run starts in the window */
+    int size;			/* its height (width) in pixels */
+} TableBand;
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableSnapshotBands --
+ *	Splits the rows (or cols) first..last into runs that each fit
+ *	in the view at once.  Title rows in the range make one run,
+ *	the others are shown from the top of the scrolled area.
+ *	A single row larger than the view makes a run of its own and
+ *	is cut at the window edge.
+ *
+ * Results:
+ *	The number of runs stored in bands, which must have room for
+ *	last-first+1 of them, or -1 if a run would start outside the
+ *	window because the titles leave no room.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableSnapshotBands(Tcl_WideInt *starts, int titles, int first, int last,
+	int view, int hl, TableBand *bands) {
+    int i, j, num = 0, avail;
+
+    if (first < titles) {
+	if (starts[first] >= view - 2*hl) {
+	    return -1;
+	}
+	j = MIN(last, titles-1);
+	bands[num].first = titles;
+	bands[num].src	 = hl + (int) starts[first];
+	bands[num].size	 = (int) (starts[j+1] - starts[first]);
+	num++;
+	first = j+1;
+    }
+    if (first <= last && starts[titles] >= view - 2*hl) {
+	return -1;
+    }
+    avail = view - 2*hl - (int) starts[titles];
+    for (i = first; i <= last; i = j) {
+	for (j = i+1; (j <= last) && (starts[j+1] - starts[i] <= avail); j++) {
+	    /* take in rows while they fit */
+	}
+	bands[num].first = i;
+	bands[num].src	 = hl + (int) starts[titles];
+	bands[num].size	 = (int) (starts[j] - starts[i]);
+	num++;
+    }
+    return num;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableMaskShift --
+ *	Helper for TableImageToRGB, finds the position and width of the
+ *	bits a TrueColor visual uses for one color.
+ *
+ * Results:
+ *	The shift of mask, its number of bits in bitsPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableMaskShift(unsigned long mask, int *bitsPtr) {
+    int shift = 0, bits = 0;
+
+    if (mask == 0) {
+	*bitsPtr = 0;
+	return 0;
+    }
+    while (!(mask & 1)) {
+	mask >>= 1;
+	shift++;
+    }
+    while (mask & 1) {
+	mask >>= 1;
+	bits++;
+    }
+    *bitsPtr = bits;
+    return shift;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableImageToRGB --
+ *	Converts the pixels of an image of the table window to 8 bit
+ *	RGB triples.  TrueColor pixels are decoded with the masks of
+ *	the visual, others are looked up in the colormap a row at a time.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Fills width*3 bytes for each of the image rows at rgb, rows are
+ *	stride bytes apart.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableImageToRGB(Table *tablePtr, XImage *imagePtr, int width, int height,
+	unsigned char *rgb, int stride) {
+    Visual *visual = Tk_Visual(tablePtr->tkwin);
+    unsigned char *p;
+    unsigned long pixel;
+    int x, y, i, shift[3], bits[3];
+    unsigned long mask[3];
+    XColor *colors;
+
+    if (visual->class == TrueColor) {
+	mask[0] = visual->red_mask;
+	mask[1] = visual->green_mask;
+	mask[2] = visual->blue_mask;
+	for (i = 0; i < 3; i++) {
+	    shift[i] = TableMaskShift(mask[i], &bits[i]);
+	}
+	for (y = 0; y < height; y++) {
+	    p = rgb + y * stride;
+	    for (x = 0; x < width; x++) {
+		pixel = XGetPixel(imagePtr, x, y);
+		for (i = 0; i < 3; i++) {
+		    unsigned long v = (pixel & mask[i]) >> shift[i];
+		    *p++ = (unsigned char) (bits[i] ? (v * 255) / ((1UL << bits[i]) - 1) : 0);
 		}
+	    }
+	}
+	return;
+    }
+    colors = (XColor *) Tcl_Alloc(width * sizeof(XColor));
+    for (y = 0; y < height; y++) {
+	for (x = 0; x < width; x++) {
+	    colors[x].pixel = XGetPixel(imagePtr, x, y);
+	}
+	XQueryColors(tablePtr->display, Tk_Colormap(tablePtr->tkwin), colors, width);
+	p = rgb + y * stride;
+	for (x = 0; x < width; x++) {
+	    *p++ = (unsigned char) (colors[x].red >> 8);
+	    *p++ = (unsigned char) (colors[x].green >> 8);
+	    *p++ = (unsigned char) (colors[x].blue >> 8);
+	}
+    }
+    Tcl_Free((char *) colors);
+}
 
-		/*
-		 * Use a clip rectangle only if necessary as it means
-		 * updating the GC in the server which slows everything down.
-		 * We can't fudge the width or height, just in case the user
-		 * wanted empty pad space.
-		 */
-		if ((originX < 0) || (originY < 0) ||
-			(originX+itemW > width) || (originY+itemH > height)) {
-		    if (!activeCell && (tagPtr->ellipsis != NULL)
-			    && (tagPtr->wrap <= 0) && (tagPtr->multiline <= 0)
-			) {
-			/*
-			 * Check which side to draw ellipsis on
-			 */
-			switch (tagPtr->anchor) {
-			    case TK_ANCHOR_NE:
-			    case TK_ANCHOR_E:
-			    case TK_ANCHOR_SE:		/* eastern position */
-				ellEast = 0;
-				break;
-			    default:			/* western position */
-				ellEast = 1;
-			}
-			if ((ellipsis != tagPtr->ellipsis) || (ellFont != tagPtr->tkfont)) {
-			    /*
-			     * Different ellipsis from last cached
-			     */
-			    ellFont  = tagPtr->tkfont;
-			    ellipsis = tagPtr->ellipsis;
-			    ellLen = Tk_TextWidth(ellFont, ellipsis, (int) strlen(ellipsis));
-			    Tk_GetFontMetrics(tagPtr->tkfont, &fm);
-			}
-			useEllLen = MIN(ellLen, width);
-		    } else {
-			ellEast = 0;
-			useEllLen = 0;
-		    }
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableSnapshot --
+ *	Renders the cells r1,c1 to r2,c2 (real coords) off-screen
+ *	through TableDisplayRect, as the table would show them if they
+ *	were all in view.  Parts of the range outside the view are
+ *	rendered by scrolling the table in place, so the window must be
+ *	mapped.  The image is passed on in strips of complete rows,
+ *	from top to bottom.
+ *
+ * Results:
+ *	A standard Tcl result, from proc if it failed.  The time spent
+ *	rendering, without the pixel conversion, is stored in usecPtr.
+ *
+ * Side effects:
+ *	proc is called for each strip with the RGB data of the strip,
+ *	its top in the snapshot, the snapshot width and strip height.
+ *	The view, embedded windows and the screen are left untouched.
+ *
+ *----------------------------------------------------------------------
+ */
+int TableSnapshot(Table *tablePtr, int r1, int c1, int r2, int c2,
+	TableSnapshotProc *proc, ClientData clientData, Tcl_WideInt *usecPtr) {
+    Tk_Window tkwin = tablePtr->tkwin;
+    Display *display = tablePtr->display;
+    TableBand *rowBands, *colBands;
+    int numRowBands, numColBands, i, j, width, maxH, dstX, dstY;
+    int topRow, leftCol, topRowShift, leftColShift, result = TCL_OK;
+    unsigned char *strip;
+    Pixmap pixmap;
+    XImage *imagePtr;
+    TableRect rest;
+    Tcl_Time start, now;
+
+    *usecPtr = 0;
+    if ((tkwin == NULL) || !Tk_IsMapped(tkwin)) {
+	Tcl_SetObjResult(tablePtr->interp,
+		Tcl_NewStringObj("can't snapshot a table that isn't mapped", -1));
+	return TCL_ERROR;
+    }
 
-		    /*
-		     * The text wants to overflow the boundaries of the
-		     * displayed cell, so we must clip in some way
-		     */
-#ifdef NO_XSETCLIP
-		    /*
-		     * Copy the the current contents of the cell into the
-		     * clipped window area.  This keeps any fg/bg and image
-		     * data intact.
-		     * x0 - x == pad area
-		     */
-		    XCopyArea(display, window, clipWind, tagGc, x0, y0,
-			    width, height, x0 - x, y0 - y);
-		    /*
-		     * Now draw into the cell space on the special window.
-		     * Don't use x,y base offset for clipWind.
-		     */
-		    Tk_DrawTextLayout(display, clipWind, tagGc, textLayout,
-			    x0 - x + originX, y0 - y + originY, 0, -1);
+    rowBands = (TableBand *) Tcl_Alloc((r2-r1+1) * sizeof(TableBand));
+    colBands = (TableBand *) Tcl_Alloc((c2-c1+1) * sizeof(TableBand));
+    numRowBands = TableSnapshotBands(tablePtr->rowStarts, tablePtr->titleRows,
+	    r1, r2, Tk_Height(tkwin), tablePtr->highlightWidth, rowBands);
+    numColBands = TableSnapshotBands(tablePtr->colStarts, tablePtr->titleCols,
+	    c1, c2, Tk_Width(tkwin), tablePtr->highlightWidth, colBands);
+    if (numRowBands < 0 || numColBands < 0) {
+	Tcl_Free((char *) rowBands);
+	Tcl_Free((char *) colBands);
+	Tcl_SetObjResult(tablePtr->interp, Tcl_NewStringObj(
+		"the titles leave no room in the window to snapshot", -1));
+	return TCL_ERROR;
+    }
+    width = (int) (tablePtr->colStarts[c2+1] - tablePtr->colStarts[c1]);
+    maxH = 0;
+    for (i = 0; i < numRowBands; i++) {
+	maxH = MAX(maxH, rowBands[i].size);
+    }
+    if ((Tcl_WideInt) width * maxH * 3 > INT_MAX) {
+	Tcl_Free((char *) rowBands);
+	Tcl_Free((char *) colBands);
+	Tcl_SetObjResult(tablePtr->interp,
+		Tcl_NewStringObj("snapshot is too wide", -1));
+	return TCL_ERROR;
+    }
+    strip = (unsigned char *) Tcl_Alloc(MAX(1, width * maxH * 3));
+    pixmap = Tk_GetPixmap(display, Tk_WindowId(tkwin),
+	    Tk_Width(tkwin), Tk_Height(tkwin), Tk_Depth(tkwin));
+
+    topRow	 = tablePtr->topRow;
+    leftCol	 = tablePtr->leftCol;
+    topRowShift	 = tablePtr->topRowShift;
+    leftColShift = tablePtr->leftColShift;
+    tablePtr->topRowShift = tablePtr->leftColShift = 0;
+    tablePtr->flags |= SNAPSHOT;
+
+    for (dstY = 0, i = 0; i < numRowBands && result == TCL_OK; i++) {
+	tablePtr->topRow = rowBands[i].first;
+	memset((void *) strip, 0, width * rowBands[i].size * 3);
+	for (dstX = 0, j = 0; j < numColBands; j++) {
+	    tablePtr->leftCol = colBands[j].first;
+	    TableNextPass(tablePtr);
+
+	    Tcl_GetTime(&start);
+	    TableDisplayRect(tablePtr, pixmap, colBands[j].src, rowBands[i].src,
+		    colBands[j].size, rowBands[i].size, &rest);
+	    XSync(display, False);
+	    Tcl_GetTime(&now);
+	    *usecPtr += ((Tcl_WideInt) now.sec - start.sec) * 1000000
+		+ (now.usec - start.usec);
+
+	    /* a run larger than the view was cut at the window edge */
+	    imagePtr = XGetImage(display, pixmap, colBands[j].src, rowBands[i].src,
+		    (unsigned) MIN(colBands[j].size, Tk_Width(tkwin) - colBands[j].src),
+		    (unsigned) MIN(rowBands[i].size, Tk_Height(tkwin) - rowBands[i].src),
+		    AllPlanes, ZPixmap);
+	    if (imagePtr != NULL) {
+		TableImageToRGB(tablePtr, imagePtr,
+			MIN(colBands[j].size, Tk_Width(tkwin) - colBands[j].src),
+			MIN(rowBands[i].size, Tk_Height(tkwin) - rowBands[i].src),
+			strip + dstX * 3, width * 3);
+		XDestroyImage(imagePtr);
+	    }
+	    dstX += colBands[j].size;
+	}
+	result = (*proc)(clientData, strip, dstY, width, rowBands[i].size);
+	dstY += rowBands[i].size;
+    }
+
+    tablePtr->flags &= ~SNAPSHOT;
+    tablePtr->topRow	   = topRow;
+    tablePtr->leftCol	   = leftCol;
+    tablePtr->topRowShift  = topRowShift;
+    tablePtr->leftColShift = leftColShift;
+    /* the per pass caches now describe the snapshot, not the view */
+    TableNextPass(tablePtr);
+
+    Tk_FreePixmap(display, pixmap);
+    Tcl_Free((char *) strip);
+    Tcl_Free((char *) rowBands);
+    Tcl_Free((char *) colBands);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableAddInvalid --
+ *	Adds a rectangle to the invalid rectangles of the pending
+ *	update.  Rectangles that overlap or touch are merged into their
+ *	bounding rectangle, otherwise they are kept apart so scattered
+ *	updates only redraw the cells that changed.  Once there are
+ *	TABLE_MAX_INVALID, the one that grows least takes it in.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Modifies tablePtr->invalid and numInvalid.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableAddInvalid(Table *tablePtr, int x, int y, int w, int h) {
+    TableRect *rects = tablePtr->invalid;
+    Tcl_WideInt grow, bestGrow = -1;
+    int i, best = 0, x1, y1;
+
+    for (i = 0; i < tablePtr->numInvalid; ) {
+	if (x <= rects[i].x + rects[i].width && rects[i].x <= x + w
+		&& y <= rects[i].y + rects[i].height && rects[i].y <= y + h) {
+	    /* take it in and check the others again against the union */
+	    x1 = MAX(x + w, rects[i].x + rects[i].width);
+	    y1 = MAX(y + h, rects[i].y + rects[i].height);
+	    x  = MIN(x, rects[i].x);
+	    y  = MIN(y, rects[i].y);
+	    w  = x1 - x;
+	    h  = y1 - y;
+	    rects[i] = rects[--(tablePtr->numInvalid)];
+	    i = 0;
+	} else {
+	    i++;
+	}
+    }
 
-		    if (useEllLen) {
-			/*
-			 * Recopy area the ellipse covers (not efficient)
-			 */
-			XCopyArea(display, window, clipWind, tagGc,
-				x0 + (ellEast ? width - useEllLen : 0), y0, useEllLen, height,
-				x0 - x + (ellEast ? width - useEllLen : 0),
-				y0 - y);
-			Tk_DrawChars(display, clipWind, tagGc, ellFont,
-				ellipsis, (int) strlen(ellipsis),
-				x0 - x + (ellEast ? width - useEllLen : 0),
-				y0 - y + originY + fm.ascent);
-		    }
-		    /*
-		     * Now copy back only the area that we want the
-		     * text to be drawn on.
-		     */
-		    XCopyArea(display, clipWind, window, tagGc,
-			    x0 - x, y0 - y, width, height, x0, y0);
-#elif defined(_WIN32)
-		    /*
-		     * This is evil, evil evil! but the XCopyArea
-		     * doesn't work in all cases - Michael Teske.
-		     * The general structure follows the comments below.
-		     */
-		    twdPtr = (TkWinDrawable *) window;
-		    dc     = GetDC(twdPtr->window.handle);
+    if (tablePtr->numInvalid == TABLE_MAX_INVALID) {
+	for (i = 0; i < tablePtr->numInvalid; i++) {
+	    x1 = MAX(x + w, rects[i].x + rects[i].width) - MIN(x, rects[i].x);
+	    y1 = MAX(y + h, rects[i].y + rects[i].height) - MIN(y, rects[i].y);
+	    grow = (Tcl_WideInt) x1 * y1
+		- (Tcl_WideInt) rects[i].width * rects[i].height;
+	    if (bestGrow < 0 || grow < bestGrow) {
+		bestGrow = grow;
+		best = i;
+	    }
+	}
+	x1 = MAX(x + w, rects[best].x + rects[best].width);
+	y1 = MAX(y + h, rects[best].y + rects[best].height);
+	x  = MIN(x, rects[best].x);
+	y  = MIN(y, rects[best].y);
+	rects[best] = rects[--(tablePtr->numInvalid)];
+	/* the union may reach other rectangles now */
+	TableAddInvalid(tablePtr, x, y, x1 - x, y1 - y);
+	return;
+    }
 
-		    clipR = CreateRectRgn(x0 + (ellEast ? 0 : useEllLen), y0,
-			x0 + width - (ellEast ? useEllLen : 0), y0 + height);
+    rects[tablePtr->numInvalid].x	= x;
+    rects[tablePtr->numInvalid].y	= y;
+    rects[tablePtr->numInvalid].width	= w;
+    rects[tablePtr->numInvalid].height	= h;
+    tablePtr->numInvalid++;
+}
 
-		    SelectClipRgn(dc, clipR);
-		    DeleteObject(clipR);
-		    /* OffsetClipRgn(dc, 0, 0); */
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableInvalidate --
+ *	Invalidates a rectangle and adds it to the invalid rectangles
+ *	waiting to be redrawn.  If the INV_FORCE flag bit is set,
+ *	it does an update instantly else waits until Tk is idle.
+ *
+ * Results:
+ *	Will schedule table (re)display.
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+void TableInvalidate(Table * tablePtr, int x, int y, int w, int h, int flags) {
+    Tk_Window tkwin = tablePtr->tkwin;
+    int hl	= tablePtr->highlightWidth;
+    int height	= Tk_Height(tkwin);
+    int width	= Tk_Width(tkwin);
 
-		    Tk_DrawTextLayout(display, window, tagGc, textLayout,
-			    x0 + originX, y0 + originY, 0, -1);
+    /*
+     * Make sure that the window hasn't been destroyed already.
+     * Avoid allocating 0 sized pixmaps which would be fatal,
+     * and check if rectangle is even on the screen.
+     */
+    if ((tkwin == NULL) || (w <= 0) || (h <= 0) || (x > width) || (y > height)) {
+	return;
+    }
 
-		    if (useEllLen) {
-			clipR = CreateRectRgn(x0, y0, x0 + width, y0 + height);
-			SelectClipRgn(dc, clipR);
-			DeleteObject(clipR);
-			Tk_DrawChars(display, window, tagGc, ellFont, ellipsis,
-				(int) strlen(ellipsis), x0 + (ellEast? width-useEllLen : 0),
-				y0 + originY + fm.ascent);
-		    }
-		    SelectClipRgn(dc, NULL);
-		    ReleaseDC(twdPtr->window.handle, dc);
-#else
-		    /*
-		     * Use an X clipping rectangle.  The clipping is the
-		     * rectangle just for the actual text space (to allow
-		     * for empty padding space).
-		     */
-		    clipRect.x      = x0 + (ellEast ? 0 : useEllLen);
-		    clipRect.y      = y0;
-		    clipRect.width  = width - (ellEast ? useEllLen : 0);
-		    clipRect.height = height;
-		    XSetClipRectangles(display, tagGc, 0, 0, &clipRect, 1, Unsorted);
-		    Tk_DrawTextLayout(display, window, tagGc, textLayout,
-			    x0 + originX, y0 + originY, 0, -1);
-		    if (useEllLen) {
-			clipRect.x     = x0;
-			clipRect.width = width;
-			XSetClipRectangles(display, tagGc, 0, 0, &clipRect, 1, Unsorted);
-			Tk_DrawChars(display, window, tagGc, ellFont, ellipsis,
-				(int) strlen(ellipsis), x0 + (ellEast? width-useEllLen : 0),
-				y0 + originY + fm.ascent);
-		    }
-		    XSetClipMask(display, tagGc, None);
-#endif
-		} else {
-		    Tk_DrawTextLayout(display, window, tagGc, textLayout,
-			    x0 + originX, y0 + originY, 0, -1);
-		}
+    /* If not even mapped, wait for the remap to redraw all */
+    if (!Tk_IsMapped(tkwin)) {
+	tablePtr->flags |= REDRAW_ON_MAP;
+	return;
+    }
 
-		/* if this is the active cell draw the cursor if it's on.
-		 * this ignores clip rectangles. */
-		if (activeCell && (tablePtr->flags & CURSOR_ON) &&
-			(originY + cy + bd[2] + pady < height) &&
-			(originX + cx + bd[0] + padx - (tablePtr->insertWidth / 2) >= 0)) {
-		    /* make sure it will fit in the box */
-		    maxW = MAX(0, originY + cy + bd[2] + pady);
-		    maxH = MIN(ch, height - maxW + bd[2] + pady);
-		    Tk_Fill3DRectangle(tkwin, window, tablePtr->insertBg,
-			    x0 + originX + cx - (tablePtr->insertWidth/2),
-			    y + maxW, tablePtr->insertWidth, maxH, 0, TK_RELIEF_FLAT);
-		}
-	    }
+    /*
+     * If no pending updates exist, then replace the rectangles.
+     * Otherwise add it to them.
+     */
+    if ((flags & INV_HIGHLIGHT) && (x < hl || y < hl || x+w >= width-hl || y+h >= height-hl)) {
+	tablePtr->flags |= REDRAW_BORDER;
+    }
 
+    if (tablePtr->flags & REDRAW_PENDING) {
+	TableAddInvalid(tablePtr, x, y, w, h);
+	/* Do we want to force this update out? */
+	if (flags & INV_FORCE) {
+	    TableCancelRedraw(tablePtr);
+	    TableDisplay((ClientData) tablePtr);
+	}
+    } else {
+	tablePtr->numInvalid = 0;
+	TableAddInvalid(tablePtr, x, y, w, h);
+	if (flags & INV_FORCE) {
+	    TableDisplay((ClientData) tablePtr);
+	    return;
+	}
+	tablePtr->flags |= REDRAW_PENDING;
+	if (tablePtr->maxFps > 0) {
 	    /*
-	     * Re-Correct the dimensions before border drawing
+	     * Hold the damage back until a frame is due, so that
+	     * frequent updates coalesce into one redisplay.
 	     */
-	    width  += bd[0] + bd[1] + (2 * padx);
-	    height += bd[2] + bd[3] + (2 * pady);
-
-	    DrawBorder:
-	    /* Draw the 3d border on the pixmap correctly offset */
-	    if (tablePtr->drawMode == DRAW_MODE_SINGLE) {
-		topGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
-		/* draw a line with single pixel width */
-		rect[0].x = x;
-		rect[0].y = y + height - 1;
-		rect[1].x = x;
-		rect[1].y = y;
-		rect[2].x = x + width - 1;
-		rect[2].y = y;
-		XDrawLines(display, window, topGc, rect, 3, CoordModeOrigin);
-	    } else if (tablePtr->drawMode == DRAW_MODE_FAST) {
-		/*
-		 * This depicts a full 1 pixel border.
-		 *
-		 * Choose the GCs to get the best approximation
-		 * to the desired drawing style.
-		 */
-		switch(tagPtr->relief) {
-		    case TK_RELIEF_FLAT:
-			topGc = bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_FLAT_GC);
-			break;
-		    case TK_RELIEF_RAISED:
-		    case TK_RELIEF_RIDGE:
-			topGc    = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_LIGHT_GC);
-			bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
-			break;
-		    case TK_RELIEF_SOLID:
-			topGc = bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
-			break;
-		    default: /* TK_RELIEF_SUNKEN TK_RELIEF_GROOVE */
-			bottomGc = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_LIGHT_GC);
-			topGc    = Tk_3DBorderGC(tkwin, tagPtr->bg, TK_3D_DARK_GC);
-			break;
-		}
-
-		/* draw a line with single pixel width */
-		rect[0].x = x + width - 1;
-		rect[0].y = y;
-		rect[1].x = x + width - 1;
-		rect[1].y = y + height - 1;
-		rect[2].x = x;
-		rect[2].y = y + height - 1;
-		XDrawLines(display, window, bottomGc, rect, 3, CoordModeOrigin);
-		rect[0].x = x;
-		rect[0].y = y + height - 1;
-		rect[1].x = x;
-		rect[1].y = y;
-		rect[2].x = x + width - 1;
-		rect[2].y = y;
-		XDrawLines(display, window, topGc, rect, 3, CoordModeOrigin);
-	    } else {
-		if (borders > 1) {
-		    if (bd[0]) {
-			Tk_3DVerticalBevel(tkwin, window, tagPtr->bg,
-				x, y, bd[0], height, 1 /* left side */, tagPtr->relief);
-		    }
-		    if (bd[1]) {
-			Tk_3DVerticalBevel(tkwin, window, tagPtr->bg, x + width - bd[1], y,
-				bd[1], height, 0 /* right side */, tagPtr->relief);
-		    }
-		    if ((borders == 4) && bd[2]) {
-			Tk_3DHorizontalBevel(tkwin, window, tagPtr->bg, x, y, width, bd[2],
-				1, 1, 1 /* top */, tagPtr->relief);
-		    }
-		    if ((borders == 4) && bd[3]) {
-			Tk_3DHorizontalBevel(tkwin, window, tagPtr->bg, x, y + height - bd[3],
-				width, bd[3], 0, 0, 0 /* bottom */, tagPtr->relief);
-		    }
-		} else if (borders == 1) {
-		    Tk_Draw3DRectangle(tkwin, window, tagPtr->bg, x, y, width, height, bd[0],
-				tagPtr->relief);
-		}
-	    }
-
-	    /* clean up the necessaries */
-	    if (tagPtr == tablePtr->activeTagPtr) {
-		/*
-		 * This means it was the activeCell with text displayed.
-		 * We buffer the active tag for the 'activate' command.
-		 */
-		tablePtr->activeTagPtr = TableNewTag(NULL);
-		memcpy((void *) tablePtr->activeTagPtr, (void *) tagPtr, sizeof(TableTag));
-	    }
-	    if (textLayout) {
-		Tk_FreeTextLayout(textLayout);
-		textLayout = NULL;
-	    }
-	    if (cellType == CELL_HIDDEN) {
-		/* the last cell was a hidden one,
-		 * rework row stuff back to normal */
-		row = hrow; col = hcol;
-		urow = row+tablePtr->rowOffset;
-		rowPtr = FindRowColTag(tablePtr, urow, ROW);
+	    Tcl_Time now;
+	    Tcl_WideInt elapsed;
+	    int frame = 1000 / tablePtr->maxFps;
+
+	    Tcl_GetTime(&now);
+	    elapsed = ((Tcl_WideInt) now.sec - tablePtr->lastDisplay.sec) * 1000
+		+ ((Tcl_WideInt) now.usec - tablePtr->lastDisplay.usec) / 1000;
+	    if (elapsed >= 0 && elapsed < frame) {
+		tablePtr->redrawTimer = Tcl_CreateTimerHandler(
+			(int) (frame - elapsed), TableDisplayTimer,
+			(ClientData) tablePtr);
+		return;
 	    }
 	}
+	Tcl_DoWhenIdle(TableDisplay, (ClientData) tablePtr);
     }
-    Tcl_Free((char *) tagPtr);
-#ifdef NO_XSETCLIP
-    Tk_FreePixmap(display, clipWind);
-#endif
+}
 
-    /* Take care of removing embedded windows that are no longer in view */
-    TableUndisplay(tablePtr);
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableDisplayTimer --
+ *	Timer callback that runs a redisplay held back by -maxfps.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Redraws the table.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableDisplayTimer(ClientData clientdata) {
+    Table *tablePtr = (Table *) clientdata;
 
-    /*
-     * If we are at the end of the table, clear the area after the last
-     * row/col.  We discount spans here because we just need the coords
-     * for the area that would be the last physical cell.
-     */
-    tablePtr->flags |= AVOID_SPANS;
-    TableCellCoords(tablePtr, tablePtr->rows-1, tablePtr->cols-1, &x, &y, &width, &height);
-    tablePtr->flags &= ~AVOID_SPANS;
-    leftoverWidth = invalidWidth;
-    leftoverHeight = invalidHeight;
+    tablePtr->redrawTimer = NULL;
+    TableDisplay(clientdata);
+}
 
-    if (x+width < invalidX+invalidWidth) {
-	Tk_Fill3DRectangle(tkwin, Tk_WindowId(tkwin), tablePtr->defaultTag.bg,
-		x+width, invalidY, (unsigned) (invalidX+invalidWidth-x-width),
-		(unsigned) invalidHeight,
-		0, TK_RELIEF_FLAT);
-	leftoverWidth = x+width-invalidX;
-	if (leftoverWidth < 0) leftoverWidth = 0;
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableCancelRedraw --
+ *	Cancels a pending redisplay, whether it waits for idle time
+ *	or for the -maxfps timer.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Clears REDRAW_PENDING.  The invalid rectangles are kept.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableCancelRedraw(Table *tablePtr) {
+    if (tablePtr->flags & REDRAW_PENDING) {
+	Tcl_CancelIdleCall(TableDisplay, (ClientData) tablePtr);
+	if (tablePtr->redrawTimer != NULL) {
+	    Tcl_DeleteTimerHandler(tablePtr->redrawTimer);
+	    tablePtr->redrawTimer = NULL;
+	}
+	tablePtr->flags &= ~REDRAW_PENDING;
     }
+}
 
-    if (y+height < invalidY+invalidHeight) {
-	Tk_Fill3DRectangle(tkwin, Tk_WindowId(tkwin), tablePtr->defaultTag.bg,
-		invalidX, y+height, (unsigned) invalidWidth,
-		(unsigned) (invalidY+invalidHeight-y-height),
-		0, TK_RELIEF_FLAT);
-	leftoverHeight = y+height-invalidY;
-	if (leftoverHeight < 0) leftoverHeight = 0;
-    }
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFlashNow --
+ *	Returns the current time in flash ticks.
+ *
+ * Results:
+ *	Milliseconds since the epoch divided by FLASH_TICK.
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_WideInt TableFlashNow(void) {
+    Tcl_Time now;
 
-#ifndef _WIN32
-    /* copy over and delete the pixmap if we are in slow mode */
-    if (tablePtr->drawMode == DRAW_MODE_SLOW) {
-	/* Get a default valued GC */
-	TableGetGc(display, window, &(tablePtr->defaultTag), &tagGc);
-	XCopyArea(display, window, Tk_WindowId(tkwin), tagGc, 0, 0,
-		(unsigned) leftoverWidth, (unsigned) leftoverHeight,
-		invalidX, invalidY);
-	Tk_FreePixmap(display, window);
-	window = Tk_WindowId(tkwin);
+    Tcl_GetTime(&now);
+    return ((Tcl_WideInt) now.sec * 1000 + now.usec / 1000) / FLASH_TICK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableUnlinkFlash --
+ *	Takes a flashing cell out of its flash wheel slot.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Updates the flash wheel.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableUnlinkFlash(Table *tablePtr, TableFlash *flashPtr) {
+    if (flashPtr->prev != NULL) {
+	flashPtr->prev->next = flashPtr->next;
+    } else {
+	tablePtr->flashWheel[flashPtr->expire & (FLASH_WHEEL_SIZE-1)] = flashPtr->next;
     }
-#endif
-
-    if (tagGc != NULL) {
-	TableFreeGc(display, tagGc);
+    if (flashPtr->next != NULL) {
+	flashPtr->next->prev = flashPtr->prev;
     }
-    TableRedrawHighlight(tablePtr);
-    /*
-     * Free the hash table used to cache evaluations.
-     */
-    Tcl_DeleteHashTable(colTagsCache);
-    Tcl_Free((char *) (colTagsCache));
-    Tcl_DeleteHashTable(drawnCache);
-    Tcl_Free((char *) (drawnCache));
+    flashPtr->prev = flashPtr->next = NULL;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * TableInvalidate --
- *	Invalidates a rectangle and adds it to the total invalid rectangle
- *	waiting to be redrawn.  If the INV_FORCE flag bit is set,
- *	it does an update instantly else waits until Tk is idle.
+ * TableScheduleFlash --
+ *	(Re)starts the flash timer for the first slot of the flash
+ *	wheel after flashTick that holds flashing cells.
  *
  * Results:
- *	Will schedule table (re)display.
+ *	None
  *
  * Side effects:
- *	None
+ *	Deletes the flash timer, and creates it again if cells flash.
  *
  *----------------------------------------------------------------------
  */
-void TableInvalidate(Table * tablePtr, int x, int y, int w, int h, int flags) {
-    Tk_Window tkwin = tablePtr->tkwin;
-    int hl	= tablePtr->highlightWidth;
-    int height	= Tk_Height(tkwin);
-    int width	= Tk_Width(tkwin);
-
-    /*
-     * Make sure that the window hasn't been destroyed already.
-     * Avoid allocating 0 sized pixmaps which would be fatal,
-     * and check if rectangle is even on the screen.
-     */
-    if ((tkwin == NULL) || (w <= 0) || (h <= 0) || (x > width) || (y > height)) {
-	return;
+static void TableScheduleFlash(Table *tablePtr) {
+    Tcl_Time now;
+    Tcl_WideInt ms;
+    int i;
+
+    if (tablePtr->flashTimer != NULL) {
+	Tcl_DeleteTimerHandler(tablePtr->flashTimer);
+	tablePtr->flashTimer = NULL;
     }
-
-    /* If not even mapped, wait for the remap to redraw all */
-    if (!Tk_IsMapped(tkwin)) {
-	tablePtr->flags |= REDRAW_ON_MAP;
+    if (!tablePtr->flashMode || tablePtr->flashCells->numEntries == 0) {
 	return;
     }
-
-    /*
-     * If no pending updates exist, then replace the rectangle.
-     * Otherwise find the bounding rectangle.
-     */
-    if ((flags & INV_HIGHLIGHT) && (x < hl || y < hl || x+w >= width-hl || y+h >= height-hl)) {
-	tablePtr->flags |= REDRAW_BORDER;
-    }
-
-    if (tablePtr->flags & REDRAW_PENDING) {
-	tablePtr->invalidWidth = MAX(x + w, tablePtr->invalidX+tablePtr->invalidWidth);
-	tablePtr->invalidHeight = MAX(y + h, tablePtr->invalidY+tablePtr->invalidHeight);
-	if (tablePtr->invalidX > x) tablePtr->invalidX = x;
-	if (tablePtr->invalidY > y) tablePtr->invalidY = y;
-	tablePtr->invalidWidth  -= tablePtr->invalidX;
-	tablePtr->invalidHeight -= tablePtr->invalidY;
-	/* Do we want to force this update out? */
-	if (flags & INV_FORCE) {
-	    Tcl_CancelIdleCall(TableDisplay, (ClientData) tablePtr);
-	    TableDisplay((ClientData) tablePtr);
-	}
-    } else {
-	tablePtr->invalidX = x;
-	tablePtr->invalidY = y;
-	tablePtr->invalidWidth = w;
-	tablePtr->invalidHeight = h;
-	if (flags & INV_FORCE) {
-	    TableDisplay((ClientData) tablePtr);
-	} else {
-	    tablePtr->flags |= REDRAW_PENDING;
-	    Tcl_DoWhenIdle(TableDisplay, (ClientData) tablePtr);
+    /* a slot may only hold later rounds, then this wakes up for nothing */
+    for (i = 1; i < FLASH_WHEEL_SIZE; i++) {
+	if (tablePtr->flashWheel[(tablePtr->flashTick + i) & (FLASH_WHEEL_SIZE-1)] != NULL) {
+	    break;
 	}
     }
+    tablePtr->flashTimerTick = tablePtr->flashTick + i;
+    Tcl_GetTime(&now);
+    ms = tablePtr->flashTimerTick * FLASH_TICK
+	- ((Tcl_WideInt) now.sec * 1000 + now.usec / 1000);
+    tablePtr->flashTimer = Tcl_CreateTimerHandler((int) MAX(ms, 0),
+	    TableFlashEvent, (ClientData) tablePtr);
 }
 
 /*
@@ -2875,9 +4885,10 @@ void TableInvalidate(Table * tablePtr, int x, int y, int w, int h, int flags) {
  *	Called when the flash timer goes off.
  *
  * Results:
- *	Decrements all the entries in the hash table and invalidates
- *	any cells that expire, deleting them from the table.  If the
- *	table is now empty, stops the timer, else reenables it.
+ *	Ends the flashes in the flash wheel slots of the ticks that
+ *	passed since the last call, and invalidates the area of the
+ *	cells that stopped flashing as one region.  The timer is
+ *	restarted for the next slot holding flashing cells.
  *
  * Side effects:
  *	None
@@ -2886,35 +4897,41 @@ void TableInvalidate(Table * tablePtr, int x, int y, int w, int h, int flags) {
  */
 static void TableFlashEvent(ClientData clientdata) {
     Table *tablePtr = (Table *) clientdata;
-    Tcl_HashEntry *entryPtr;
-    Tcl_HashSearch search;
-    int entries, count, row, col;
+    TableFlash *flashPtr, *nextPtr;
+    Tcl_WideInt now;
+    int x, y, w, h, x1 = INT_MAX, y1 = INT_MAX, x2 = INT_MIN, y2 = INT_MIN;
 
-    entries = 0;
-    for (entryPtr = Tcl_FirstHashEntry(tablePtr->flashCells, &search);
-	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
-	count = PTR2INT(Tcl_GetHashValue(entryPtr));
-	if (--count <= 0) {
-	    /* get the cell address and invalidate that region only */
-	    TableParseArrayIndex(&row, &col, Tcl_GetHashKey(tablePtr->flashCells, entryPtr));
-
-	    /* delete the entry from the table */
-	    Tcl_DeleteHashEntry(entryPtr);
+    tablePtr->flashTimer = NULL;
+    now = TableFlashNow();
 
-	    TableRefresh(tablePtr, row-tablePtr->rowOffset, col-tablePtr->colOffset, CELL);
-	} else {
-	    Tcl_SetHashValue(entryPtr, INT2PTR(count));
-	    entries++;
+    /* one round of the wheel sees every slot */
+    if (now - tablePtr->flashTick > FLASH_WHEEL_SIZE) {
+	tablePtr->flashTick = now - FLASH_WHEEL_SIZE;
+    }
+    while (tablePtr->flashTick < now) {
+	tablePtr->flashTick++;
+	for (flashPtr = tablePtr->flashWheel[tablePtr->flashTick & (FLASH_WHEEL_SIZE-1)];
+	     flashPtr != NULL; flashPtr = nextPtr) {
+	    nextPtr = flashPtr->next;
+	    if (flashPtr->expire > now) {
+		/* a later round of the wheel */
+		continue;
+	    }
+	    if (TableCellVCoords(tablePtr, flashPtr->row-tablePtr->rowOffset,
+		    flashPtr->col-tablePtr->colOffset, &x, &y, &w, &h, 0)) {
+		x1 = MIN(x1, x);
+		y1 = MIN(y1, y);
+		x2 = MAX(x2, x+w);
+		y2 = MAX(y2, y+h);
+	    }
+	    TableDeleteFlash(tablePtr, flashPtr->entryPtr);
 	}
     }
-
-    /* do I need to restart the timer */
-    if (entries && tablePtr->flashMode) {
-	tablePtr->flashTimer = Tcl_CreateTimerHandler(250, TableFlashEvent,
-		(ClientData) tablePtr);
-    } else {
-	tablePtr->flashTimer = 0;
+    if (x1 < x2) {
+	TableInvalidate(tablePtr, x1, y1, x2-x1, y2-y1, 0);
     }
+
+    TableScheduleFlash(tablePtr);
 }
 
 /*
@@ -2933,25 +4950,125 @@ static void TableFlashEvent(ClientData clientdata) {
  *----------------------------------------------------------------------
  */
 void TableAddFlash(Table *tablePtr, int row, int col) {
-    char buf[INDEX_BUFSIZE];
-    int dummy;
+    int key[FLASH_KEY_WORDS], new;
     Tcl_HashEntry *entryPtr;
+    TableFlash *flashPtr, **slotPtr;
+    Tcl_WideInt now;
 
     if (!tablePtr->flashMode || tablePtr->flashTime < 1) {
 	return;
     }
 
-    /* create the array index in user coords */
-    TableMakeArrayIndex(row+tablePtr->rowOffset, col+tablePtr->colOffset, buf);
+    now = TableFlashNow();
+    if (tablePtr->flashCells->numEntries == 0) {
+	/* the wheel was idle, start counting from now */
+	tablePtr->flashTick = now;
+    }
+
+    /* the key is the cell in user coords */
+    key[0] = row+tablePtr->rowOffset;
+    key[1] = col+tablePtr->colOffset;
+    entryPtr = Tcl_CreateHashEntry(tablePtr->flashCells, (char *) key, &new);
+    if (new) {
+	flashPtr = (TableFlash *) Tcl_Alloc(sizeof(TableFlash));
+	flashPtr->row	   = key[0];
+	flashPtr->col	   = key[1];
+	flashPtr->entryPtr = entryPtr;
+	Tcl_SetHashValue(entryPtr, (ClientData) flashPtr);
+    } else {
+	/* flashing again, move it to its new slot */
+	flashPtr = (TableFlash *) Tcl_GetHashValue(entryPtr);
+	TableUnlinkFlash(tablePtr, flashPtr);
+    }
+    flashPtr->expire = now + tablePtr->flashTime;
+    slotPtr = &(tablePtr->flashWheel[flashPtr->expire & (FLASH_WHEEL_SIZE-1)]);
+    flashPtr->prev = NULL;
+    flashPtr->next = *slotPtr;
+    if (*slotPtr != NULL) {
+	(*slotPtr)->prev = flashPtr;
+    }
+    *slotPtr = flashPtr;
+
+    /* now set the timer if it's not already going soon enough */
+    if (tablePtr->flashTimer == NULL || flashPtr->expire < tablePtr->flashTimerTick) {
+	TableScheduleFlash(tablePtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFindFlash --
+ *	Looks up whether cell row,col (user coords) is flashing.
+ *
+ * Results:
+ *	Its entry in flashCells, or NULL.
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+Tcl_HashEntry *TableFindFlash(Table *tablePtr, int row, int col) {
+    int key[FLASH_KEY_WORDS];
+
+    key[0] = row;
+    key[1] = col;
+    return Tcl_FindHashEntry(tablePtr->flashCells, (char *) key);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableDeleteFlash --
+ *	Ends the flash of a cell, given its entry in flashCells.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	The entry is deleted and the cell taken out of the flash wheel.
+ *	The cell is not redrawn.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableDeleteFlash(Table *tablePtr, Tcl_HashEntry *entryPtr) {
+    TableFlash *flashPtr = (TableFlash *) Tcl_GetHashValue(entryPtr);
 
-    /* add the flash to the hash table */
-    entryPtr = Tcl_CreateHashEntry(tablePtr->flashCells, buf, &dummy);
-    Tcl_SetHashValue(entryPtr, INT2PTR(tablePtr->flashTime));
+    TableUnlinkFlash(tablePtr, flashPtr);
+    Tcl_DeleteHashEntry(entryPtr);
+    Tcl_Free((char *) flashPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableClearFlashes --
+ *	Ends the flashes of all cells.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Empties flashCells and the flash wheel, stops the flash timer.
+ *	The cells are not redrawn.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableClearFlashes(Table *tablePtr) {
+    Tcl_HashEntry *entryPtr;
+    Tcl_HashSearch search;
 
-    /* now set the timer if it's not already going and invalidate the area */
-    if (tablePtr->flashTimer == NULL) {
-	tablePtr->flashTimer = Tcl_CreateTimerHandler(250, TableFlashEvent,
-		(ClientData) tablePtr);
+    for (entryPtr = Tcl_FirstHashEntry(tablePtr->flashCells, &search);
+	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	Tcl_Free((char *) Tcl_GetHashValue(entryPtr));
+    }
+    Tcl_DeleteHashTable(tablePtr->flashCells);
+    Tcl_InitHashTable(tablePtr->flashCells, FLASH_KEY_WORDS);
+    memset((void *) tablePtr->flashWheel, 0, sizeof(tablePtr->flashWheel));
+    if (tablePtr->flashTimer != NULL) {
+	Tcl_DeleteTimerHandler(tablePtr->flashTimer);
+	tablePtr->flashTimer = NULL;
     }
 }
 
@@ -3042,10 +5159,10 @@ void TableGeometryRequest(Table *tablePtr) {
      * value of -maxwidth set by the programmer
      * Vice versa for rows/height
      */
-    x = MIN((tablePtr->maxReqCols==0 || tablePtr->maxReqCols > tablePtr->cols)?
+    x = (int) MIN((tablePtr->maxReqCols==0 || tablePtr->maxReqCols > tablePtr->cols)?
 	    tablePtr->maxWidth : tablePtr->colStarts[tablePtr->maxReqCols],
 	    tablePtr->maxReqWidth) + 2*tablePtr->highlightWidth;
-    y = MIN((tablePtr->maxReqRows==0 || tablePtr->maxReqRows > tablePtr->rows)?
+    y = (int) MIN((tablePtr->maxReqRows==0 || tablePtr->maxReqRows > tablePtr->rows)?
 	    tablePtr->maxHeight : tablePtr->rowStarts[tablePtr->maxReqRows],
 	    tablePtr->maxReqHeight) + 2*tablePtr->highlightWidth;
     Tk_GeometryRequest(tablePtr->tkwin, x, y);
@@ -3123,6 +5240,225 @@ void TableAdjustActive(Table *tablePtr) {
     tablePtr->oldActCol = tablePtr->activeCol;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableUpdateScrollbars --
+ *	Idle handler that passes the view fractions last computed by
+ *	TableAdjustParams to the -xscrollcommand and -yscrollcommand.
+ *	Each command is only called if its fractions changed since the
+ *	last time it was called.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Evaluates the scroll commands, which can do anything.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableUpdateScrollbars(ClientData clientData) {
+    Table *tablePtr = (Table *) clientData;
+    Tcl_Interp *interp = tablePtr->interp;
+    char buf[INDEX_BUFSIZE];
+    int code;
+
+    tablePtr->flags &= ~UPDATE_SCROLLBAR;
+    if (tablePtr->tkwin == NULL) {
+	return;
+    }
+
+    /*
+     * We must hold onto the interpreter and table because they might
+     * be freed as a result of the call to Tcl_VarEval.
+     */
+    Tcl_Preserve((ClientData) interp);
+    Tcl_Preserve((ClientData) tablePtr);
+
+    /* Do we have a Y-scrollbar and a changed view? */
+    if (tablePtr->yScrollCmd != NULL &&
+	    (tablePtr->yScrollFrac[0] != tablePtr->yScrollSent[0] ||
+	     tablePtr->yScrollFrac[1] != tablePtr->yScrollSent[1])) {
+	tablePtr->yScrollSent[0] = tablePtr->yScrollFrac[0];
+	tablePtr->yScrollSent[1] = tablePtr->yScrollFrac[1];
+	sprintf(buf, " %g %g", tablePtr->yScrollFrac[0], tablePtr->yScrollFrac[1]);
+	if ((code = Tcl_VarEval(interp, tablePtr->yScrollCmd, buf, (char *)NULL)) != TCL_OK) {
+	    Tcl_AddErrorInfo(interp, "\n\t(vertical scrolling command executed by table)");
+	    Tcl_BackgroundException(interp, code);
+	}
+    }
+    /* Do we have a X-scrollbar and a changed view? */
+    if (tablePtr->tkwin != NULL && tablePtr->xScrollCmd != NULL &&
+	    (tablePtr->xScrollFrac[0] != tablePtr->xScrollSent[0] ||
+	     tablePtr->xScrollFrac[1] != tablePtr->xScrollSent[1])) {
+	tablePtr->xScrollSent[0] = tablePtr->xScrollFrac[0];
+	tablePtr->xScrollSent[1] = tablePtr->xScrollFrac[1];
+	sprintf(buf, " %g %g", tablePtr->xScrollFrac[0], tablePtr->xScrollFrac[1]);
+	if ((code = Tcl_VarEval(interp, tablePtr->xScrollCmd, buf, (char *)NULL)) != TCL_OK) {
+	    Tcl_AddErrorInfo(interp, "\n\t(horizontal scrolling command executed by table)");
+	    Tcl_BackgroundException(interp, code);
+	}
+    }
+
+    Tcl_Release((ClientData) tablePtr);
+    Tcl_Release((ClientData) interp);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableScrollBlit --
+ *	Moves the displayed cells after the view was scrolled from
+ *	oldTopRow/oldLeftCol to topRow/leftCol.  The scrolled body is
+ *	copied within the window, the title rows are only moved
+ *	horizontally and the title cols only vertically, so that just
+ *	the newly exposed strips need to be redrawn.
+ *
+ * Results:
+ *	Returns 1 if the window was updated this way, 0 if the caller
+ *	should invalidate the whole table instead.
+ *
+ * Side effects:
+ *	Copies window contents and invalidates the exposed strips.
+ *	Areas that couldn't be copied arrive as GraphicsExpose events.
+ *	The backing pixmap is scrolled along with the window.
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableScrollBlit(Table *tablePtr) {
+#ifdef MAC_OSX_TK
+    /* Aqua can't reliably read back window contents */
+    return 0;
+#else
+    Tk_Window tkwin = tablePtr->tkwin;
+    Display *display = tablePtr->display;
+    Drawable window;
+    GC gc;
+    int hl = tablePtr->highlightWidth;
+    int dx, dy, bx, by, bw, bh, ax, ay, row, col, x, y, w, h, i, numRects;
+    Tcl_WideInt wdx, wdy;
+    TableRect rects[TABLE_MAX_INVALID];
+
+    if (tablePtr->oldTopRow < tablePtr->titleRows
+	    || tablePtr->oldTopRow >= tablePtr->rows
+	    || tablePtr->oldLeftCol < tablePtr->titleCols
+	    || tablePtr->oldLeftCol >= tablePtr->cols
+	    || !Tk_IsMapped(tkwin)
+	    /* embedded windows would have to be moved as well */
+	    || tablePtr->winTable->numEntries
+	    /* spans with a scrolled out head are drawn clipped */
+	    || (tablePtr->spanTbl && tablePtr->spanTbl->numEntries)) {
+	return 0;
+    }
+
+    window = Tk_WindowId(tkwin);
+#ifndef _WIN32
+    /* scroll the backing pixmap, a missing one is drawn in full */
+    if ((tablePtr->backPixmap == None)
+	    || (tablePtr->backWidth != Tk_Width(tkwin))
+	    || (tablePtr->backHeight != Tk_Height(tkwin))) {
+	return 0;
+    }
+    window = tablePtr->backPixmap;
+#endif
+
+    /* how far the old pixels move, positive is right/down */
+    wdx = tablePtr->colStarts[tablePtr->oldLeftCol] + tablePtr->oldLeftColShift
+	- tablePtr->colStarts[tablePtr->leftCol] - tablePtr->leftColShift;
+    wdy = tablePtr->rowStarts[tablePtr->oldTopRow] + tablePtr->oldTopRowShift
+	- tablePtr->rowStarts[tablePtr->topRow] - tablePtr->topRowShift;
+
+    /* the scrolled body of the table */
+    bx = hl + (int) tablePtr->colStarts[tablePtr->titleCols];
+    by = hl + (int) tablePtr->rowStarts[tablePtr->titleRows];
+    bw = Tk_Width(tkwin) - hl - bx;
+    bh = Tk_Height(tkwin) - hl - by;
+    if (bw <= 0 || bh <= 0 || wdx >= bw || -wdx >= bw
+	    || wdy >= bh || -wdy >= bh) {
+	return 0;
+    }
+    dx = (int) wdx;
+    dy = (int) wdy;
+
+    /*
+     * A pending redraw covers stale pixels that are about to move,
+     * so it has to follow them.
+     */
+    if (tablePtr->flags & REDRAW_PENDING) {
+	numRects = tablePtr->numInvalid;
+	memcpy((void *) rects, (void *) tablePtr->invalid, numRects * sizeof(TableRect));
+	for (i = 0; i < numRects; i++) {
+	    TableInvalidate(tablePtr, rects[i].x + dx, rects[i].y + dy,
+		    rects[i].width, rects[i].height, 0);
+	}
+    }
+
+    gc = Tk_3DBorderGC(tkwin, tablePtr->defaultTag.bg, TK_3D_FLAT_GC);
+    ax = abs(dx);
+    ay = abs(dy);
+    XCopyArea(display, window, window, gc,
+	    bx + MAX(0, -dx), by + MAX(0, -dy), (unsigned) (bw - ax),
+	    (unsigned) (bh - ay), bx + MAX(0, dx), by + MAX(0, dy));
+    if (dx && tablePtr->titleRows) {
+	XCopyArea(display, window, window, gc,
+		bx + MAX(0, -dx), hl, (unsigned) (bw - ax), (unsigned) (by - hl),
+		bx + MAX(0, dx), hl);
+    }
+    if (dy && tablePtr->titleCols) {
+	XCopyArea(display, window, window, gc,
+		hl, by + MAX(0, -dy), (unsigned) (bx - hl), (unsigned) (bh - ay),
+		hl, by + MAX(0, dy));
+    }
+    if (window != Tk_WindowId(tkwin)) {
+	/*
+	 * Show only what moved.  The strips that scrolled in hold stale
+	 * pixels in the pixmap and reach the window with their redraw.
+	 */
+	XCopyArea(display, window, Tk_WindowId(tkwin), gc,
+		bx + MAX(0, dx), by + MAX(0, dy), (unsigned) (bw - ax),
+		(unsigned) (bh - ay), bx + MAX(0, dx), by + MAX(0, dy));
+	if (dx && tablePtr->titleRows) {
+	    XCopyArea(display, window, Tk_WindowId(tkwin), gc,
+		    bx + MAX(0, dx), hl, (unsigned) (bw - ax), (unsigned) (by - hl),
+		    bx + MAX(0, dx), hl);
+	}
+	if (dy && tablePtr->titleCols) {
+	    XCopyArea(display, window, Tk_WindowId(tkwin), gc,
+		    hl, by + MAX(0, dy), (unsigned) (bx - hl), (unsigned) (bh - ay),
+		    hl, by + MAX(0, dy));
+	}
+	/* the cells moved away from their recorded positions */
+	TableFlushCellSigs(tablePtr);
+    }
+
+    /*
+     * When stretching, the cell at the right/bottom edge is drawn cut
+     * to the window, so it has to be redrawn once it moves inwards.
+     */
+    if (dx < 0 && tablePtr->colStretch != STRETCH_MODE_NONE) {
+	TableWhatCell(tablePtr, bx + bw - 1 + dx, by, &row, &col);
+	TableCellCoords(tablePtr, row, col, &x, &y, &w, &h);
+	ax = MIN(bw, bx + bw - x);
+    }
+    if (dy < 0 && tablePtr->rowStretch != STRETCH_MODE_NONE) {
+	TableWhatCell(tablePtr, bx, by + bh - 1 + dy, &row, &col);
+	TableCellCoords(tablePtr, row, col, &x, &y, &w, &h);
+	ay = MIN(bh, by + bh - y);
+    }
+
+    /* redraw only the strips that scrolled into view */
+    if (dx) {
+	TableInvalidate(tablePtr, (dx > 0) ? bx : bx + bw - ax, hl,
+		ax, Tk_Height(tkwin) - 2*hl, 0);
+    }
+    if (dy) {
+	TableInvalidate(tablePtr, hl, (dy > 0) ? by : by + bh - ay,
+		Tk_Width(tkwin) - 2*hl, ay, 0);
+    }
+    return 1;
+#endif
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3144,11 +5480,26 @@ void TableAdjustActive(Table *tablePtr) {
  *----------------------------------------------------------------------
  */
 void TableAdjustParams(Table *tablePtr) {
-    int topRow, leftCol, row, col, total, i, value, x, y, width, height,
-	w, h, hl, px, py, recalc, bd[4], diff, unpreset, lastUnpreset, pad, lastPad, numPixels,
-	defColWidth, defRowHeight;
+    int topRow, leftCol, row, col, i, value, x, y, width, height,
+	w, h, hl, px, py, recalc, bd[4], diff, unpreset, lastUnpreset, pad, lastPad,
+	defColWidth, defRowHeight, scrollOnly, stretched = 0;
+    Tcl_WideInt total, numPixels;
     Tcl_HashEntry *entryPtr;
 
+    /* only the view commands may let us move the old pixels */
+    scrollOnly = (tablePtr->flags & SCROLL_VIEW);
+    tablePtr->flags &= ~SCROLL_VIEW;
+
+    /*
+     * A view permutation can't outlive the rows|cols it covers
+     */
+    if (tablePtr->rowPermSize > TableAllRows(tablePtr)) {
+	TableSetPerm(tablePtr, ROW, NULL, 0);
+    }
+    if (tablePtr->colPermSize > tablePtr->cols) {
+	TableSetPerm(tablePtr, COL, NULL, 0);
+    }
+
     /*
      * Cache some values for many upcoming calculations
      */
@@ -3184,7 +5535,8 @@ void TableAdjustParams(Table *tablePtr) {
     if (tablePtr->colPixels) Tcl_Free((char *) tablePtr->colPixels);
     tablePtr->colPixels = (int *) Tcl_Alloc(tablePtr->cols * sizeof(int));
     if (tablePtr->colStarts) Tcl_Free((char *) tablePtr->colStarts);
-    tablePtr->colStarts = (int *) Tcl_Alloc((tablePtr->cols+1) * sizeof(int));
+    tablePtr->colStarts = (Tcl_WideInt *)
+	Tcl_Alloc((tablePtr->cols+1) * sizeof(Tcl_WideInt));
 
     /*
      * Get all the preset columns and set their widths
@@ -3193,7 +5545,8 @@ void TableAdjustParams(Table *tablePtr) {
     numPixels = 0;
     unpreset = 0;
     for (i = 0; i < tablePtr->cols; i++) {
-	entryPtr = Tcl_FindHashEntry(tablePtr->colWidths, INT2PTR(i));
+	entryPtr = Tcl_FindHashEntry(tablePtr->colWidths,
+		INT2PTR((i < tablePtr->colPermSize) ? tablePtr->colPerm[i] : i));
 	if (entryPtr == NULL) {
 	    tablePtr->colPixels[i] = -1;
 	    unpreset++;
@@ -3216,7 +5569,8 @@ void TableAdjustParams(Table *tablePtr) {
     /*
      * Work out how much to pad each col depending on the mode.
      */
-    diff  = w - numPixels - (unpreset * defColWidth);
+    diff  = (int) MAX(-INT_MAX,
+	    w - numPixels - ((Tcl_WideInt) unpreset * defColWidth));
     total = 0;
 
     /*
@@ -3286,7 +5640,9 @@ void TableAdjustParams(Table *tablePtr) {
 	numPixels	= 0;
 	unpreset	= 0;
 	for (i = 0; i < tablePtr->rows; i++) {
-	    entryPtr = Tcl_FindHashEntry(tablePtr->rowHeights, INT2PTR(i));
+	    entryPtr = Tcl_FindHashEntry(tablePtr->rowHeights,
+		    INT2PTR(TableViewToData(tablePtr, i+tablePtr->rowOffset, ROW)
+			    - tablePtr->rowOffset));
 	    if (entryPtr == NULL) {
 		tablePtr->rowPixels[i] = -1;
 		unpreset++;
@@ -3307,7 +5663,8 @@ void TableAdjustParams(Table *tablePtr) {
 	}
 
 	/* work out how much to pad each row depending on the mode */
-	diff = h - numPixels - (unpreset * defRowHeight);
+	diff = (int) MAX(-INT_MAX,
+		h - numPixels - ((Tcl_WideInt) unpreset * defRowHeight));
 	switch(tablePtr->rowStretch) {
 	case STRETCH_MODE_NONE:
 	    pad		= 0;
@@ -3353,7 +5710,8 @@ void TableAdjustParams(Table *tablePtr) {
     } while (recalc);
 
     if (tablePtr->rowStarts) Tcl_Free((char *) tablePtr->rowStarts);
-    tablePtr->rowStarts = (int *) Tcl_Alloc((tablePtr->rows+1)*sizeof(int));
+    tablePtr->rowStarts = (Tcl_WideInt *)
+	Tcl_Alloc((tablePtr->rows+1)*sizeof(Tcl_WideInt));
     /*
      * Now do the padding and calculate the row starts
      */
@@ -3375,6 +5733,18 @@ void TableAdjustParams(Table *tablePtr) {
      */
     CONSTRAIN(tablePtr->topRow, tablePtr->titleRows, tablePtr->rows-1);
     CONSTRAIN(tablePtr->leftCol, tablePtr->titleCols, tablePtr->cols-1);
+    if (tablePtr->topRow < tablePtr->titleRows) {
+	tablePtr->topRowShift = 0;
+    } else {
+	tablePtr->topRowShift = MAX(0, MIN(tablePtr->topRowShift,
+		    tablePtr->rowPixels[tablePtr->topRow]-1));
+    }
+    if (tablePtr->leftCol < tablePtr->titleCols) {
+	tablePtr->leftColShift = 0;
+    } else {
+	tablePtr->leftColShift = MAX(0, MIN(tablePtr->leftColShift,
+		    tablePtr->colPixels[tablePtr->leftCol]-1));
+    }
 
     /*
      * If we don't have the info, don't bother to fix up the other parameters
@@ -3414,6 +5784,21 @@ void TableAdjustParams(Table *tablePtr) {
     tablePtr->topRow  = topRow;
     tablePtr->leftCol = leftCol;
 
+    /*
+     * Never shift the top row or left col further than what is needed
+     * to bring the last row or col fully into view.
+     */
+    if (tablePtr->topRowShift) {
+	total = tablePtr->maxHeight - tablePtr->rowStarts[topRow]
+	    - (h - hl - tablePtr->rowStarts[tablePtr->titleRows]);
+	tablePtr->topRowShift = (int) MAX(0, MIN(tablePtr->topRowShift, total));
+    }
+    if (tablePtr->leftColShift) {
+	total = tablePtr->maxWidth - tablePtr->colStarts[leftCol]
+	    - (w - hl - tablePtr->colStarts[tablePtr->titleCols]);
+	tablePtr->leftColShift = (int) MAX(0, MIN(tablePtr->leftColShift, total));
+    }
+
     /*
      * Now work out where the bottom right is for scrollbar update and to test
      * for one last stretch.  Avoid the confusion that spans could cause for
@@ -3433,63 +5818,22 @@ void TableAdjustParams(Table *tablePtr) {
      * absolute row and column numbers.
      */
     if (tablePtr->yScrollCmd != NULL || tablePtr->xScrollCmd != NULL) {
-	Tcl_Interp *interp = tablePtr->interp;
-	char buf[INDEX_BUFSIZE];
-	double first, last;
-	int code;
-
+	TableViewFractions(tablePtr, 1, &tablePtr->yScrollFrac[0],
+		&tablePtr->yScrollFrac[1]);
+	TableViewFractions(tablePtr, 0, &tablePtr->xScrollFrac[0],
+		&tablePtr->xScrollFrac[1]);
 	/*
-	 * We must hold onto the interpreter because the data referred to at
-	 * tablePtr might be freed as a result of the call to Tcl_VarEval.
+	 * Only tell the scrollbars about a changed view, and then just
+	 * once for all the adjustments made before going idle.
 	 */
-	Tcl_Preserve((ClientData) interp);
-
-	/* Do we have a Y-scrollbar and rows to scroll? */
-	if (tablePtr->yScrollCmd != NULL) {
-	    if (row < tablePtr->titleRows) {
-		first = 0;
-		last  = 1;
-	    } else {
-		diff = tablePtr->rowStarts[tablePtr->titleRows];
-		last = (double) (tablePtr->rowStarts[tablePtr->rows]-diff);
-		if (last <= 0.0) {
-		    first = 0;
-		    last  = 1;
-		} else {
-		    first = (tablePtr->rowStarts[topRow]-diff) / last;
-		    last  = (height+tablePtr->rowStarts[row]-diff) / last;
-		}
-	    }
-	    sprintf(buf, " %g %g", first, last);
-	    if ((code = Tcl_VarEval(interp, tablePtr->yScrollCmd, buf, (char *)NULL)) != TCL_OK) {
-		Tcl_AddErrorInfo(interp, "\n\t(vertical scrolling command executed by table)");
-		Tcl_BackgroundException(interp, code);
-	    }
-	}
-	/* Do we have a X-scrollbar and cols to scroll? */
-	if (tablePtr->xScrollCmd != NULL) {
-	    if (col < tablePtr->titleCols) {
-		first = 0;
-		last  = 1;
-	    } else {
-		diff = tablePtr->colStarts[tablePtr->titleCols];
-		last = (double) (tablePtr->colStarts[tablePtr->cols]-diff);
-		if (last <= 0.0) {
-		    first = 0;
-		    last  = 1;
-		} else {
-		    first = (tablePtr->colStarts[leftCol]-diff) / last;
-		    last  = (width+tablePtr->colStarts[col]-diff) / last;
-		}
-	    }
-	    sprintf(buf, " %g %g", first, last);
-	    if ((code = Tcl_VarEval(interp, tablePtr->xScrollCmd, buf, (char *)NULL)) != TCL_OK) {
-		Tcl_AddErrorInfo(interp, "\n\t(horizontal scrolling command executed by table)");
-		Tcl_BackgroundException(interp, code);
-	    }
+	if (!(tablePtr->flags & UPDATE_SCROLLBAR) && (
+		    tablePtr->yScrollFrac[0] != tablePtr->yScrollSent[0] ||
+		    tablePtr->yScrollFrac[1] != tablePtr->yScrollSent[1] ||
+		    tablePtr->xScrollFrac[0] != tablePtr->xScrollSent[0] ||
+		    tablePtr->xScrollFrac[1] != tablePtr->xScrollSent[1])) {
+	    tablePtr->flags |= UPDATE_SCROLLBAR;
+	    Tcl_DoWhenIdle(TableUpdateScrollbars, (ClientData) tablePtr);
 	}
-
-	Tcl_Release((ClientData) interp);
     }
 
     /*
@@ -3501,6 +5845,7 @@ void TableAdjustParams(Table *tablePtr) {
 	if (diff > 0) {
 	    tablePtr->rowPixels[tablePtr->rows-1] += diff;
 	    tablePtr->rowStarts[tablePtr->rows] += diff;
+	    stretched = 1;
 	}
     }
     if (col == tablePtr->cols-1 && tablePtr->colStretch != STRETCH_MODE_NONE) {
@@ -3508,8 +5853,19 @@ void TableAdjustParams(Table *tablePtr) {
 	if (diff > 0) {
 	    tablePtr->colPixels[tablePtr->cols-1] += diff;
 	    tablePtr->colStarts[tablePtr->cols] += diff;
+	    stretched = 1;
 	}
     }
+    if (tablePtr->flags & LAST_STRETCHED) {
+	/* the old pixels of the last row/col don't match the new size */
+	scrollOnly = 0;
+    }
+    if (stretched) {
+	tablePtr->flags |= LAST_STRETCHED;
+	scrollOnly = 0;
+    } else {
+	tablePtr->flags &= ~LAST_STRETCHED;
+    }
 
     TableAdjustActive(tablePtr);
 
@@ -3518,13 +5874,77 @@ void TableAdjustParams(Table *tablePtr) {
      * If they changed, invalidate the area, else leave it alone
      */
     if (tablePtr->topRow != tablePtr->oldTopRow ||
-	tablePtr->leftCol != tablePtr->oldLeftCol) {
+	tablePtr->leftCol != tablePtr->oldLeftCol ||
+	tablePtr->topRowShift != tablePtr->oldTopRowShift ||
+	tablePtr->leftColShift != tablePtr->oldLeftColShift) {
+	if (!scrollOnly || !TableScrollBlit(tablePtr)) {
+	    /* only the upper corner title cells wouldn't change */
+	    TableInvalidateAll(tablePtr, 0);
+	}
 	/* set the old top row/col for the next time this function is called */
 	tablePtr->oldTopRow = tablePtr->topRow;
 	tablePtr->oldLeftCol = tablePtr->leftCol;
-	/* only the upper corner title cells wouldn't change */
-	TableInvalidateAll(tablePtr, 0);
+	tablePtr->oldTopRowShift = tablePtr->topRowShift;
+	tablePtr->oldLeftColShift = tablePtr->leftColShift;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableBlinkCursor --
+ *	Switches the insert cursor on or off (following CURSOR_ON) by
+ *	painting or restoring only the cursor rectangle remembered by
+ *	TableSaveCursor, instead of redrawing the active cell.
+ *
+ * Results:
+ *	1 if the cursor was updated, 0 if the remembered spot can't be
+ *	trusted and the cell must be refreshed instead.
+ *
+ * Side effects:
+ *	Draws into the window (and its backing pixmap).
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableBlinkCursor(Table *tablePtr) {
+    Tk_Window tkwin = tablePtr->tkwin;
+    TableRect *rectPtr = &(tablePtr->cursorRect);
+    Drawable window;
+    GC gc;
+    int x, y, w, h;
+
+    /*
+     * Anything pending may change the cell, and the cell must still
+     * be fully shown where it was when the spot was saved.
+     */
+    if (!tablePtr->cursorValid || (tkwin == NULL) || !Tk_IsMapped(tkwin)
+	    || (tablePtr->flags & (REDRAW_PENDING|REDRAW_ON_MAP))
+	    || !(tablePtr->flags & HAS_ACTIVE)
+	    || !TableCellVCoords(tablePtr, tablePtr->activeRow,
+		    tablePtr->activeCol, &x, &y, &w, &h, 1)
+	    || (x != tablePtr->cursorCell.x) || (y != tablePtr->cursorCell.y)
+	    || (w != tablePtr->cursorCell.width)
+	    || (h != tablePtr->cursorCell.height)) {
+	return 0;
+    }
+
+    window = (tablePtr->backPixmap != None) ?
+	tablePtr->backPixmap : Tk_WindowId(tkwin);
+    gc = Tk_3DBorderGC(tkwin, tablePtr->defaultTag.bg, TK_3D_FLAT_GC);
+    if (tablePtr->flags & CURSOR_ON) {
+	Tk_Fill3DRectangle(tkwin, window, tablePtr->insertBg, rectPtr->x,
+		rectPtr->y, rectPtr->width, rectPtr->height, 0, TK_RELIEF_FLAT);
+    } else {
+	XCopyArea(tablePtr->display, tablePtr->cursorSave, window, gc, 0, 0,
+		(unsigned) rectPtr->width, (unsigned) rectPtr->height,
+		rectPtr->x, rectPtr->y);
+    }
+    if (window != Tk_WindowId(tkwin)) {
+	XCopyArea(tablePtr->display, window, Tk_WindowId(tkwin), gc,
+		rectPtr->x, rectPtr->y, (unsigned) rectPtr->width,
+		(unsigned) rectPtr->height, rectPtr->x, rectPtr->y);
     }
+    return 1;
 }
 
 /*
@@ -3562,8 +5982,10 @@ static void TableCursorEvent(ClientData clientData) {
     /* Toggle the cursor */
     tablePtr->flags ^= CURSOR_ON;
 
-    /* invalidate the cell */
-    TableRefresh(tablePtr, tablePtr->activeRow, tablePtr->activeCol, CELL);
+    /* paint just the cursor if possible, else invalidate the cell */
+    if (!TableBlinkCursor(tablePtr)) {
+	TableRefresh(tablePtr, tablePtr->activeRow, tablePtr->activeCol, CELL);
+    }
 }
 
 /*
@@ -3595,7 +6017,9 @@ void TableConfigCursor(Table *tablePtr) {
 	    /*
 	     * Only refresh when we toggled cursor
 	     */
-	    TableRefresh(tablePtr, tablePtr->activeRow, tablePtr->activeCol, CELL);
+	    if (!TableBlinkCursor(tablePtr)) {
+		TableRefresh(tablePtr, tablePtr->activeRow, tablePtr->activeCol, CELL);
+	    }
 	}
 
 	/* set up the first timer */
@@ -3612,7 +6036,9 @@ void TableConfigCursor(Table *tablePtr) {
 	 */
 	if ((tablePtr->flags & CURSOR_ON)) {
 	    tablePtr->flags &= ~CURSOR_ON;
-	    TableRefresh(tablePtr, tablePtr->activeRow, tablePtr->activeCol, CELL);
+	    if (!TableBlinkCursor(tablePtr)) {
+		TableRefresh(tablePtr, tablePtr->activeRow, tablePtr->activeCol, CELL);
+	    }
 	}
 
 	/* and disable the timer */
@@ -16,12 +16,14 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <ctype.h>
 #ifdef HAVE_INTTYPES_H
 # include <inttypes.h>
 #endif
 #include <tk.h>
 #include <X11/Xatom.h>
+#include <X11/Xutil.h>
 
 /* Platform unique definitions */
 #ifdef MAC_OSX_TK
@@ -167,6 +169,7 @@
 #define STREQ(s1, s2)	(strcmp((s1), (s2)) == 0)
 #define ARSIZE(A)	(sizeof(A)/sizeof(*A))
 #define INDEX_BUFSIZE	32		/* max size of buffer for indices */
+#define TABLE_MAX_INVALID 8		/* max invalid rectangles kept apart */
 #define TEST_KEY	"#TEST KEY#"	/* index for testing array existence */
 
 /*
@@ -191,8 +194,15 @@
  * OVER_BORDER:		Non-zero means we are over a table cell border
  * REDRAW_ON_MAP:	Forces a redraw on the unmap
  * AVOID_SPANS:		prevent cell spans from being used
- *
- * FIX - consider adding UPDATE_SCROLLBAR a la entry
+ * SCROLL_VIEW:		TableAdjustParams is called only to scroll the view,
+ *			so the displayed cells may be moved with XCopyArea
+ * LAST_STRETCHED:	the last visible row or col was stretched to fill
+ *			the window, so its pixels can't be moved
+ * UPDATE_SCROLLBAR:	the scroll commands are to be called at idle time
+ * UPDATE_FILTER:	a row changed whether it matches the row filter,
+ *			which is to be rebuilt at idle time
+ * SNAPSHOT:		cells are rendered off-screen by TableSnapshot
+ * FLUSHING:		the flush method draws all pending damage at once
  */
 #define REDRAW_PENDING		(1L<<0)
 #define CURSOR_ON		(1L<<1)
@@ -208,6 +218,12 @@
 #define OVER_BORDER		(1L<<11)
 #define REDRAW_ON_MAP		(1L<<12)
 #define AVOID_SPANS		(1L<<13)
+#define SCROLL_VIEW		(1L<<14)
+#define LAST_STRETCHED		(1L<<15)
+#define UPDATE_SCROLLBAR	(1L<<16)
+#define UPDATE_FILTER		(1L<<17)
+#define SNAPSHOT		(1L<<18)
+#define FLUSHING		(1L<<19)
 
 /* Flags for TableInvalidate && TableRedraw */
 #define ROW		(1L<<0)
@@ -233,6 +249,15 @@
 #define SEL_CELL	(1<<3)
 #define SEL_NONE	(1<<4)
 
+/*
+ * Cell state for TableResolveTag, by bit
+ */
+#define STYLE_TITLE	(1<<0)	/* cell is in the titles */
+#define STYLE_ACTIVE	(1<<1)	/* cell is the active cell */
+#define STYLE_SEL	(1<<2)	/* cell is selected */
+#define STYLE_FLASH	(1<<3)	/* cell is flashing */
+#define STYLE_DISABLED	(1<<4)	/* result only: active cell is disabled */
+
 /*
  * Definitions for tablePtr->dataSource, by bit
  */
@@ -256,6 +281,13 @@ typedef enum {
     STATE_NORMAL, STATE_DISABLED, STATE_ACTIVE, STATE_LAST
 } TableState;
 
+/*
+ * A rectangle of the window waiting to be redrawn
+ */
+typedef struct {
+    int x, y, width, height;
+} TableRect;
+
 /*
  * Structure for use in parsing table commands/values.
  * Accessor functions defined in tkTableUtil.c
@@ -289,6 +321,71 @@ typedef struct {
     char *	ellipsis;	/* ellipsis to display on clipped text */
 } TableTag;
 
+/*
+ * An entry in the text layout cache, see TableGetTextLayout
+ */
+typedef struct {
+    Tk_TextLayout layout;	/* layout of the string in the hash key */
+    int		width, height;	/* dimensions of the layout */
+} TableLayout;
+
+/*
+ * The byte length, char count and an ASCII flag of a cell value.
+ * Values in the cell cache carry this just before their first byte,
+ * see TableNewCacheValue.
+ */
+typedef struct {
+    int		length;		/* bytes, without the terminating null */
+    int		numChars;	/* UTF-8 characters */
+    int		ascii;		/* whether all bytes are 7 bit (so
+				 * numChars == length) */
+} TableValueInfo;
+
+/*
+ * An entry in the fitted text cache, see TableFitText
+ */
+typedef struct {
+    int		start, length;	/* bytes of the string that fit */
+    int		width;		/* width of those bytes */
+} TableFit;
+
+/*
+ * The key of a merged tag in the style cache, see TableResolveTag.
+ * Its size is a multiple of an int, as it is used as an array key.
+ */
+typedef struct {
+    TableTag *colPtr, *rowPtr, *cellPtr;	/* tags merged, or NULL */
+    size_t	state;		/* STYLE_* bits of the cell */
+} TableStyleKey;
+
+#define STYLE_KEY_WORDS	(sizeof(TableStyleKey)/sizeof(int))
+
+/*
+ * The key of a GC in the GC cache, see TableGetGc.
+ */
+typedef struct {
+    unsigned long fg, bg;	/* foreground and background pixels */
+    unsigned long font;		/* font id */
+} TableGcKey;
+
+#define GC_KEY_WORDS	(sizeof(TableGcKey)/sizeof(int))
+
+/*
+ * A flashing cell, see TableAddFlash.  flashCells maps its row,col
+ * (user coords, as an array key of two ints) to it, and it is linked
+ * into the slot of the flash wheel for the tick its flash ends at.
+ */
+typedef struct TableFlash {
+    int		row, col;	/* user coords, also the hash key */
+    Tcl_WideInt	expire;		/* flash tick the flash ends at */
+    struct TableFlash *prev, *next; /* in its flash wheel slot */
+    Tcl_HashEntry *entryPtr;	/* in flashCells */
+} TableFlash;
+
+#define FLASH_KEY_WORDS		2	/* row and col */
+#define FLASH_WHEEL_SIZE	64	/* slots of the flash wheel, a power of 2 */
+#define FLASH_TICK		250	/* ms per flash tick, the -flashtime unit */
+
 /*  The widget structure for the table Widget */
 
 typedef struct {
@@ -322,6 +419,10 @@ typedef struct {
     TableTag defaultTag;	/* the default tag colors/fonts etc */
     char *yScrollCmd;		/* the y-scroll command */
     char *xScrollCmd;		/* the x-scroll command */
+    double yScrollFrac[2], xScrollFrac[2];	/* view fractions waiting
+				 * to be passed to the scroll commands */
+    double yScrollSent[2], xScrollSent[2];	/* the view fractions last
+				 * passed to the scroll commands */
     char *browseCmd;		/* the command that is called when the
 				 * active cell changes */
     int caching;		/* whether to cache values of table */
@@ -361,7 +462,12 @@ typedef struct {
     int rowOffset;		/* Y index of topmost row in the display */
     int drawMode;		/* The mode to use when redrawing */
     int flashMode;		/* Specifies whether flashing is enabled */
-    int flashTime;		/* The number of ms to flash a cell for */
+    int flashTime;		/* The number of FLASH_TICKs to flash a cell for */
+    int maxFps;			/* most redisplays per second, <= 0 for
+				 * no limit */
+    int renderBudget;		/* ms a redisplay may take before the rest
+				 * is left to the next idle callback,
+				 * <= 0 for no limit */
     int resize;			/* -resizeborders option for interactive
 				 * resizing of borders */
     int sparse;			/* Whether to use "sparse" arrays by
@@ -394,9 +500,12 @@ typedef struct {
 				 * fixed title rows.  This is just the
 				 * config request.  The actual cell used may
 				 * be different to keep the screen full */
+    int topRowShift, leftColShift;	/* pixels of topRow,leftCol scrolled
+				 * out of view, for smooth scrolling */
     int anchorRow, anchorCol;	/* the row,col of the anchor cell */
     int activeRow, activeCol;	/* the row,col of the active cell */
     int oldTopRow, oldLeftCol;	/* cached by TableAdjustParams */
+    int oldTopRowShift, oldLeftColShift; /* cached by TableAdjustParams */
     int oldActRow, oldActCol;	/* cached by TableAdjustParams */
     int icursor;		/* The index of the insertion cursor in the
 				 * active cell */
@@ -404,10 +513,12 @@ typedef struct {
 				 * redraw/cursor etc. */
     int dataSource;		/* where our data comes from:
 				 * DATA_{NONE,CACHE,ARRAY,COMMAND} */
-    int maxWidth, maxHeight;	/* max width|height required in pixels */
+    Tcl_WideInt maxWidth, maxHeight;	/* max width|height required in
+				 * pixels, 64-bit for very long tables */
     int charWidth, charHeight;	/* size of a character in the default font */
     int *colPixels, *rowPixels;	/* Array of the pixel widths/heights */
-    int *colStarts, *rowStarts;	/* Array of start pixels for rows|columns */
+    Tcl_WideInt *colStarts, *rowStarts;	/* Array of start pixels for
+				 * rows|columns */
     int scanMarkX, scanMarkY;	/* Used by "scan" and "border" to mark */
     int scanMarkRow, scanMarkCol;/* necessary information for dragto */
     /* values in these are kept in user coords */
@@ -419,6 +530,28 @@ typedef struct {
      */
     Tcl_HashTable *colWidths;	/* hash table of non default column widths */
     Tcl_HashTable *rowHeights;	/* hash table of non default row heights */
+
+    /*
+     * The view permutation maps a displayed (view) row|col to the data
+     * row|col shown there, and the inverse maps back.  Both are indexed
+     * from 0 like colWidths.  NULL means the identity, and indices at or
+     * beyond the *PermSize are never permuted.
+     */
+    int *rowPerm, *colPerm;	/* view -> data index */
+    int *rowPermInv, *colPermInv;/* data -> view index */
+    int rowPermSize, colPermSize;/* number of entries in the above */
+
+    /*
+     * A row filter hides the rows that don't match it.  While it is
+     * active, rows only counts the visible rows and filterRows holds the
+     * real number of rows.  The filter maps visible rows to their place
+     * in the (permuted) row order, indexed from 0.
+     */
+    struct TableFilter *filterPtr;/* parsed filter terms, NULL if none */
+    int *rowFilter;		/* visible row -> row order position */
+    int *rowFilterInv;		/* row order position -> visible row or -1 */
+    char *rowMatch;		/* whether each data row matches */
+    int filterRows;		/* number of rows, including hidden ones */
     Tcl_HashTable *spanTbl;	/* table for spans */
     Tcl_HashTable *spanAffTbl;	/* table for cells affected by spans */
     Tcl_HashTable *tagTable;	/* table for style tags */
@@ -427,9 +560,25 @@ typedef struct {
     Tcl_HashTable *colStyles;	/* table for col styles */
     Tcl_HashTable *cellStyles;	/* table for cell styles */
     Tcl_HashTable *flashCells;	/* table of flashing cells */
+    TableFlash *flashWheel[FLASH_WHEEL_SIZE]; /* flashing cells by the
+				 * tick they end at, modulo the size */
+    Tcl_WideInt flashTick;	/* last flash tick handled */
+    Tcl_WideInt flashTimerTick;	/* flash tick flashTimer fires at */
     Tcl_HashTable *selCells;	/* table of selected cells */
+    Tcl_HashTable *measureCache;/* measured text widths keyed by font and
+				 * string, used by "width col -auto" */
+    Tcl_HashTable *fitCache;	/* TableFits of clipped single line text
+				 * keyed by font, width, side and string */
+    Tcl_HashTable *layoutCache;	/* TableLayouts of displayed cell text keyed
+				 * by font, wrap width, flags and string */
+    Tcl_HashTable *styleCache;	/* merged cell tags keyed by the tags and
+				 * state they were merged from */
+    Tcl_HashTable *gcCache;	/* GCs for drawing cell text keyed by
+				 * fg pixel, bg pixel and font id */
     Tcl_TimerToken cursorTimer;	/* timer token for the cursor blinking */
     Tcl_TimerToken flashTimer;	/* timer token for the cell flashing */
+    Tcl_TimerToken redrawTimer;	/* timer token for a redisplay held back
+				 * by -maxfps */
     char *activeBuf;		/* buffer where the selection is kept
 				 * for editing the active cell */
     char **tagPrioNames;	/* list of tag names in priority order */
@@ -439,8 +588,41 @@ typedef struct {
     int tagPrioSize;		/* size of tagPrios list */
     int tagPrioMax;		/* max allocated size of tagPrios list */
 
-    /* The invalid rectangle if there is an update pending */
-    int invalidX, invalidY, invalidWidth, invalidHeight;
+    /* The invalid rectangles if there is an update pending */
+    TableRect invalid[TABLE_MAX_INVALID];
+    int numInvalid;
+    Pixmap backPixmap;		/* persistent copy of the whole window the
+				 * table is drawn into, None if unused */
+    int backWidth, backHeight;	/* size of backPixmap */
+    Pixmap clipPixmap;		/* scratch pixmap overflowing cell text
+				 * is clipped through, None if unused */
+    int clipWidth, clipHeight;	/* size of clipPixmap */
+    Pixmap cellPixmap;		/* scratch pixmap partially hidden cells
+				 * are drawn on, None if unused */
+    int cellPixWidth, cellPixHeight; /* size of cellPixmap */
+    Pixmap cursorSave;		/* what lies under the insert cursor of
+				 * the active cell, None if unused */
+    int cursorSaveWidth, cursorSaveHeight; /* size of cursorSave */
+    TableRect cursorRect;	/* where the insert cursor is drawn */
+    TableRect cursorCell;	/* the active cell when cursorRect was set */
+    int cursorValid;		/* whether cursorRect and cursorSave are
+				 * usable by TableBlinkCursor */
+    struct TableCellSig *cellSigs;/* how each screen cell position was last
+				 * drawn into backPixmap, NULL if unknown */
+    int sigRows, sigCols;	/* screen positions in cellSigs */
+    int sigTableRows, sigTableCols; /* table size cellSigs were drawn for */
+    int *drawnStamps;		/* TableDisplay pass that last drew each
+				 * screen cell position */
+    TableTag **colTagCache;	/* col tag of each screen col position */
+    int *colTagStamps;		/* pass that filled colTagCache */
+    int drawRows, drawCols;	/* screen positions in the above */
+    int drawStamp;		/* number of the current TableDisplay pass */
+    Tcl_Time renderStart;	/* when the current TableDisplay started */
+    Tcl_Time lastDisplay;	/* when the last TableDisplay started,
+				 * kept for -maxfps */
+    struct TableBatch *batches;	/* fills and borders per GC collected by
+				 * the fast and single drawmodes */
+    int numBatches, batchSpace;	/* used and allocated batches */
     int seen[4];			/* see TableUndisplay */
 
     int haveSelection;
@@ -560,6 +742,9 @@ extern TableTag *TableNewTag(Table *tablePtr);
 extern void	TableResetTag(Table *tablePtr, TableTag *tagPtr);
 extern void	TableMergeTag(Table *tablePtr, TableTag *baseTag, TableTag *addTag);
 extern void	TableInvertTag(TableTag *baseTag);
+extern int	TableResolveTag(Table *tablePtr, TableTag *tagPtr, TableTag *colPtr,
+			TableTag *rowPtr, TableTag *cellPtr, int state);
+extern void	TableFlushStyleCache(Table *tablePtr);
 extern int	TableGetTagBorders(TableTag *tagPtr, int *left, int *right, int *top, int *bottom);
 extern int	TableInitTags(Tcl_Interp *interp, Table *tablePtr);
 extern TableTag *FindRowColTag(Table *tablePtr, int cell, int type);
@@ -593,7 +778,24 @@ extern int	TableCellVCoords(Table *tablePtr, int row, int col, int *rx, int *ry,
 			int *rh, int full);
 extern void	TableWhatCell(Table *tablePtr, int x, int y, int *row, int *col);
 extern int	TableAtBorder(Table *tablePtr, int x, int y, int *row, int *col);
+extern void	TableViewFractions(Table *tablePtr, int yview, double *firstPtr,
+			double *lastPtr);
+extern void	TableSetViewPixel(Table *tablePtr, int yview, Tcl_WideInt pixel);
+extern int	TableViewToData(Table *tablePtr, int index, int mode);
+extern int	TableDataToView(Table *tablePtr, int index, int mode);
+extern void	TableSetPerm(Table *tablePtr, int mode, int *perm, int size);
 extern char *	TableGetCellValue(Table *tablePtr, int r, int c);
+extern char *	TableGetCellValueInfo(Table *tablePtr, int r, int c,
+			TableValueInfo *infoPtr);
+extern char *	TableGetDataValue(Table *tablePtr, int dr, int dc);
+extern char *	TableGetDataValueInfo(Table *tablePtr, int dr, int dc,
+			TableValueInfo *infoPtr);
+extern void	TableScanValue(const char *string, TableValueInfo *infoPtr);
+extern int	TableValueOffset(const char *string, TableValueInfo *infoPtr,
+			int index);
+extern char *	TableNewCacheValue(const char *string);
+extern void	TableFreeCacheValue(char *value);
+extern void	TableClearValueCache(Tcl_HashTable *cachePtr);
 extern int	TableSetCellValue(Table *tablePtr, int r, int c, char *value);
 extern int	TableMoveCellValue(Table *tablePtr, int fromr, int fromc, char *frombuf,
 			int tor, int toc, char *tobuf, int outOfBounds);
@@ -606,6 +808,8 @@ extern int	TableGetIndex(Table *tablePtr, char *str, int *row_p, int *col_p);
 	TableGetIndex(tablePtr, Tcl_GetString(objPtr), rowPtr, colPtr)
 extern int	Table_SetCmd(ClientData clientData, Tcl_Interp *interp, int objc,
 			Tcl_Obj *const objv[]);
+extern int	Table_ReorderCmd(ClientData clientData, Tcl_Interp *interp, int objc,
+			Tcl_Obj *const objv[]);
 extern int	Table_HiddenCmd(ClientData clientData, Tcl_Interp *interp, int objc,
 			Tcl_Obj *const objv[]);
 extern int	Table_SpanCmd(ClientData clientData, Tcl_Interp *interp, int objc,
@@ -620,6 +824,15 @@ extern void	TableSpanSanCheck(Table *tablePtr);
  * the selection, so we really want them ordered
  */
 extern char *	TableCellSort(Table *tablePtr, char *str);
+extern int	Table_SortCmd(ClientData clientData, Tcl_Interp *interp, int objc,
+			Tcl_Obj *const objv[]);
+extern int	Table_FilterCmd(ClientData clientData, Tcl_Interp *interp, int objc,
+			Tcl_Obj *const objv[]);
+extern int	Table_SnapshotCmd(ClientData clientData, Tcl_Interp *interp, int objc,
+			Tcl_Obj *const objv[]);
+extern void	TableFilterUpdate(Table *tablePtr, int reeval);
+extern void	TableFilterChanged(Table *tablePtr, int drow);
+extern void	TableFilterClear(Table *tablePtr);
 #ifdef NO_SORT_CELLS
 #  define TableCellSortObj(interp, objPtr) (objPtr)
 #else
@@ -636,6 +849,13 @@ extern int	Table_PostscriptCmd(ClientData clientData, Tcl_Interp *interp, int ob
 extern void	Tcl_DStringAppendAll(Tcl_DString *, ...);
 #endif
 
+/*
+ * Called by TableSnapshot with each strip of rows it rendered, as RGB
+ * triples, y being the top of the strip in the snapshot.
+ */
+typedef int (TableSnapshotProc)(ClientData clientData, unsigned char *rgb,
+	int y, int width, int height);
+
 /*
  * HEADERS IN TKTABLE
  */
@@ -653,6 +873,14 @@ extern void	TableAdjustActive(Table *tablePtr);
 extern void	TableAdjustParams(Table *tablePtr);
 extern void	TableConfigCursor(Table *tablePtr);
 extern void	TableAddFlash(Table *tablePtr, int row, int col);
+extern Tcl_HashEntry *	TableFindFlash(Table *tablePtr, int row, int col);
+extern void	TableDeleteFlash(Table *tablePtr, Tcl_HashEntry *entryPtr);
+extern void	TableClearFlashes(Table *tablePtr);
+extern void	TableFlushLayoutCache(Table *tablePtr);
+extern void	TableFlushGcCache(Table *tablePtr);
+extern int	TableSnapshot(Table *tablePtr, int r1, int c1, int r2, int c2,
+			TableSnapshotProc *proc, ClientData clientData,
+			Tcl_WideInt *usecPtr);
 
 
 #define TableInvalidateAll(tablePtr, flags) \
@@ -664,6 +892,28 @@ extern void	TableAddFlash(Table *tablePtr, int row, int col);
       */
 #define TableMakeArrayIndex(r, c, i)	sprintf((i), "%d,%d", (r), (c))
 
+     /*
+      * Turn a view row/col (user coords) into the index of the data
+      * shown there, which is how values and cell tags are keyed
+      */
+#define TableMakeDataIndex(tablePtr, r, c, i) \
+	TableMakeArrayIndex(TableViewToData((tablePtr), (r), ROW), \
+		TableViewToData((tablePtr), (c), COL), (i))
+
+     /*
+      * Number of rows, including those hidden by a row filter
+      */
+#define TableAllRows(tablePtr) \
+	((tablePtr)->filterPtr ? (tablePtr)->filterRows : (tablePtr)->rows)
+
+     /*
+      * Whether view row r (real coords) is the empty row shown when the
+      * row filter hides every row
+      */
+#define TableIsFilterEmptyRow(tablePtr, r) \
+	((tablePtr)->rowFilter != NULL && (r) >= 0 && \
+		(r) < (tablePtr)->rows && (tablePtr)->rowFilter[(r)] < 0)
+
      /*
       * Turn array index back into row/col
       * return the number of args parsed (should be two)
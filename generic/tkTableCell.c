@@ -76,6 +76,7 @@ int TableTrueCell(Table *tablePtr, int r, int c, int *row, int *col) {
 int TableCellCoords(Table *tablePtr, int row, int col, int *x, int *y, int *w, int *h) {
     int hl = tablePtr->highlightWidth;
     int result = CELL_OK;
+    Tcl_WideInt pos;
 
     if (tablePtr->rows <= 0 || tablePtr->cols <= 0) {
 	*w = *h = *x = *y = 0;
@@ -126,7 +127,8 @@ int TableCellCoords(Table *tablePtr, int row, int col, int *x, int *y, int *w, i
 		} else {
 		    rs = MIN(tablePtr->rows-1, row+rs);
 		}
-		*h = tablePtr->rowStarts[rs+1]-tablePtr->rowStarts[row];
+		*h = (int) MIN(INT_MAX/2,
+			tablePtr->rowStarts[rs+1]-tablePtr->rowStarts[row]);
 		result = CELL_SPAN;
 	    } else if (rs <= 0) {
 		/* currently negative spans are not supported */
@@ -140,7 +142,8 @@ int TableCellCoords(Table *tablePtr, int row, int col, int *x, int *y, int *w, i
 		} else {
 		    cs = MIN(tablePtr->cols-1, col+cs);
 		}
-		*w = tablePtr->colStarts[cs+1]-tablePtr->colStarts[col];
+		*w = (int) MIN(INT_MAX/2,
+			tablePtr->colStarts[cs+1]-tablePtr->colStarts[col]);
 		result = CELL_SPAN;
 	    } else if (cs <= 0) {
 		/* currently negative spans are not supported */
@@ -148,14 +151,22 @@ int TableCellCoords(Table *tablePtr, int row, int col, int *x, int *y, int *w, i
 	}
     }
 setxy:
-    *x = hl + tablePtr->colStarts[col];
+    /*
+     * Starts are 64-bit, the screen isn't.  Cells that are far off
+     * the screen are kept far off, without wrapping around.
+     */
+    pos = tablePtr->colStarts[col];
     if (col >= tablePtr->titleCols) {
-	*x -= tablePtr->colStarts[tablePtr->leftCol] - tablePtr->colStarts[tablePtr->titleCols];
+	pos -= tablePtr->colStarts[tablePtr->leftCol] - tablePtr->colStarts[tablePtr->titleCols]
+	    + tablePtr->leftColShift;
     }
-    *y = hl + tablePtr->rowStarts[row];
+    *x = hl + (int) BETWEEN(pos, -INT_MAX/4, INT_MAX/4);
+    pos = tablePtr->rowStarts[row];
     if (row >= tablePtr->titleRows) {
-	*y -= tablePtr->rowStarts[tablePtr->topRow] - tablePtr->rowStarts[tablePtr->titleRows];
+	pos -= tablePtr->rowStarts[tablePtr->topRow] - tablePtr->rowStarts[tablePtr->titleRows]
+	    + tablePtr->topRowShift;
     }
+    *y = hl + (int) BETWEEN(pos, -INT_MAX/4, INT_MAX/4);
     return result;
 }
 
@@ -197,14 +208,18 @@ int TableCellVCoords(Table *tablePtr, int row, int col, int *rx, int *ry, int *r
 	     */
 	    return 0;
 	}
-    } else if (cellType == CELL_SPAN) {
+    }
+    if (cellType == CELL_OK || cellType == CELL_SPAN) {
 	/*
 	 * we might need to treat full better is CELL_SPAN but primary
-	 * cell is visible
+	 * cell is visible.  A partially scrolled topRow or leftCol is
+	 * clipped at the title edge in the same way.
 	 */
-	int topX = tablePtr->colStarts[tablePtr->titleCols]+hl;
-	int topY = tablePtr->rowStarts[tablePtr->titleRows]+hl;
-	if ((col < tablePtr->leftCol) && (col >= tablePtr->titleCols)) {
+	int topX = (int) tablePtr->colStarts[tablePtr->titleCols]+hl;
+	int topY = (int) tablePtr->rowStarts[tablePtr->titleRows]+hl;
+	if ((col < tablePtr->leftCol ||
+		(col == tablePtr->leftCol && tablePtr->leftColShift))
+		&& (col >= tablePtr->titleCols)) {
 	    if (full || (x+w < topX)) {
 		return 0;
 	    } else {
@@ -212,7 +227,9 @@ int TableCellVCoords(Table *tablePtr, int row, int col, int *rx, int *ry, int *r
 		x = topX;
 	    }
 	}
-	if ((row < tablePtr->topRow) && (row >= tablePtr->titleRows)) {
+	if ((row < tablePtr->topRow ||
+		(row == tablePtr->topRow && tablePtr->topRowShift))
+		&& (row >= tablePtr->titleRows)) {
 	    if (full || (y+h < topY)) {
 		return 0;
 	    } else {
@@ -261,6 +278,36 @@ int TableCellVCoords(Table *tablePtr, int row, int col, int *rx, int *ry, int *r
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFindStart --
+ *	Binary search of an array of row or col starts, so that finding
+ *	the cell under a pixel doesn't scan all rows above the view.
+ *
+ * Results:
+ *	The first index i in 1..count for which starts[i] > pos,
+ *	or count+1 if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableFindStart(const Tcl_WideInt *starts, int count, Tcl_WideInt pos) {
+    int lo = 1, hi = count+1, mid;
+
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if (starts[mid] > pos) {
+	    hi = mid;
+	} else {
+	    lo = mid + 1;
+	}
+    }
+    return lo;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -278,25 +325,23 @@ int TableCellVCoords(Table *tablePtr, int row, int col, int *rx, int *ry, int *r
  *----------------------------------------------------------------------
  */
 void TableWhatCell(Table *tablePtr, int x, int y, int *row, int *col) {
-    int i;
+    Tcl_WideInt wx, wy;
     x = MAX(0, x); y = MAX(0, y);
     /* Adjust for table's global highlightthickness border */
     x -= tablePtr->highlightWidth;
     y -= tablePtr->highlightWidth;
     /* Adjust the x coord if not in the column titles to change display coords
      * into internal coords */
-    x += (x < tablePtr->colStarts[tablePtr->titleCols]) ? 0 :
+    wx = x + ((x < tablePtr->colStarts[tablePtr->titleCols]) ? 0 :
 	tablePtr->colStarts[tablePtr->leftCol] -
-	tablePtr->colStarts[tablePtr->titleCols];
-    y += (y < tablePtr->rowStarts[tablePtr->titleRows]) ? 0 :
+	tablePtr->colStarts[tablePtr->titleCols] + tablePtr->leftColShift);
+    wy = y + ((y < tablePtr->rowStarts[tablePtr->titleRows]) ? 0 :
 	tablePtr->rowStarts[tablePtr->topRow] -
-	tablePtr->rowStarts[tablePtr->titleRows];
-    x = MIN(x, tablePtr->maxWidth-1);
-    y = MIN(y, tablePtr->maxHeight-1);
-    for (i = 1; x >= tablePtr->colStarts[i]; i++);
-    *col = i - 1;
-    for (i = 1; y >= tablePtr->rowStarts[i]; i++);
-    *row = i - 1;
+	tablePtr->rowStarts[tablePtr->titleRows] + tablePtr->topRowShift);
+    wx = MIN(wx, tablePtr->maxWidth-1);
+    wy = MIN(wy, tablePtr->maxHeight-1);
+    *col = TableFindStart(tablePtr->colStarts, tablePtr->cols, wx) - 1;
+    *row = TableFindStart(tablePtr->rowStarts, tablePtr->rows, wy) - 1;
     if (tablePtr->spanAffTbl && !(tablePtr->flags & AVOID_SPANS)) {
 	char buf[INDEX_BUFSIZE];
 	Tcl_HashEntry *entryPtr;
@@ -335,6 +380,7 @@ void TableWhatCell(Table *tablePtr, int x, int y, int *row, int *col) {
  */
 int TableAtBorder(Table * tablePtr, int x, int y, int *row, int *col) {
     int i, brow, bcol, borders = 2, bd[6];
+    Tcl_WideInt wx, wy;
 
     TableGetTagBorders(&(tablePtr->defaultTag), &bd[0], &bd[1], &bd[2], &bd[3]);
     bd[4] = (bd[0] + bd[1])/2;
@@ -346,13 +392,12 @@ int TableAtBorder(Table * tablePtr, int x, int y, int *row, int *col) {
      */
     x = MAX(0, x); y = MAX(0, y);
     x -= tablePtr->highlightWidth; y -= tablePtr->highlightWidth;
-    x += (x < tablePtr->colStarts[tablePtr->titleCols]) ? 0 :
+    wx = x + ((x < tablePtr->colStarts[tablePtr->titleCols]) ? 0 :
 	tablePtr->colStarts[tablePtr->leftCol] -
-	tablePtr->colStarts[tablePtr->titleCols];
-    x = MIN(x, tablePtr->maxWidth - 1);
-    for (i = 1; (i <= tablePtr->cols) &&
-	     (x + (bd[0] + bd[1])) >= tablePtr->colStarts[i]; i++);
-    if (x > tablePtr->colStarts[--i] + bd[4]) {
+	tablePtr->colStarts[tablePtr->titleCols] + tablePtr->leftColShift);
+    wx = MIN(wx, tablePtr->maxWidth - 1);
+    i = TableFindStart(tablePtr->colStarts, tablePtr->cols, wx + (bd[0] + bd[1]));
+    if (wx > tablePtr->colStarts[--i] + bd[4]) {
 	borders--;
 	*col = -1;
 	bcol = (i < tablePtr->leftCol && i >= tablePtr->titleCols) ?
@@ -361,13 +406,12 @@ int TableAtBorder(Table * tablePtr, int x, int y, int *row, int *col) {
 	bcol = *col = (i < tablePtr->leftCol && i >= tablePtr->titleCols) ?
 	    tablePtr->titleCols-1 : i-1;
     }
-    y += (y < tablePtr->rowStarts[tablePtr->titleRows]) ? 0 :
+    wy = y + ((y < tablePtr->rowStarts[tablePtr->titleRows]) ? 0 :
 	tablePtr->rowStarts[tablePtr->topRow] -
-	tablePtr->rowStarts[tablePtr->titleRows];
-    y = MIN(y, tablePtr->maxHeight - 1);
-    for (i = 1; i <= tablePtr->rows &&
-	     (y + (bd[2] + bd[3])) >= tablePtr->rowStarts[i]; i++);
-    if (y > tablePtr->rowStarts[--i]+bd[5]) {
+	tablePtr->rowStarts[tablePtr->titleRows] + tablePtr->topRowShift);
+    wy = MIN(wy, tablePtr->maxHeight - 1);
+    i = TableFindStart(tablePtr->rowStarts, tablePtr->rows, wy + (bd[2] + bd[3]));
+    if (wy > tablePtr->rowStarts[--i]+bd[5]) {
 	borders--;
 	*row = -1;
 	brow = (i < tablePtr->topRow && i >= tablePtr->titleRows) ?
@@ -425,13 +469,403 @@ int TableAtBorder(Table * tablePtr, int x, int y, int *row, int *col) {
     return borders;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableViewFractions --
+ *	Computes the scrollbar fractions for one axis of the table.
+ *	These are in pixels of the scrollable (non-title) area, so that
+ *	a partially scrolled topRow or leftCol is reflected.
+ *
+ * Results:
+ *	The first and last visible fractions are placed in the pointers.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableViewFractions(Table *tablePtr, int yview, double *firstPtr,
+	double *lastPtr) {
+    Tcl_WideInt *starts, pos, total;
+    int title, count, view;
+
+    if (yview) {
+	starts	= tablePtr->rowStarts;
+	title	= tablePtr->titleRows;
+	count	= tablePtr->rows;
+	pos	= tablePtr->topRowShift;
+	view	= Tk_Height(tablePtr->tkwin);
+    } else {
+	starts	= tablePtr->colStarts;
+	title	= tablePtr->titleCols;
+	count	= tablePtr->cols;
+	pos	= tablePtr->leftColShift;
+	view	= Tk_Width(tablePtr->tkwin);
+    }
+    *firstPtr = 0;
+    *lastPtr  = 1;
+    if (starts == NULL || title >= count) {
+	return;
+    }
+    total = starts[count] - starts[title];
+    view -= 2*tablePtr->highlightWidth + (int) starts[title];
+    if (total <= 0 || view <= 0) {
+	return;
+    }
+    pos += starts[yview ? tablePtr->topRow : tablePtr->leftCol] - starts[title];
+    *firstPtr = (double) pos / total;
+    *lastPtr  = (double) MIN(total, pos + view) / total;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableSetViewPixel --
+ *	Scrolls one axis of the table to a pixel position, measured from
+ *	the start of the scrollable (non-title) area.  The position may
+ *	fall inside a row or column.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets topRow and topRowShift (or leftCol and leftColShift).
+ *	The caller is expected to call TableAdjustParams.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableSetViewPixel(Table *tablePtr, int yview, Tcl_WideInt pixel) {
+    Tcl_WideInt *starts;
+    int title, count;
+
+    if (yview) {
+	starts	= tablePtr->rowStarts;
+	title	= tablePtr->titleRows;
+	count	= tablePtr->rows;
+    } else {
+	starts	= tablePtr->colStarts;
+	title	= tablePtr->titleCols;
+	count	= tablePtr->cols;
+    }
+    if (starts == NULL || title >= count) {
+	pixel = 0;
+    } else {
+	pixel = BETWEEN(pixel + starts[title], starts[title], starts[count]-1);
+	/* the last start at or before pixel */
+	title = TableFindStart(starts, count, pixel) - 1;
+	pixel -= starts[title];
+    }
+    if (yview) {
+	tablePtr->topRow	= title;
+	tablePtr->topRowShift	= (int) pixel;
+    } else {
+	tablePtr->leftCol	= title;
+	tablePtr->leftColShift	= (int) pixel;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableViewToData --
+ *	Maps a row or col (according to mode) in user coords from its
+ *	place in the view to the data row or col displayed there.  Rows
+ *	go through the row filter first, then the row order.
+ *
+ * Results:
+ *	The data index in user coords.  The empty row shown when the row
+ *	filter hides every row gives the row before the first one (-1 in
+ *	real coords).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+int TableViewToData(Table *tablePtr, int index, int mode) {
+    int *perm, size, offset;
+
+    if (mode == ROW) {
+	perm = tablePtr->rowPerm; size = tablePtr->rowPermSize;
+	offset = tablePtr->rowOffset;
+	if (tablePtr->rowFilter != NULL && index-offset >= 0 &&
+		index-offset < tablePtr->rows) {
+	    index = tablePtr->rowFilter[index-offset]+offset;
+	}
+    } else {
+	perm = tablePtr->colPerm; size = tablePtr->colPermSize;
+	offset = tablePtr->colOffset;
+    }
+    if (perm != NULL && index-offset >= 0 && index-offset < size) {
+	index = perm[index-offset]+offset;
+    }
+    return index;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableDataToView --
+ *	The inverse of TableViewToData, maps a data row or col in user
+ *	coords to the place where it is displayed.
+ *
+ * Results:
+ *	The view index in user coords.  A row hidden by the row filter
+ *	gives the row before the first one (-1 in real coords).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+int TableDataToView(Table *tablePtr, int index, int mode) {
+    int *perm, size, offset;
+
+    if (mode == ROW) {
+	perm = tablePtr->rowPermInv; size = tablePtr->rowPermSize;
+	offset = tablePtr->rowOffset;
+    } else {
+	perm = tablePtr->colPermInv; size = tablePtr->colPermSize;
+	offset = tablePtr->colOffset;
+    }
+    if (perm != NULL && index-offset >= 0 && index-offset < size) {
+	index = perm[index-offset]+offset;
+    }
+    if (mode == ROW && tablePtr->rowFilter != NULL && index-offset >= 0 &&
+	    index-offset < tablePtr->filterRows) {
+	index = tablePtr->rowFilterInv[index-offset]+offset;
+    }
+    return index;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableSetPerm --
+ *	Installs a new view permutation for rows or cols (according to
+ *	mode).  perm must have been allocated with Tcl_Alloc, hold size
+ *	entries and be a permutation of 0..size-1.  The table takes
+ *	ownership of it.  A NULL perm resets to the identity.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The old permutation is freed.  The caller is responsible for
+ *	recalculating the geometry and redrawing.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableSetPerm(Table *tablePtr, int mode, int *perm, int size) {
+    int **permPtr, **invPtr, *inv = NULL, i;
+
+    if (mode == ROW) {
+	permPtr = &(tablePtr->rowPerm); invPtr = &(tablePtr->rowPermInv);
+	tablePtr->rowPermSize = (perm == NULL) ? 0 : size;
+    } else {
+	permPtr = &(tablePtr->colPerm); invPtr = &(tablePtr->colPermInv);
+	tablePtr->colPermSize = (perm == NULL) ? 0 : size;
+    }
+    if (*permPtr != NULL) {
+	Tcl_Free((char *) *permPtr);
+	Tcl_Free((char *) *invPtr);
+    }
+    if (perm != NULL) {
+	inv = (int *) Tcl_Alloc(size * sizeof(int));
+	for (i = 0; i < size; i++) {
+	    inv[perm[i]] = i;
+	}
+    }
+    *permPtr = perm;
+    *invPtr  = inv;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableScanValue --
+ *	Finds the byte length and char count of a string in one pass,
+ *	counting UTF-8 characters only past the first non-ASCII byte.
+ *
+ * Results:
+ *	Fills in infoPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableScanValue(const char *string, TableValueInfo *infoPtr) {
+    const unsigned char *p = (const unsigned char *) string;
+
+    while (*p && *p < 0x80) {
+	p++;
+    }
+    if (*p == '\0') {
+	infoPtr->length = infoPtr->numChars = (int) (p - (const unsigned char *) string);
+	infoPtr->ascii = 1;
+    } else {
+	infoPtr->length = (int) strlen(string);
+	infoPtr->numChars = (int) Tcl_NumUtfChars(string, (Tcl_Size) infoPtr->length);
+	infoPtr->ascii = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableValueOffset --
+ *	Returns the byte offset of char index in a scanned string,
+ *	without scanning it for ASCII strings.
+ *
+ * Results:
+ *	The byte offset.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+int TableValueOffset(const char *string, TableValueInfo *infoPtr, int index) {
+    if (index >= infoPtr->numChars) {
+	return infoPtr->length;
+    }
+    if (infoPtr->ascii) {
+	return MAX(0, index);
+    }
+    return (int) (Tcl_UtfAtIndex(string, (Tcl_Size) index) - string);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableNewCacheValue --
+ *	Makes the copy of a value kept in the cell cache.  The copy is
+ *	preceded by its TableValueInfo, so users of the cache can get
+ *	its length and char count without scanning it.
+ *
+ * Results:
+ *	The copy, to be freed with TableFreeCacheValue.
+ *
+ * Side effects:
+ *	Memory is allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+char * TableNewCacheValue(const char *string) {
+    TableValueInfo info, *infoPtr;
+
+    TableScanValue(string, &info);
+    infoPtr = (TableValueInfo *) Tcl_Alloc(sizeof(TableValueInfo) + info.length + 1);
+    *infoPtr = info;
+    memcpy((char *) (infoPtr + 1), string, (size_t) info.length + 1);
+    return (char *) (infoPtr + 1);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFreeCacheValue --
+ *	Frees a value made by TableNewCacheValue, if not NULL.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableFreeCacheValue(char *value) {
+    if (value != NULL) {
+	Tcl_Free((char *) (((TableValueInfo *) value) - 1));
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableClearValueCache --
+ *	Like Table_ClearHashTable, for the cell cache: frees all values
+ *	and deletes the hash table.  The hash table cannot be used after
+ *	calling this, except to be freed or reinitialized.
+ *
+ * Results:
+ *	Cached values are lost.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableClearValueCache(Tcl_HashTable *cachePtr) {
+    Tcl_HashEntry *entryPtr;
+    Tcl_HashSearch search;
+
+    for (entryPtr = Tcl_FirstHashEntry(cachePtr, &search);
+	    entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	TableFreeCacheValue((char *) Tcl_GetHashValue(entryPtr));
+    }
+    Tcl_DeleteHashTable(cachePtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
  * TableGetCellValue --
  *	Takes a row,col pair in user coords and returns the value for
- *	that cell.  This varies depending on what data source the
- *	user has selected.
+ *	the data shown in that cell.
+ *
+ * Results:
+ *	The value of the cell is returned.  The return value is VOLATILE
+ *	(do not free).  The empty row shown when the row filter hides
+ *	every row has no data and reads as empty.
+ *
+ * Side effects:
+ *	See TableGetDataValue.
+ *
+ *----------------------------------------------------------------------
+ */
+char * TableGetCellValue(Table *tablePtr, int r, int c) {
+    return TableGetCellValueInfo(tablePtr, r, c, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetCellValueInfo --
+ *	Like TableGetCellValue, but also returns the byte length and
+ *	char count of the value in infoPtr.
+ *
+ * Results:
+ *	The value of the cell is returned.  The return value is VOLATILE
+ *	(do not free).
+ *
+ * Side effects:
+ *	See TableGetDataValue.
+ *
+ *----------------------------------------------------------------------
+ */
+char * TableGetCellValueInfo(Table *tablePtr, int r, int c, TableValueInfo *infoPtr) {
+    if (TableIsFilterEmptyRow(tablePtr, r-tablePtr->rowOffset)) {
+	if (infoPtr != NULL) {
+	    infoPtr->length = infoPtr->numChars = 0;
+	    infoPtr->ascii = 1;
+	}
+	return "";
+    }
+    return TableGetDataValueInfo(tablePtr, TableViewToData(tablePtr, r, ROW),
+	    TableViewToData(tablePtr, c, COL), infoPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetDataValue --
+ *	Takes a data row,col pair in user coords (not permuted by the
+ *	view) and returns the value for that cell.  This varies depending
+ *	on what data source the user has selected.
  *
  * Results:
  *	The value of the cell is returned.  The return value is VOLATILE
@@ -442,14 +876,35 @@ int TableAtBorder(Table * tablePtr, int x, int y, int *row, int *col) {
  *
  *----------------------------------------------------------------------
  */
-char * TableGetCellValue(Table *tablePtr, int r, int c) {
+char * TableGetDataValue(Table *tablePtr, int dr, int dc) {
+    return TableGetDataValueInfo(tablePtr, dr, dc, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableGetDataValueInfo --
+ *	Like TableGetDataValue, but if infoPtr is not NULL it also gets
+ *	the byte length and char count of the value.  Values from the
+ *	cell cache carry these, others are scanned.
+ *
+ * Results:
+ *	The value of the cell is returned.  The return value is VOLATILE
+ *	(do not free).
+ *
+ * Side effects:
+ *	The value will be cached if caching is turned on.
+ *
+ *----------------------------------------------------------------------
+ */
+char * TableGetDataValueInfo(Table *tablePtr, int dr, int dc, TableValueInfo *infoPtr) {
     Tcl_Interp *interp = tablePtr->interp;
-    char *result = NULL;
+    char *result = NULL, *cached = NULL;
     char buf[INDEX_BUFSIZE];
     Tcl_HashEntry *entryPtr = NULL;
     int new, code;
 
-    TableMakeArrayIndex(r, c, buf);
+    TableMakeArrayIndex(dr, dc, buf);
 
     if (tablePtr->dataSource == DATA_CACHE) {
 	/*
@@ -457,7 +912,7 @@ char * TableGetCellValue(Table *tablePtr, int r, int c) {
 	 */
 	entryPtr = Tcl_FindHashEntry(tablePtr->cache, buf);
 	if (entryPtr) {
-	    result = (char *) Tcl_GetHashValue(entryPtr);
+	    result = cached = (char *) Tcl_GetHashValue(entryPtr);
 	}
 	goto VALUE;
     }
@@ -469,14 +924,14 @@ char * TableGetCellValue(Table *tablePtr, int r, int c) {
 	 */
 	entryPtr = Tcl_CreateHashEntry(tablePtr->cache, buf, &new);
 	if (!new) {
-	    result = (char *) Tcl_GetHashValue(entryPtr);
+	    result = cached = (char *) Tcl_GetHashValue(entryPtr);
 	    goto VALUE;
 	}
     }
     if (tablePtr->dataSource & DATA_COMMAND) {
 	Tcl_DString script;
 	Tcl_DStringInit(&script);
-	ExpandPercents(tablePtr, tablePtr->command, r, c, "", (char *)NULL, 0, &script, 0);
+	ExpandPercents(tablePtr, tablePtr->command, dr, dc, "", (char *)NULL, 0, &script, 0);
 	if ((code = Tcl_EvalEx(interp, Tcl_DStringValue(&script),
 		Tcl_DStringLength(&script), TCL_EVAL_GLOBAL)) == TCL_ERROR) {
 	    tablePtr->useCmd = 0;
@@ -504,8 +959,7 @@ char * TableGetCellValue(Table *tablePtr, int r, int c) {
 	 */
 	char *val = NULL;
 	if (result) {
-	    val = (char *)Tcl_Alloc((Tcl_Size)strlen(result)+1);
-	    strcpy(val, result);
+	    val = cached = TableNewCacheValue(result);
 	}
 	Tcl_SetHashValue(entryPtr, val);
     }
@@ -514,19 +968,24 @@ VALUE:
     if (result != NULL) {
 	/* Do we have procs, are we showing their value, is this a proc? */
 	if (tablePtr->hasProcs && !tablePtr->showProcs && *result == '=' &&
-	    !(r-tablePtr->rowOffset == tablePtr->activeRow &&
-	      c-tablePtr->colOffset == tablePtr->activeCol)) {
+	    !(dr == TableViewToData(tablePtr,
+			  tablePtr->activeRow+tablePtr->rowOffset, ROW) &&
+	      dc == TableViewToData(tablePtr,
+			  tablePtr->activeCol+tablePtr->colOffset, COL))) {
 	    Tcl_DString script;
 	    /* provides a rough mutex on preventing proc loops */
 	    entryPtr = Tcl_CreateHashEntry(tablePtr->inProc, buf, &new);
 	    if (!new) {
 		Tcl_SetHashValue(entryPtr, 1);
 		Tcl_AddErrorInfo(interp, "\n\t(loop hit in proc evaled by table)");
+		if (infoPtr != NULL) {
+		    TableScanValue(result, infoPtr);
+		}
 		return result;
 	    }
 	    Tcl_SetHashValue(entryPtr, 0);
 	    Tcl_DStringInit(&script);
-	    ExpandPercents(tablePtr, result+1, r, c, result+1, (char *)NULL, 0, &script, 0);
+	    ExpandPercents(tablePtr, result+1, dr, dc, result+1, (char *)NULL, 0, &script, 0);
 	    if ((code = Tcl_EvalEx(interp, Tcl_DStringValue(&script), Tcl_DStringLength(&script),
 		    TCL_EVAL_GLOBAL)) != TCL_OK || Tcl_GetHashValue(entryPtr) == 1) {
 		Tcl_AddErrorInfo(interp, "\n\tin proc evaled by table:\n");
@@ -534,6 +993,7 @@ VALUE:
 		Tcl_BackgroundException(interp, TCL_ERROR);
 	    } else {
 		result = Tcl_GetStringResult(interp);
+		cached = NULL;
 	    }
 	    /*
 	     * XXX FIX: Can't free result that we still need.
@@ -545,6 +1005,16 @@ VALUE:
 	}
     }
 #endif
+    if (infoPtr != NULL) {
+	if (result == NULL) {
+	    infoPtr->length = infoPtr->numChars = 0;
+	    infoPtr->ascii = 1;
+	} else if (cached != NULL) {
+	    *infoPtr = ((TableValueInfo *) cached)[-1];
+	} else {
+	    TableScanValue(result, infoPtr);
+	}
+    }
     return (result?result:"");
 }
 
@@ -562,25 +1032,29 @@ VALUE:
  *
  * Side effects:
  *	If the value is NULL (empty string), it will be unset from
- *	an array rather than set to the empty string.
+ *	an array rather than set to the empty string.  Nothing is set
+ *	for the empty row shown when the row filter hides every row.
  *
  *----------------------------------------------------------------------
  */
 int TableSetCellValue(Table *tablePtr, int r, int c, char *value) {
     char buf[INDEX_BUFSIZE];
-    int code = TCL_OK, flash = 0;
+    int code = TCL_OK, flash = 0, dr, dc;
     Tcl_Interp *interp = tablePtr->interp;
 
-    TableMakeArrayIndex(r, c, buf);
+    dr = TableViewToData(tablePtr, r, ROW);
+    dc = TableViewToData(tablePtr, c, COL);
+    TableMakeArrayIndex(dr, dc, buf);
 
-    if (tablePtr->state == STATE_DISABLED) {
+    if (tablePtr->state == STATE_DISABLED ||
+	    TableIsFilterEmptyRow(tablePtr, r-tablePtr->rowOffset)) {
 	return TCL_OK;
     }
     if (tablePtr->dataSource & DATA_COMMAND) {
 	Tcl_DString script;
 
 	Tcl_DStringInit(&script);
-	ExpandPercents(tablePtr, tablePtr->command, r, c, value, (char *)NULL, 1, &script, 0);
+	ExpandPercents(tablePtr, tablePtr->command, dr, dc, value, (char *)NULL, 1, &script, 0);
 	if ((code = Tcl_EvalEx(interp, Tcl_DStringValue(&script), Tcl_DStringLength(&script),
 		TCL_EVAL_GLOBAL)) == TCL_ERROR) {
 	    /* An error resulted.  Prevent further triggering of the command
@@ -623,16 +1097,18 @@ int TableSetCellValue(Table *tablePtr, int r, int c, char *value) {
 
 	entryPtr = Tcl_CreateHashEntry(tablePtr->cache, buf, &new);
 	if (!new) {
-	    val = (char *) Tcl_GetHashValue(entryPtr);
-	    if (val) Tcl_Free(val);
+	    TableFreeCacheValue((char *) Tcl_GetHashValue(entryPtr));
 	}
 	if (value) {
-	    val = (char *)Tcl_Alloc((Tcl_Size)strlen(value)+1);
-	    strcpy(val, value);
+	    val = TableNewCacheValue(value);
 	}
 	Tcl_SetHashValue(entryPtr, val);
 	flash = 1;
     }
+    /* The var array trace also checks the filter and flashes */
+    if (flash && tablePtr->filterPtr != NULL) {
+	TableFilterChanged(tablePtr, dr);
+    }
     /* We do this conditionally because the var array already has
      * it's own check to flash */
     if (flash && tablePtr->flashMode) {
@@ -671,7 +1147,6 @@ int TableMoveCellValue(Table *tablePtr, int fromr, int fromc, char *frombuf, int
     }
 
     if (tablePtr->dataSource == DATA_CACHE) {
-	char *val;
 	char *result = NULL;
 	Tcl_HashEntry *entryPtr;
 
@@ -702,15 +1177,13 @@ int TableMoveCellValue(Table *tablePtr, int fromr, int fromc, char *frombuf, int
 	     * free old value
 	     */
 	    if (!new) {
-		val = (char *) Tcl_GetHashValue(entryPtr);
-		if (val) Tcl_Free(val);
+		TableFreeCacheValue((char *) Tcl_GetHashValue(entryPtr));
 	    }
 	    Tcl_SetHashValue(entryPtr, result);
 	} else {
 	    entryPtr = Tcl_FindHashEntry(tablePtr->cache, tobuf);
 	    if (entryPtr) {
-		val = (char *) Tcl_GetHashValue(entryPtr);
-		if (val) Tcl_Free(val);
+		TableFreeCacheValue((char *) Tcl_GetHashValue(entryPtr));
 		Tcl_DeleteHashEntry(entryPtr);
 	    }
 	}
@@ -742,10 +1215,11 @@ int TableMoveCellValue(Table *tablePtr, int fromr, int fromc, char *frombuf, int
  */
 int TableGetIcursor(Table *tablePtr, char *arg, int *posn) {
     int tmp, len;
+    TableValueInfo info;
 
-    len = (int) strlen(tablePtr->activeBuf);
-    /* Need to base it off strlen to account for \x00 (Unicode null) */
-    len = (int) Tcl_NumUtfChars(tablePtr->activeBuf, (Tcl_Size)len);
+    /* This is based off strlen to account for \x00 (Unicode null) */
+    TableScanValue(tablePtr->activeBuf, &info);
+    len = info.numChars;
 
     /* ensure icursor didn't get out of sync */
     if (tablePtr->icursor > len) tablePtr->icursor = len;
@@ -812,13 +1286,21 @@ int TableGetIndex(
 	c += tablePtr->colOffset;
 
     } else if (*str == '-' || isdigit(str[0])) {
-	if (sscanf(str, "%d,%d%c", &r, &c, &dummy) != 2) {
+	Tcl_WideInt wr, wc;
+
+	/* parse as 64-bit so that huge indices clamp instead of wrapping */
+	if (sscanf(str, "%" TCL_LL_MODIFIER "d,%" TCL_LL_MODIFIER "d%c",
+		    &wr, &wc, &dummy) != 2) {
 	    /* Make sure it won't work for "2,3extrastuff" */
 	    goto IndexError;
 	}
 	/* ensure appropriate user index */
-	CONSTRAIN(r, tablePtr->rowOffset, tablePtr->rows-1+tablePtr->rowOffset);
-	CONSTRAIN(c, tablePtr->colOffset, tablePtr->cols-1+tablePtr->colOffset);
+	CONSTRAIN(wr, tablePtr->rowOffset,
+		(Tcl_WideInt) tablePtr->rows-1+tablePtr->rowOffset);
+	CONSTRAIN(wc, tablePtr->colOffset,
+		(Tcl_WideInt) tablePtr->cols-1+tablePtr->colOffset);
+	r = (int) wr;
+	c = (int) wc;
 
     } else if (len > 1 && strncmp(str, "active", len) == 0 ) {	/* active */
 	if (tablePtr->flags & HAS_ACTIVE) {
@@ -1018,6 +1500,115 @@ int Table_SetCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
     return TCL_OK;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * Table_ReorderCmd --
+ *	This procedure is invoked to process the reorder method
+ *	that corresponds to a widget managed by this module.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	The view order of rows or cols can change, forcing a redraw.
+ *
+ *--------------------------------------------------------------
+ */
+int Table_ReorderCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    Table *tablePtr = (Table *) clientData;
+    int i, idx, mode, size, offset, max, *perm, *oldPerm;
+    Tcl_Size len;
+    Tcl_Obj **listv, *resultPtr;
+    char *seen, *str;
+
+    if (objc < 3 || objc > 4) {
+	Tcl_WrongNumArgs(interp, 2, objv, "row|col ?indexList?");
+	return TCL_ERROR;
+    }
+    str = Tcl_GetStringFromObj(objv[2], &len);
+    if (len && strncmp(str, "row", (size_t) len) == 0) {
+	mode	= ROW;
+	oldPerm	= tablePtr->rowPerm;
+	size	= tablePtr->rowPermSize;
+	offset	= tablePtr->rowOffset;
+	max	= TableAllRows(tablePtr);
+    } else if (len && strncmp(str, "col", (size_t) len) == 0) {
+	mode	= COL;
+	oldPerm	= tablePtr->colPerm;
+	size	= tablePtr->colPermSize;
+	offset	= tablePtr->colOffset;
+	max	= tablePtr->cols;
+    } else {
+	Tcl_AppendResult(interp, "bad option \"", str,
+		"\": must be row or col", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    if (objc == 3) {
+	/* return the data index shown at each view position */
+	resultPtr = Tcl_NewListObj(0, NULL);
+	for (i = 0; oldPerm != NULL && i < size; i++) {
+	    Tcl_ListObjAppendElement(NULL, resultPtr,
+		    Tcl_NewIntObj(oldPerm[i]+offset));
+	}
+	Tcl_SetObjResult(interp, resultPtr);
+	return TCL_OK;
+    }
+
+    if (Tcl_ListObjGetElements(interp, objv[3], &len, &listv) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (len > (Tcl_Size) max) {
+	Tcl_AppendResult(interp, "index list is longer than the number of ",
+		(mode == ROW) ? "rows" : "cols", (char *) NULL);
+	return TCL_ERROR;
+    }
+    perm = NULL;
+    if (len > 0) {
+	/*
+	 * The list must be a permutation of the first len indices
+	 */
+	perm = (int *) Tcl_Alloc((int) len * sizeof(int));
+	seen = (char *) Tcl_Alloc((int) len);
+	memset(seen, 0, (size_t) len);
+	for (i = 0; i < (int) len; i++) {
+	    if (Tcl_GetIntFromObj(interp, listv[i], &idx) != TCL_OK) {
+		goto badPerm;
+	    }
+	    idx -= offset;
+	    if (idx < 0 || idx >= (int) len || seen[idx]) {
+		char buf[2*INDEX_BUFSIZE];
+		sprintf(buf, "%d..%d", offset, offset+(int) len-1);
+		Tcl_AppendResult(interp, "index list must be a permutation of ",
+			buf, (char *) NULL);
+		goto badPerm;
+	    }
+	    seen[idx] = 1;
+	    perm[i] = idx;
+	}
+	Tcl_Free(seen);
+    }
+    TableSetPerm(tablePtr, mode, perm, (int) len);
+    if (mode == ROW && tablePtr->filterPtr != NULL) {
+	/* the same data rows are visible, but in other places */
+	tablePtr->rows = tablePtr->filterRows;
+	TableFilterUpdate(tablePtr, 0);
+    }
+
+    /* values, tags and sizes follow the data, so all may have moved */
+    TableGetActiveBuf(tablePtr);
+    TableAdjustParams(tablePtr);
+    TableInvalidateAll(tablePtr, 0);
+    return TCL_OK;
+
+    badPerm:
+    Tcl_Free(seen);
+    Tcl_Free((char *) perm);
+    return TCL_ERROR;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -384,3 +384,701 @@ Tcl_Obj * TableCellSortObj(Tcl_Interp *interp, Tcl_Obj *listObjPtr) {
     return sortedObjPtr;
 }
 #endif
+
+/*
+ * The "sort" method extracts a typed key for every cell it sorts on once,
+ * then sorts an array of row numbers with a stable merge sort.  The result
+ * is installed as the row view permutation, no cell value is moved.
+ */
+
+static const char *sortTypeNames[] = {
+    "ascii", "dictionary", "integer", "real", (char *) NULL
+};
+enum sortType {
+    SORT_ASCII, SORT_DICTIONARY, SORT_INTEGER, SORT_REAL
+};
+
+typedef struct SortValue {
+    union {
+	char *str;			/* ascii and dictionary keys */
+	Tcl_WideInt wide;		/* integer keys */
+	double dbl;			/* real keys */
+    } v;
+    int isNum;				/* numeric key was a valid number */
+} SortValue;
+
+typedef struct SortInfo {
+    int numKeys;			/* number of keys per row */
+    int *types;				/* enum sortType of each key */
+    int *decreasing;			/* whether each key sorts down */
+    SortValue *values;			/* numKeys values per sorted row */
+} SortInfo;
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SortCompareRows --
+ *	Compares the keys of two rows being sorted, key by key.
+ *
+ * Results:
+ *	< 0, 0 or > 0 as for strcmp.  Numeric keys that are not valid
+ *	numbers come before all numbers.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int SortCompareRows(SortInfo *infoPtr, int a, int b) {
+    SortValue *x = infoPtr->values + a * infoPtr->numKeys;
+    SortValue *y = infoPtr->values + b * infoPtr->numKeys;
+    int k, diff;
+
+    for (k = 0; k < infoPtr->numKeys; k++, x++, y++) {
+	switch (infoPtr->types[k]) {
+	case SORT_ASCII:
+	    diff = strcmp(x->v.str, y->v.str);
+	    break;
+	case SORT_DICTIONARY:
+	    diff = DictionaryCompare(x->v.str, y->v.str);
+	    break;
+	case SORT_INTEGER:
+	    diff = (x->isNum != y->isNum) ? (x->isNum - y->isNum) :
+		(x->v.wide > y->v.wide) - (x->v.wide < y->v.wide);
+	    break;
+	default:
+	    diff = (x->isNum != y->isNum) ? (x->isNum - y->isNum) :
+		(x->v.dbl > y->v.dbl) - (x->v.dbl < y->v.dbl);
+	    break;
+	}
+	if (diff != 0) {
+	    return infoPtr->decreasing[k] ? -diff : diff;
+	}
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SortRows --
+ *	Stable bottom-up merge sort of an array of row numbers, short
+ *	runs are first sorted by insertion.
+ *
+ * Results:
+ *	rows is sorted in place.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+#define SORT_RUN 16
+static void SortRows(SortInfo *infoPtr, int *rows, int n) {
+    int *src = rows, *dst, *tmp, i, j, lo, mid, hi, width, row;
+
+    for (lo = 0; lo < n; lo += SORT_RUN) {
+	hi = MIN(lo+SORT_RUN, n);
+	for (i = lo+1; i < hi; i++) {
+	    row = rows[i];
+	    for (j = i; j > lo && SortCompareRows(infoPtr, rows[j-1], row) > 0;
+		 j--) {
+		rows[j] = rows[j-1];
+	    }
+	    rows[j] = row;
+	}
+    }
+    if (n <= SORT_RUN) {
+	return;
+    }
+
+    dst = (int *) Tcl_Alloc(n * sizeof(int));
+    tmp = dst;
+    for (width = SORT_RUN; width < n; width *= 2) {
+	for (lo = 0; lo < n; lo += 2*width) {
+	    mid = MIN(lo+width, n);
+	    hi  = MIN(lo+2*width, n);
+	    i = lo; j = mid; row = lo;
+	    while (i < mid && j < hi) {
+		/* take from the left on ties to stay stable */
+		if (SortCompareRows(infoPtr, src[j], src[i]) < 0) {
+		    dst[row++] = src[j++];
+		} else {
+		    dst[row++] = src[i++];
+		}
+	    }
+	    while (i < mid) dst[row++] = src[i++];
+	    while (j < hi)  dst[row++] = src[j++];
+	}
+	tmp = src; src = dst; dst = tmp;
+    }
+    if (src != rows) {
+	memcpy(rows, src, n * sizeof(int));
+	Tcl_Free((char *) src);
+    } else {
+	Tcl_Free((char *) dst);
+    }
+}
+
+/*
+ * The place in the row order of the i-th visible row below the titles
+ */
+#define SortPosition(tablePtr, i) \
+	(((tablePtr)->rowFilter != NULL) ? \
+	    (tablePtr)->rowFilter[(i)+(tablePtr)->titleRows] : \
+	    (i)+(tablePtr)->titleRows)
+
+/*
+ *--------------------------------------------------------------
+ *
+ * Table_SortCmd --
+ *	This procedure is invoked to process the sort method
+ *	that corresponds to a widget managed by this module.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	The row view permutation is replaced, forcing a redraw.
+ *
+ *--------------------------------------------------------------
+ */
+int Table_SortCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    static const char *sortOptNames[] = {
+	"-col", "-order", "-type", (char *) NULL
+    };
+    enum sortOpt { SORT_COL, SORT_ORDER, SORT_TYPE };
+    static const char *orderNames[] = {
+	"increasing", "decreasing", (char *) NULL
+    };
+    Table *tablePtr = (Table *) clientData;
+    Tcl_Obj *colObj = NULL, *orderObj = NULL, *typeObj = NULL, **objs;
+    Tcl_Size numCols, numObjs;
+    Tcl_DString strings;
+    SortInfo info;
+    SortValue *valPtr;
+    int i, k, n, max, opt, value, result = TCL_ERROR, *cols, *rows, *perm;
+    char *str, *end;
+
+    if (objc < 4 || (objc & 1)) {
+	Tcl_WrongNumArgs(interp, 2, objv, "-col colList ?-type typeList? ?-order orderList?");
+	return TCL_ERROR;
+    }
+    for (i = 2; i < objc; i += 2) {
+	if (Tcl_GetIndexFromObj(interp, objv[i], sortOptNames, "option", 0,
+		&opt) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	switch ((enum sortOpt) opt) {
+	case SORT_COL:	 colObj   = objv[i+1]; break;
+	case SORT_ORDER: orderObj = objv[i+1]; break;
+	case SORT_TYPE:	 typeObj  = objv[i+1]; break;
+	}
+    }
+    if (colObj == NULL) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj("no -col given to sort on", -1));
+	return TCL_ERROR;
+    }
+    if (Tcl_ListObjGetElements(interp, colObj, &numCols, &objs) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (numCols == 0) {
+	return TCL_OK;
+    }
+
+    /*
+     * Parse the keys.  A short -type or -order list repeats its last
+     * element for the remaining keys.
+     */
+    info.numKeys	= (int) numCols;
+    info.types		= (int *) Tcl_Alloc(3 * info.numKeys * sizeof(int));
+    info.decreasing	= info.types + info.numKeys;
+    info.values		= NULL;
+    cols		= info.decreasing + info.numKeys;
+    for (k = 0; k < info.numKeys; k++) {
+	if (Tcl_GetIntFromObj(interp, objs[k], &value) != TCL_OK) {
+	    goto done;
+	}
+	if (value < tablePtr->colOffset ||
+		value >= tablePtr->colOffset+tablePtr->cols) {
+	    Tcl_AppendResult(interp, "column \"", Tcl_GetString(objs[k]),
+		    "\" is out of range", (char *) NULL);
+	    goto done;
+	}
+	cols[k] = value;
+	info.types[k] = SORT_ASCII;
+	info.decreasing[k] = 0;
+    }
+    if (typeObj != NULL) {
+	if (Tcl_ListObjGetElements(interp, typeObj, &numObjs, &objs) != TCL_OK) {
+	    goto done;
+	}
+	for (k = 0; k < info.numKeys && numObjs > 0; k++) {
+	    if (Tcl_GetIndexFromObj(interp, objs[MIN(k, (int) numObjs-1)],
+		    sortTypeNames, "type", 0, &(info.types[k])) != TCL_OK) {
+		goto done;
+	    }
+	}
+    }
+    if (orderObj != NULL) {
+	if (Tcl_ListObjGetElements(interp, orderObj, &numObjs, &objs) != TCL_OK) {
+	    goto done;
+	}
+	for (k = 0; k < info.numKeys && numObjs > 0; k++) {
+	    if (Tcl_GetIndexFromObj(interp, objs[MIN(k, (int) numObjs-1)],
+		    orderNames, "order", 0, &(info.decreasing[k])) != TCL_OK) {
+		goto done;
+	    }
+	}
+    }
+
+    /*
+     * Only rows below the title rows are sorted, in the order they are
+     * currently shown.  Extract every key once, strings are copied
+     * since cell values are volatile.
+     */
+    n = tablePtr->rows - tablePtr->titleRows;
+    if (n <= 1) {
+	result = TCL_OK;
+	goto done;
+    }
+    info.values = (SortValue *) Tcl_Alloc(n * info.numKeys * sizeof(SortValue));
+    Tcl_DStringInit(&strings);
+    for (i = 0, valPtr = info.values; i < n; i++) {
+	int urow = i + tablePtr->titleRows + tablePtr->rowOffset;
+
+	for (k = 0; k < info.numKeys; k++, valPtr++) {
+	    str = TableGetCellValue(tablePtr, urow, cols[k]);
+	    valPtr->isNum = 0;
+	    switch (info.types[k]) {
+	    case SORT_ASCII:
+	    case SORT_DICTIONARY:
+		/* keep the offset until the buffer stops growing */
+		valPtr->v.wide = Tcl_DStringLength(&strings);
+		Tcl_DStringAppend(&strings, str, (Tcl_Size) strlen(str)+1);
+		break;
+	    case SORT_INTEGER:
+		valPtr->v.wide = strtoll(str, &end, 10);
+		while (isspace(UCHAR(*end))) end++;
+		valPtr->isNum = (end != str && *end == '\0');
+		break;
+	    case SORT_REAL:
+		valPtr->v.dbl = strtod(str, &end);
+		while (isspace(UCHAR(*end))) end++;
+		valPtr->isNum = (end != str && *end == '\0');
+		break;
+	    }
+	}
+    }
+    str = Tcl_DStringValue(&strings);
+    for (i = 0, valPtr = info.values; i < n; i++) {
+	for (k = 0; k < info.numKeys; k++, valPtr++) {
+	    if (info.types[k] == SORT_ASCII || info.types[k] == SORT_DICTIONARY) {
+		valPtr->v.str = str + valPtr->v.wide;
+	    }
+	}
+    }
+
+    rows = (int *) Tcl_Alloc(n * sizeof(int));
+    for (i = 0; i < n; i++) {
+	rows[i] = i;
+    }
+    SortRows(&info, rows, n);
+    Tcl_DStringFree(&strings);
+
+    /*
+     * Compose with the current row order.  Rows hidden by a filter keep
+     * their place, the sorted rows are dealt into the places of the
+     * visible ones.
+     */
+    max = TableAllRows(tablePtr);
+    perm = (int *) Tcl_Alloc(max * sizeof(int));
+    for (i = 0; i < max; i++) {
+	perm[i] = (i < tablePtr->rowPermSize) ? tablePtr->rowPerm[i] : i;
+    }
+    for (i = 0; i < n; i++) {
+	perm[SortPosition(tablePtr, i)] =
+	    TableViewToData(tablePtr, rows[i] + tablePtr->titleRows
+		    + tablePtr->rowOffset, ROW) - tablePtr->rowOffset;
+    }
+    Tcl_Free((char *) rows);
+    TableSetPerm(tablePtr, ROW, perm, max);
+
+    TableGetActiveBuf(tablePtr);
+    TableAdjustParams(tablePtr);
+    TableInvalidateAll(tablePtr, 0);
+    result = TCL_OK;
+
+    done:
+    if (info.values != NULL) {
+	Tcl_Free((char *) info.values);
+    }
+    Tcl_Free((char *) info.types);
+    return result;
+}
+
+/*
+ * The "filter" method hides the rows whose data doesn't match a list of
+ * terms.  Whether each data row matches is kept in rowMatch, so a changed
+ * cell only re-evaluates its own row.
+ */
+
+static const char *filterTypeNames[] = {
+    "-match", "-range", "-regexp", (char *) NULL
+};
+enum filterType {
+    FILTER_MATCH, FILTER_RANGE, FILTER_REGEXP
+};
+
+typedef struct TableFilterTerm {
+    int col;				/* data col in user coords */
+    int type;				/* enum filterType */
+    Tcl_Obj *patObj;			/* pattern for -match and -regexp */
+    Tcl_RegExp regexp;			/* compiled -regexp pattern */
+    double lo, hi;			/* inclusive bounds for -range */
+} TableFilterTerm;
+
+typedef struct TableFilter {
+    Tcl_Obj *specObj;			/* the terms as given, for queries */
+    int numTerms;
+    TableFilterTerm *terms;
+} TableFilter;
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFreeFilter --
+ *	Frees a parsed filter.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory and object references are released.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableFreeFilter(TableFilter *filterPtr) {
+    int i;
+
+    for (i = 0; i < filterPtr->numTerms; i++) {
+	if (filterPtr->terms[i].patObj != NULL) {
+	    Tcl_DecrRefCount(filterPtr->terms[i].patObj);
+	}
+    }
+    Tcl_DecrRefCount(filterPtr->specObj);
+    Tcl_Free((char *) filterPtr->terms);
+    Tcl_Free((char *) filterPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFilterMatch --
+ *	Checks a data row (real coords) against all the filter terms.
+ *
+ * Results:
+ *	1 if the row matches, 0 otherwise.
+ *
+ * Side effects:
+ *	Values are retrieved from the data source.
+ *
+ *----------------------------------------------------------------------
+ */
+static int TableFilterMatch(Table *tablePtr, int drow) {
+    TableFilter *filterPtr = tablePtr->filterPtr;
+    TableFilterTerm *termPtr = filterPtr->terms;
+    int i, match = 1;
+    double dbl;
+    char *value, *end;
+
+    for (i = 0; match && i < filterPtr->numTerms; i++, termPtr++) {
+	value = TableGetDataValue(tablePtr, drow+tablePtr->rowOffset,
+		termPtr->col);
+	switch (termPtr->type) {
+	case FILTER_MATCH:
+	    match = Tcl_StringMatch(value, Tcl_GetString(termPtr->patObj));
+	    break;
+	case FILTER_REGEXP:
+	    /* a regexp that fails to run is treated as no match */
+	    match = (Tcl_RegExpExec(NULL, termPtr->regexp, value, value) == 1);
+	    break;
+	case FILTER_RANGE:
+	    dbl = strtod(value, &end);
+	    while (isspace(UCHAR(*end))) end++;
+	    match = (end != value && *end == '\0' &&
+		    dbl >= termPtr->lo && dbl <= termPtr->hi);
+	    break;
+	}
+    }
+    return match;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFilterUpdate --
+ *	Rebuilds the visible rows from the row matches, after
+ *	re-evaluating every row if reeval is set.  Title rows are always
+ *	visible.  tablePtr->rows must hold the real number of rows when
+ *	this is called and holds the visible rows afterwards.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The caller is responsible for recalculating the geometry and
+ *	redrawing.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableFilterUpdate(Table *tablePtr, int reeval) {
+    int i, drow, visible, allRows = tablePtr->rows;
+
+    if (tablePtr->filterPtr == NULL) {
+	return;
+    }
+    if (tablePtr->rowPermSize > allRows) {
+	/* the row order can't outlive the rows it covers */
+	TableSetPerm(tablePtr, ROW, NULL, 0);
+    }
+    if (reeval || allRows != tablePtr->filterRows) {
+	tablePtr->rowFilter = (int *) Tcl_Realloc((char *) tablePtr->rowFilter,
+		allRows * sizeof(int));
+	tablePtr->rowFilterInv = (int *)
+	    Tcl_Realloc((char *) tablePtr->rowFilterInv, allRows * sizeof(int));
+	tablePtr->rowMatch = (char *) Tcl_Realloc(tablePtr->rowMatch, allRows);
+	tablePtr->filterRows = allRows;
+	for (i = 0; i < allRows; i++) {
+	    tablePtr->rowMatch[i] = (char) TableFilterMatch(tablePtr, i);
+	}
+    }
+
+    visible = 0;
+    for (i = 0; i < allRows; i++) {
+	drow = (i < tablePtr->rowPermSize) ? tablePtr->rowPerm[i] : i;
+	if (i < tablePtr->titleRows || tablePtr->rowMatch[drow]) {
+	    tablePtr->rowFilter[visible] = i;
+	    tablePtr->rowFilterInv[i] = visible++;
+	} else {
+	    tablePtr->rowFilterInv[i] = -1;
+	}
+    }
+    if (visible == 0) {
+	/* a table has at least one row, show an empty read-only one */
+	tablePtr->rowFilter[visible++] = -1;
+    }
+    tablePtr->rows = visible;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFilterIdle --
+ *	Rebuilds the visible rows at idle time after cells changed
+ *	whether they match.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The table is redrawn.
+ *
+ *----------------------------------------------------------------------
+ */
+static void TableFilterIdle(ClientData clientData) {
+    Table *tablePtr = (Table *) clientData;
+
+    tablePtr->flags &= ~UPDATE_FILTER;
+    if (tablePtr->filterPtr == NULL || tablePtr->tkwin == NULL) {
+	return;
+    }
+    tablePtr->rows = tablePtr->filterRows;
+    TableFilterUpdate(tablePtr, 0);
+    TableGetActiveBuf(tablePtr);
+    TableAdjustParams(tablePtr);
+    TableGeometryRequest(tablePtr);
+    TableInvalidateAll(tablePtr, 0);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFilterChanged --
+ *	Called when a cell of the data row drow (user coords) changed.
+ *	Re-evaluates that row only.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Schedules the visible rows to be rebuilt if the row changed
+ *	whether it matches.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableFilterChanged(Table *tablePtr, int drow) {
+    int match;
+
+    drow -= tablePtr->rowOffset;
+    if (tablePtr->filterPtr == NULL || drow < 0 ||
+	    drow >= tablePtr->filterRows) {
+	return;
+    }
+    match = TableFilterMatch(tablePtr, drow);
+    if (match != tablePtr->rowMatch[drow]) {
+	tablePtr->rowMatch[drow] = (char) match;
+	if (!(tablePtr->flags & UPDATE_FILTER)) {
+	    tablePtr->flags |= UPDATE_FILTER;
+	    Tcl_DoWhenIdle(TableFilterIdle, (ClientData) tablePtr);
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFilterClear --
+ *	Removes the row filter, if any, making all rows visible again.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	tablePtr->rows is restored.  The caller is responsible for
+ *	recalculating the geometry and redrawing.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableFilterClear(Table *tablePtr) {
+    if (tablePtr->filterPtr == NULL) {
+	return;
+    }
+    if (tablePtr->flags & UPDATE_FILTER) {
+	tablePtr->flags &= ~UPDATE_FILTER;
+	Tcl_CancelIdleCall(TableFilterIdle, (ClientData) tablePtr);
+    }
+    tablePtr->rows = tablePtr->filterRows;
+    TableFreeFilter(tablePtr->filterPtr);
+    tablePtr->filterPtr = NULL;
+    Tcl_Free((char *) tablePtr->rowFilter);
+    Tcl_Free((char *) tablePtr->rowFilterInv);
+    Tcl_Free(tablePtr->rowMatch);
+    tablePtr->rowFilter = tablePtr->rowFilterInv = NULL;
+    tablePtr->rowMatch = NULL;
+    tablePtr->filterRows = 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * Table_FilterCmd --
+ *	This procedure is invoked to process the filter method
+ *	that corresponds to a widget managed by this module.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Rows can be hidden or shown, forcing a redraw.
+ *
+ *--------------------------------------------------------------
+ */
+int Table_FilterCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    Table *tablePtr = (Table *) clientData;
+    TableFilter *filterPtr;
+    TableFilterTerm *termPtr;
+    int i, col, type, count;
+
+    if (objc == 2) {
+	/* return the current filter terms */
+	if (tablePtr->filterPtr != NULL) {
+	    Tcl_SetObjResult(interp, tablePtr->filterPtr->specObj);
+	}
+	return TCL_OK;
+    }
+    if (objc == 3 && STREQ(Tcl_GetString(objv[2]), "clear")) {
+	TableFilterClear(tablePtr);
+	goto update;
+    }
+
+    /*
+     * Parse all the terms before touching the current filter
+     */
+    filterPtr = (TableFilter *) Tcl_Alloc(sizeof(TableFilter));
+    filterPtr->numTerms	= 0;
+    filterPtr->terms	= (TableFilterTerm *)
+	Tcl_Alloc((objc/4+1) * sizeof(TableFilterTerm));
+    filterPtr->specObj	= Tcl_NewListObj(objc-2, objv+2);
+    Tcl_IncrRefCount(filterPtr->specObj);
+    for (i = 2; i < objc; ) {
+	if (i+3 >= objc || !STREQ(Tcl_GetString(objv[i]), "-col")) {
+	    goto wrongArgs;
+	}
+	if (Tcl_GetIntFromObj(interp, objv[i+1], &col) != TCL_OK ||
+		Tcl_GetIndexFromObj(interp, objv[i+2], filterTypeNames, "term",
+			0, &type) != TCL_OK) {
+	    goto error;
+	}
+	termPtr = &(filterPtr->terms[filterPtr->numTerms++]);
+	termPtr->col	= TableViewToData(tablePtr, col, COL);
+	termPtr->type	= type;
+	termPtr->patObj	= NULL;
+	if (type == FILTER_RANGE) {
+	    if (i+4 >= objc) {
+		goto wrongArgs;
+	    }
+	    if (Tcl_GetDoubleFromObj(interp, objv[i+3], &(termPtr->lo)) != TCL_OK ||
+		    Tcl_GetDoubleFromObj(interp, objv[i+4], &(termPtr->hi)) != TCL_OK) {
+		goto error;
+	    }
+	    i += 5;
+	    continue;
+	}
+	/* keep our own copy so the compiled regexp can't be shimmered */
+	termPtr->patObj = Tcl_DuplicateObj(objv[i+3]);
+	Tcl_IncrRefCount(termPtr->patObj);
+	if (type == FILTER_REGEXP) {
+	    termPtr->regexp = Tcl_GetRegExpFromObj(interp, termPtr->patObj,
+		    TCL_REG_ADVANCED);
+	    if (termPtr->regexp == NULL) {
+		goto error;
+	    }
+	}
+	i += 4;
+    }
+
+    /*
+     * Evaluate the new filter over all the rows
+     */
+    if (tablePtr->filterPtr != NULL) {
+	TableFreeFilter(tablePtr->filterPtr);
+	tablePtr->rows = tablePtr->filterRows;
+    }
+    tablePtr->filterPtr = filterPtr;
+    TableFilterUpdate(tablePtr, 1);
+
+    update:
+    TableGetActiveBuf(tablePtr);
+    TableAdjustParams(tablePtr);
+    TableGeometryRequest(tablePtr);
+    TableInvalidateAll(tablePtr, 0);
+
+    /* return the number of rows shown below the titles */
+    count = tablePtr->rows - tablePtr->titleRows;
+    if (TableIsFilterEmptyRow(tablePtr, tablePtr->rows-1)) {
+	/* only the empty row is shown */
+	count = 0;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(count));
+    return TCL_OK;
+
+    wrongArgs:
+    Tcl_WrongNumArgs(interp, 2, objv,
+	    "?clear? ?-col col -match pattern|-regexp re|-range lo hi ...?");
+    error:
+    TableFreeFilter(filterPtr);
+    return TCL_ERROR;
+}
@@ -136,6 +136,8 @@ int Table_ActivateCmd(ClientData clientData, Tcl_Interp *interp,
 		Tk_TextLayout textLayout;
 		TableTag *tagPtr = tablePtr->activeTagPtr;
 
+		/* text is laid out from the unclipped cell origin */
+		TableCellCoords(tablePtr, row, col, &x, &y, &w, &dummy);
 		/* no error checking because GetIndex did it for us */
 		p++;
 		x = strtol(p, &p, 0) - x - tablePtr->activeX;
@@ -155,6 +157,200 @@ int Table_ActivateCmd(ClientData clientData, Tcl_Interp *interp,
     return result;
 }
 
+/* width col -auto switches */
+static const char *autoSwitchNames[] = {
+    "-range", "-sample", (char *)NULL
+};
+enum autoSwitch {
+    AUTO_RANGE, AUTO_SAMPLE
+};
+
+/*
+ * MEASURE_CACHE_MAX is the number of measured strings kept before the
+ * measureCache is flushed.  AUTOFIT_BUDGET is the time in milliseconds
+ * a single "width col -auto" may spend measuring cells.
+ */
+#define MEASURE_CACHE_MAX	16384
+#define AUTOFIT_BUDGET		50
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TableMeasureText --
+ *	Measures the width of a string in the given font, using the
+ *	table's measureCache to avoid remeasuring repeated values.
+ *
+ * Results:
+ *	Width in pixels of the string (of its widest line if multiline).
+ *
+ * Side effects:
+ *	The measureCache may grow, or be flushed if it got too large.
+ *
+ *--------------------------------------------------------------
+ */
+static int TableMeasureText(Table *tablePtr, Tk_Font tkfont, const char *string,
+	int multiline) {
+    Tcl_HashEntry *entryPtr;
+    Tk_TextLayout textLayout;
+    Tcl_DString key;
+    int width, dummy;
+
+    multiline = multiline && (strchr(string, '\n') != NULL);
+
+    /* key on font name and string, the separator notes multiline */
+    Tcl_DStringInit(&key);
+    Tcl_DStringAppend(&key, Tk_NameOfFont(tkfont), -1);
+    Tcl_DStringAppend(&key, multiline ? "\n" : "\t", 1);
+    Tcl_DStringAppend(&key, string, -1);
+
+    entryPtr = Tcl_FindHashEntry(tablePtr->measureCache, Tcl_DStringValue(&key));
+    if (entryPtr != NULL) {
+	Tcl_DStringFree(&key);
+	return PTR2INT(Tcl_GetHashValue(entryPtr));
+    }
+
+    if (multiline) {
+	textLayout = Tk_ComputeTextLayout(tkfont, string, -1, 0, TK_JUSTIFY_LEFT, 0,
+		&width, &dummy);
+	Tk_FreeTextLayout(textLayout);
+    } else {
+	width = Tk_TextWidth(tkfont, string, (int) strlen(string));
+    }
+
+    if (tablePtr->measureCache->numEntries >= MEASURE_CACHE_MAX) {
+	Tcl_DeleteHashTable(tablePtr->measureCache);
+	Tcl_InitHashTable(tablePtr->measureCache, TCL_STRING_KEYS);
+    }
+    entryPtr = Tcl_CreateHashEntry(tablePtr->measureCache, Tcl_DStringValue(&key), &dummy);
+    Tcl_SetHashValue(entryPtr, INT2PTR(width));
+    Tcl_DStringFree(&key);
+    return width;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TableMeasureCell --
+ *	Computes the width a cell needs to display its contents, using
+ *	the font and borders of the tags that apply to it.  The active,
+ *	sel and flash tags are transient and not considered.
+ *	row,col in real coords.
+ *
+ * Results:
+ *	Width in pixels, or 0 if the cell is part of a span.
+ *
+ * Side effects:
+ *	tagPtr is reset and used as scratch space.
+ *
+ *--------------------------------------------------------------
+ */
+static int TableMeasureCell(Table *tablePtr, TableTag *tagPtr, TableTag *colPtr,
+	TableTag *titlePtr, int row, int col) {
+    Tcl_HashEntry *entryPtr;
+    TableTag *rowPtr;
+    char buf[INDEX_BUFSIZE], *value;
+    int urow, ucol, width, dummy, bd[4];
+
+    urow = row+tablePtr->rowOffset;
+    ucol = col+tablePtr->colOffset;
+    TableMakeArrayIndex(urow, ucol, buf);
+
+    /* spanning cells don't belong to a single column */
+    if (tablePtr->spanAffTbl &&
+	    Tcl_FindHashEntry(tablePtr->spanAffTbl, buf) != NULL) {
+	return 0;
+    }
+
+    TableResetTag(tablePtr, tagPtr);
+    if (colPtr != (TableTag *) NULL) {
+	TableMergeTag(tablePtr, tagPtr, colPtr);
+    }
+    rowPtr = FindRowColTag(tablePtr, urow, ROW);
+    if (rowPtr != (TableTag *) NULL) {
+	TableMergeTag(tablePtr, tagPtr, rowPtr);
+    }
+    if (row < tablePtr->titleRows || col < tablePtr->titleCols) {
+	TableMergeTag(tablePtr, tagPtr, titlePtr);
+    }
+    TableMakeDataIndex(tablePtr, urow, ucol, buf);
+    entryPtr = Tcl_FindHashEntry(tablePtr->cellStyles, buf);
+    if (entryPtr != NULL) {
+	TableMergeTag(tablePtr, tagPtr, (TableTag *) Tcl_GetHashValue(entryPtr));
+    }
+
+    width = 0;
+    if (tagPtr->image != NULL) {
+	Tk_SizeOfImage(tagPtr->image, &width, &dummy);
+    }
+    if (tagPtr->image == NULL || tagPtr->showtext != 0) {
+	value = TableGetCellValue(tablePtr, urow, ucol);
+	if (*value != '\0') {
+	    width = MAX(width, TableMeasureText(tablePtr, tagPtr->tkfont, value,
+			    (tagPtr->multiline > 0)));
+	}
+    }
+    TableGetTagBorders(tagPtr, &bd[0], &bd[1], &bd[2], &bd[3]);
+    return width + bd[0] + bd[1] + 2*(tablePtr->padX + tablePtr->ipadX);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TableAutoWidth --
+ *	Finds the width needed to display the rows rlo..rhi of a column.
+ *	Title rows in the range are always measured.  Other rows are
+ *	sampled evenly if sample > 0, and measuring stops early when
+ *	AUTOFIT_BUDGET is used up.  col, rlo and rhi in real coords.
+ *
+ * Results:
+ *	Width in pixels.
+ *
+ * Side effects:
+ *	Row/col tag commands may be evaluated.
+ *
+ *--------------------------------------------------------------
+ */
+static int TableAutoWidth(Table *tablePtr, int col, int rlo, int rhi, int sample) {
+    Tcl_HashEntry *entryPtr;
+    TableTag *tagPtr, *colPtr, *titlePtr;
+    Tcl_Time start, now;
+    int i, row, count, width;
+    double step;
+
+    entryPtr	= Tcl_FindHashEntry(tablePtr->tagTable, "title");
+    titlePtr	= (TableTag *) Tcl_GetHashValue(entryPtr);
+    colPtr	= FindRowColTag(tablePtr, col+tablePtr->colOffset, COL);
+    tagPtr	= TableNewTag(tablePtr);
+
+    width = 0;
+    for (row = rlo; row <= rhi && row < tablePtr->titleRows; row++) {
+	width = MAX(width, TableMeasureCell(tablePtr, tagPtr, colPtr, titlePtr, row, col));
+    }
+
+    rlo	  = row;
+    count = rhi - rlo + 1;
+    if (sample <= 0 || sample > count) {
+	sample = count;
+    }
+    step = (sample > 0) ? (double) count / sample : 1.0;
+
+    Tcl_GetTime(&start);
+    for (i = 0; i < sample; i++) {
+	row = rlo + (int) (i * step);
+	width = MAX(width, TableMeasureCell(tablePtr, tagPtr, colPtr, titlePtr, row, col));
+	if ((i & 63) == 63) {
+	    Tcl_GetTime(&now);
+	    if ((now.sec - start.sec) * 1000 + (now.usec - start.usec) / 1000
+		    > AUTOFIT_BUDGET) {
+		break;
+	    }
+	}
+    }
+
+    Tcl_Free((char *) tagPtr);
+    return width;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -176,10 +372,73 @@ int Table_AdjustCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
     Tcl_HashEntry *entryPtr;
     Tcl_HashSearch search;
     Tcl_HashTable *hashTablePtr;
-    int i, widthType, dummy, value, posn, offset;
+    int i, widthType, dummy, value, posn, offset, mode;
     char buf1[INDEX_BUFSIZE];
 
     widthType = (*(Tcl_GetString(objv[1])) == 'w');
+    if (widthType && objc >= 4 && STREQ(Tcl_GetString(objv[3]), "-auto")) {
+	/* size a column to fit its contents */
+	int rlo, rhi, sample = 0, cmdIndex;
+
+	if (Tcl_GetIntFromObj(interp, objv[2], &posn) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	rlo = tablePtr->rowOffset;
+	rhi = tablePtr->rows-1+tablePtr->rowOffset;
+	for (i = 4; i < objc; i++) {
+	    if (Tcl_GetIndexFromObj(interp, objv[i], autoSwitchNames, "switch", 0,
+		    &cmdIndex) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (cmdIndex == AUTO_SAMPLE) {
+		if (i+1 >= objc) {
+		    goto autoWrongArgs;
+		}
+		if (Tcl_GetIntFromObj(interp, objv[++i], &sample) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+	    } else {
+		if (i+2 >= objc) {
+		    goto autoWrongArgs;
+		}
+		if (Tcl_GetIntFromObj(interp, objv[i+1], &rlo) != TCL_OK ||
+		    Tcl_GetIntFromObj(interp, objv[i+2], &rhi) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		i += 2;
+	    }
+	}
+	posn -= tablePtr->colOffset;
+	rlo  -= tablePtr->rowOffset;
+	rhi  -= tablePtr->rowOffset;
+	if (rlo > rhi) {
+	    value = rlo; rlo = rhi; rhi = value;
+	}
+	CONSTRAIN(rlo, 0, tablePtr->rows-1);
+	CONSTRAIN(rhi, 0, tablePtr->rows-1);
+	if (posn < 0 || posn >= tablePtr->cols) {
+	    Tcl_SetObjResult(interp, Tcl_NewIntObj(0));
+	    return TCL_OK;
+	}
+
+	value = TableAutoWidth(tablePtr, posn, rlo, rhi, sample);
+	if (value > 0) {
+	    /* store as a pixel width, which is exact and excludes padding */
+	    entryPtr = Tcl_CreateHashEntry(tablePtr->colWidths,
+		    INT2PTR(TableViewToData(tablePtr, posn+tablePtr->colOffset,
+			    COL) - tablePtr->colOffset), &dummy);
+	    Tcl_SetHashValue(entryPtr, INT2PTR(-value));
+	    TableAdjustParams(tablePtr);
+	    TableGeometryRequest(tablePtr);
+	    TableInvalidateAll(tablePtr, 0);
+	}
+	Tcl_SetObjResult(interp, Tcl_NewIntObj(-value));
+	return TCL_OK;
+
+	autoWrongArgs:
+	Tcl_WrongNumArgs(interp, 2, objv, "col -auto ?-sample n? ?-range first last?");
+	return TCL_ERROR;
+    }
     /* changes the width/height of certain selected columns */
     if (objc != 3 && (objc & 1)) {
 	Tcl_WrongNumArgs(interp, 2, objv, widthType ?
@@ -189,16 +448,24 @@ int Table_AdjustCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
     if (widthType) {
 	hashTablePtr = tablePtr->colWidths;
 	offset = tablePtr->colOffset;
+	mode = COL;
     } else {
 	hashTablePtr = tablePtr->rowHeights;
 	offset = tablePtr->rowOffset;
+	mode = ROW;
     }
 
     if (objc == 2) {
 	/* print out all the preset column widths or row heights */
 	entryPtr = Tcl_FirstHashEntry(hashTablePtr, &search);
 	while (entryPtr != NULL) {
-	    posn = PTR2INT(Tcl_GetHashKey(hashTablePtr, entryPtr)) + offset;
+	    posn = TableDataToView(tablePtr,
+		    PTR2INT(Tcl_GetHashKey(hashTablePtr, entryPtr)) + offset, mode);
+	    if (posn < offset) {
+		/* hidden by the row filter */
+		entryPtr = Tcl_NextHashEntry(&search);
+		continue;
+	    }
 	    value = PTR2INT(Tcl_GetHashValue(entryPtr));
 	    sprintf(buf1, "%d %d", posn, value);
 	    /* OBJECTIFY */
@@ -212,7 +479,7 @@ int Table_AdjustCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	    return TCL_ERROR;
 	}
 	/* no range check is done, why bother? */
-	posn -= offset;
+	posn = TableViewToData(tablePtr, posn, mode) - offset;
 	entryPtr = Tcl_FindHashEntry(hashTablePtr, INT2PTR(posn));
 	if (entryPtr != NULL) {
 	    Tcl_SetObjResult(interp, Tcl_NewIntObj(PTR2INT(Tcl_GetHashValue(entryPtr))));
@@ -230,7 +497,8 @@ int Table_AdjustCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 		 Tcl_GetIntFromObj(interp, objv[i], &value) != TCL_OK)) {
 		return TCL_ERROR;
 	    }
-	    posn -= offset;
+	    /* sizes follow the data */
+	    posn = TableViewToData(tablePtr, posn, mode) - offset;
 	    if (value == -999999) {
 		/* reset that field */
 		entryPtr = Tcl_FindHashEntry(hashTablePtr, INT2PTR(posn));
@@ -423,7 +691,9 @@ int Table_BorderCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	    value = y-h;
 	    if (value < -1) value = -1;
 	    if (value != tablePtr->scanMarkY) {
-		entryPtr = Tcl_CreateHashEntry(tablePtr->rowHeights, INT2PTR(row), &dummy);
+		entryPtr = Tcl_CreateHashEntry(tablePtr->rowHeights,
+			INT2PTR(TableViewToData(tablePtr, row+tablePtr->rowOffset,
+				ROW) - tablePtr->rowOffset), &dummy);
 		/* -value means rowHeight will be interp'd as pixels, not lines */
 		Tcl_SetHashValue(entryPtr, INT2PTR(MIN(0,-value)));
 		tablePtr->scanMarkY = value;
@@ -435,7 +705,9 @@ int Table_BorderCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	    value = x-w;
 	    if (value < -1) value = -1;
 	    if (value != tablePtr->scanMarkX) {
-		entryPtr = Tcl_CreateHashEntry(tablePtr->colWidths, INT2PTR(col), &dummy);
+		entryPtr = Tcl_CreateHashEntry(tablePtr->colWidths,
+			INT2PTR(TableViewToData(tablePtr, col+tablePtr->colOffset,
+				COL) - tablePtr->colOffset), &dummy);
 		/* -value means colWidth will be interp'd as pixels, not chars */
 		Tcl_SetHashValue(entryPtr, INT2PTR(MIN(0,-value)));
 		tablePtr->scanMarkX = value;
@@ -499,7 +771,7 @@ int Table_ClearCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	    Tcl_DeleteHashTable(tablePtr->rowStyles);
 	    Tcl_DeleteHashTable(tablePtr->colStyles);
 	    Tcl_DeleteHashTable(tablePtr->cellStyles);
-	    Tcl_DeleteHashTable(tablePtr->flashCells);
+	    TableClearFlashes(tablePtr);
 	    Tcl_DeleteHashTable(tablePtr->selCells);
 
 	    /* style hash tables */
@@ -508,7 +780,6 @@ int Table_ClearCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	    Tcl_InitHashTable(tablePtr->cellStyles, TCL_STRING_KEYS);
 
 	    /* special style hash tables */
-	    Tcl_InitHashTable(tablePtr->flashCells, TCL_STRING_KEYS);
 	    Tcl_InitHashTable(tablePtr->selCells, TCL_STRING_KEYS);
 	}
 
@@ -522,7 +793,7 @@ int Table_ClearCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	}
 
 	if (cmdIndex == CLEAR_CACHE || cmdIndex == CLEAR_ALL) {
-	    Table_ClearHashTable(tablePtr->cache);
+	    TableClearValueCache(tablePtr->cache);
 	    Tcl_InitHashTable(tablePtr->cache, TCL_STRING_KEYS);
 	    /* If we were caching and we have no other data source,
 	     * invalidate all the cells */
@@ -532,9 +803,9 @@ int Table_ClearCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	}
 	redraw = 1;
     } else {
-	int row, col, r1, r2, c1, c2;
+	int row, col, drow, dcol, r1, r2, c1, c2;
 	Tcl_HashEntry *entryPtr;
-	char buf[INDEX_BUFSIZE], *value;
+	char buf[INDEX_BUFSIZE], dataBuf[INDEX_BUFSIZE];
 
 	if (TableGetIndexObj(tablePtr, objv[3], &row, &col) != TCL_OK ||
 	    ((objc == 5) && TableGetIndexObj(tablePtr, objv[4], &r2, &c2) != TCL_OK)) {
@@ -549,35 +820,39 @@ int Table_ClearCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 	}
 	for (row = r1; row <= r2; row++) {
 	    /* Note that *Styles entries are user based (no offset)
-	     * while size entries are 0-based (real) */
+	     * while size entries are 0-based (real), and both are
+	     * kept by data index */
+	    drow = TableViewToData(tablePtr, row, ROW);
 	    if ((cmdIndex == CLEAR_TAGS || cmdIndex == CLEAR_ALL) &&
-		(entryPtr = Tcl_FindHashEntry(tablePtr->rowStyles, INT2PTR(row)))) {
+		(entryPtr = Tcl_FindHashEntry(tablePtr->rowStyles, INT2PTR(drow)))) {
 		Tcl_DeleteHashEntry(entryPtr);
 		redraw = 1;
 	    }
 
 	    if ((cmdIndex == CLEAR_SIZES || cmdIndex == CLEAR_ALL) &&
 		(entryPtr = Tcl_FindHashEntry(tablePtr->rowHeights,
-					      INT2PTR(row-tablePtr->rowOffset)))) {
+					      INT2PTR(drow-tablePtr->rowOffset)))) {
 		Tcl_DeleteHashEntry(entryPtr);
 		redraw = 1;
 	    }
 
 	    for (col = c1; col <= c2; col++) {
+		dcol = TableViewToData(tablePtr, col, COL);
 		TableMakeArrayIndex(row, col, buf);
+		TableMakeArrayIndex(drow, dcol, dataBuf);
 
 		if (cmdIndex == CLEAR_TAGS || cmdIndex == CLEAR_ALL) {
 		    if ((row == r1) && (entryPtr = Tcl_FindHashEntry(tablePtr->colStyles,
-				INT2PTR(col)))) {
+				INT2PTR(dcol)))) {
 			Tcl_DeleteHashEntry(entryPtr);
 			redraw = 1;
 		    }
-		    if ((entryPtr = Tcl_FindHashEntry(tablePtr->cellStyles, buf))) {
+		    if ((entryPtr = Tcl_FindHashEntry(tablePtr->cellStyles, dataBuf))) {
 			Tcl_DeleteHashEntry(entryPtr);
 			redraw = 1;
 		    }
-		    if ((entryPtr = Tcl_FindHashEntry(tablePtr->flashCells, buf))) {
-			Tcl_DeleteHashEntry(entryPtr);
+		    if ((entryPtr = TableFindFlash(tablePtr, row, col))) {
+			TableDeleteFlash(tablePtr, entryPtr);
 			redraw = 1;
 		    }
 		    if ((entryPtr = Tcl_FindHashEntry(tablePtr->selCells, buf))) {
@@ -588,15 +863,14 @@ int Table_ClearCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj
 
 		if ((cmdIndex == CLEAR_SIZES || cmdIndex == CLEAR_ALL) &&
 		    row == r1 && (entryPtr = Tcl_FindHashEntry(tablePtr->colWidths,
-			INT2PTR(col-tablePtr->colOffset)))) {
+			INT2PTR(dcol-tablePtr->colOffset)))) {
 		    Tcl_DeleteHashEntry(entryPtr);
 		    redraw = 1;
 		}
 
 		if ((cmdIndex == CLEAR_CACHE || cmdIndex == CLEAR_ALL) &&
-			(entryPtr = Tcl_FindHashEntry(tablePtr->cache, buf))) {
-		    value = (char *) Tcl_GetHashValue(entryPtr);
-		    if (value) { Tcl_Free(value); }
+			(entryPtr = Tcl_FindHashEntry(tablePtr->cache, dataBuf))) {
+		    TableFreeCacheValue((char *) Tcl_GetHashValue(entryPtr));
 		    Tcl_DeleteHashEntry(entryPtr);
 		    /* if the cache is our data source,
 		     * we need to invalidate the cells changed */
@@ -830,6 +1104,7 @@ int Table_ScanCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 
 	case BD_DRAGTO: {
 	    int oldTop = tablePtr->topRow, oldLeft = tablePtr->leftCol;
+	    int oldShift = tablePtr->topRowShift || tablePtr->leftColShift;
 	    y += (5*(y-tablePtr->scanMarkY));
 	    x += (5*(x-tablePtr->scanMarkX));
 
@@ -840,9 +1115,12 @@ int Table_ScanCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 		    tablePtr->titleRows, tablePtr->rows-1);
 	    tablePtr->leftCol = BETWEEN(col-tablePtr->scanMarkCol,
 		    tablePtr->titleCols, tablePtr->cols-1);
+	    tablePtr->topRowShift = tablePtr->leftColShift = 0;
 
 	    /* Adjust the table if new top left */
-	    if (oldTop != tablePtr->topRow || oldLeft != tablePtr->leftCol) {
+	    if (oldTop != tablePtr->topRow || oldLeft != tablePtr->leftCol
+		    || oldShift) {
+		tablePtr->flags |= SCROLL_VIEW;
 		TableAdjustParams(tablePtr);
 	    }
 	    break;
@@ -1112,6 +1390,210 @@ SET_CELLS:
     return TCL_OK;
 }
 
+/* snapshot switches */
+static const char *snapSwitchNames[] = {
+    "-file", "-image", (char *)NULL
+};
+enum snapSwitch {
+    SNAP_FILE, SNAP_IMAGE
+};
+
+/*
+ * Where TableSnapshot strips go for the snapshot method
+ */
+typedef struct {
+    Tcl_Interp *interp;
+    Tcl_Channel chan;		/* PPM file, or NULL */
+    Tk_PhotoHandle photo;	/* photo image, or NULL */
+} TableSnapOut;
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TableSnapshotStrip --
+ *	The TableSnapshotProc of the snapshot method, writes a strip
+ *	of rows to the PPM file and/or puts it in the photo image.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Writes to the file or changes the photo image.
+ *
+ *--------------------------------------------------------------
+ */
+static int TableSnapshotStrip(ClientData clientData, unsigned char *rgb,
+	int y, int width, int height) {
+    TableSnapOut *outPtr = (TableSnapOut *) clientData;
+    Tk_PhotoImageBlock block;
+
+    if (outPtr->chan != NULL
+	    && Tcl_Write(outPtr->chan, (char *) rgb, width * height * 3) < 0) {
+	Tcl_AppendResult(outPtr->interp, "error writing snapshot: ",
+		Tcl_PosixError(outPtr->interp), (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (outPtr->photo != NULL) {
+	block.pixelPtr	= rgb;
+	block.width	= width;
+	block.height	= height;
+	block.pitch	= width * 3;
+	block.pixelSize	= 3;
+	block.offset[0]	= 0;
+	block.offset[1]	= 1;
+	block.offset[2]	= 2;
+	block.offset[3]	= 3;	/* no alpha */
+	return Tk_PhotoPutBlock(outPtr->interp, outPtr->photo, &block,
+		0, y, width, height, TK_PHOTO_COMPOSITE_SET);
+    }
+    return TCL_OK;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * Table_SnapshotCmd --
+ *	This procedure is invoked to process the snapshot method
+ *	that corresponds to a table widget managed by this module.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *--------------------------------------------------------------
+ */
+int Table_SnapshotCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    Table *tablePtr = (Table *) clientData;
+    int i, index, r1, c1, r2, c2, row, col, width, height, result;
+    char *fileName = NULL, *imageName = NULL, header[64];
+    TableSnapOut out;
+    Tcl_WideInt usec;
+    Tcl_Obj *resultPtr;
+
+    /* the range comes first, indices never match a switch exactly */
+    for (i = 2; i < objc; i++) {
+	if (Tcl_GetIndexFromObj(NULL, objv[i], snapSwitchNames, "switch",
+		TCL_EXACT, &index) == TCL_OK) {
+	    break;
+	}
+    }
+    if ((i > 4) || ((objc - i) & 1)) {
+	Tcl_WrongNumArgs(interp, 2, objv,
+		"?first? ?last? ?-file fileName? ?-image photo?");
+	return TCL_ERROR;
+    }
+    if (i == 2) {
+	r1 = 0; c1 = 0;
+	r2 = tablePtr->rows-1; c2 = tablePtr->cols-1;
+    } else {
+	if (TableGetIndexObj(tablePtr, objv[2], &row, &col) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	r1 = r2 = row-tablePtr->rowOffset;
+	c1 = c2 = col-tablePtr->colOffset;
+	if (i == 4) {
+	    if (TableGetIndexObj(tablePtr, objv[3], &row, &col) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    row -= tablePtr->rowOffset; col -= tablePtr->colOffset;
+	    r1 = MIN(r1, row); r2 = MAX(r2, row);
+	    c1 = MIN(c1, col); c2 = MAX(c2, col);
+	}
+    }
+    for ( ; i < objc; i += 2) {
+	if (Tcl_GetIndexFromObj(interp, objv[i], snapSwitchNames, "switch", 0,
+		&index) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (index == SNAP_FILE) {
+	    fileName = Tcl_GetString(objv[i+1]);
+	} else {
+	    imageName = Tcl_GetString(objv[i+1]);
+	}
+    }
+    if (tablePtr->rows <= 0 || tablePtr->cols <= 0) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj("table has no cells to snapshot", -1));
+	return TCL_ERROR;
+    }
+    /* check before the image is resized or the file is created */
+    if ((tablePtr->tkwin == NULL) || !Tk_IsMapped(tablePtr->tkwin)) {
+	Tcl_SetObjResult(interp,
+		Tcl_NewStringObj("can't snapshot a table that isn't mapped", -1));
+	return TCL_ERROR;
+    }
+    if (tablePtr->colStarts[c2+1] - tablePtr->colStarts[c1] > INT_MAX) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj("snapshot is too wide", -1));
+	return TCL_ERROR;
+    }
+    if (tablePtr->rowStarts[r2+1] - tablePtr->rowStarts[r1] > INT_MAX) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj("snapshot is too tall", -1));
+	return TCL_ERROR;
+    }
+    width  = (int) (tablePtr->colStarts[c2+1] - tablePtr->colStarts[c1]);
+    height = (int) (tablePtr->rowStarts[r2+1] - tablePtr->rowStarts[r1]);
+
+    out.interp	= interp;
+    out.chan	= NULL;
+    out.photo	= NULL;
+    if (imageName != NULL) {
+	out.photo = Tk_FindPhoto(interp, imageName);
+	if (out.photo == NULL) {
+	    Tcl_AppendResult(interp, "image \"", imageName,
+		    "\" doesn't exist or is not a photo image", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	if (Tk_PhotoSetSize(interp, out.photo, width, height) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    if (fileName != NULL) {
+	if (Tcl_IsSafe(interp)) {
+	    Tcl_AppendResult(interp, "can't specify -file in a",
+		    " safe interpreter", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	out.chan = Tcl_OpenFileChannel(interp, fileName, "w", 0666);
+	if (out.chan == NULL ||
+		Tcl_SetChannelOption(interp, out.chan, "-translation", "binary")
+		!= TCL_OK) {
+	    if (out.chan != NULL) {
+		Tcl_Close(NULL, out.chan);
+	    }
+	    return TCL_ERROR;
+	}
+	sprintf(header, "P6\n%d %d\n255\n", width, height);
+	Tcl_WriteChars(out.chan, header, -1);
+    }
+
+    result = TableSnapshot(tablePtr, r1, c1, r2, c2, TableSnapshotStrip,
+	    (ClientData) &out, &usec);
+    if (out.chan != NULL && Tcl_Close(interp, out.chan) != TCL_OK) {
+	result = TCL_ERROR;
+    }
+    if (result != TCL_OK) {
+	if (out.chan != NULL) {
+	    /* don't leave a partial file behind */
+	    Tcl_Obj *pathPtr = Tcl_NewStringObj(fileName, -1);
+
+	    Tcl_IncrRefCount(pathPtr);
+	    Tcl_FSDeleteFile(pathPtr);
+	    Tcl_DecrRefCount(pathPtr);
+	}
+	return result;
+    }
+
+    /* width, height and the time spent rendering in microseconds */
+    resultPtr = Tcl_NewListObj(0, NULL);
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(width));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(height));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewWideIntObj(usec));
+    Tcl_SetObjResult(interp, resultPtr);
+    return TCL_OK;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -1142,34 +1624,11 @@ int Table_ViewCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 
     if (objc == 2) {
 	Tcl_Obj *resultPtr;
-	int diff, x, y, w, h;
 	double first, last;
 
 	resultPtr = Tcl_NewListObj(0, NULL);
 	if (!resultPtr) return TCL_ERROR;
-	TableGetLastCell(tablePtr, &row, &col);
-	TableCellVCoords(tablePtr, row, col, &x, &y, &w, &h, 0);
-	if (*xy == 'y') {
-	    if (row < tablePtr->titleRows) {
-		first = 0;
-		last  = 1;
-	    } else {
-		diff = tablePtr->rowStarts[tablePtr->titleRows];
-		last = (double) (tablePtr->rowStarts[tablePtr->rows]-diff);
-		first = (tablePtr->rowStarts[tablePtr->topRow]-diff) / last;
-		last  = (h+tablePtr->rowStarts[row]-diff) / last;
-	    }
-	} else {
-	    if (col < tablePtr->titleCols) {
-		first = 0;
-		last  = 1;
-	    } else {
-		diff = tablePtr->colStarts[tablePtr->titleCols];
-		last = (double) (tablePtr->colStarts[tablePtr->cols]-diff);
-		first = (tablePtr->colStarts[tablePtr->leftCol]-diff) / last;
-		last  = (w+tablePtr->colStarts[col]-diff) / last;
-	    }
-	}
+	TableViewFractions(tablePtr, (*xy == 'y'), &first, &last);
 	Tcl_ListObjAppendElement(interp, resultPtr, Tcl_NewDoubleObj(first));
 	Tcl_ListObjAppendElement(interp, resultPtr, Tcl_NewDoubleObj(last));
 	Tcl_SetObjResult(interp, resultPtr);
@@ -1177,6 +1636,12 @@ int Table_ViewCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
     } else {
 	/* cache old topleft to see if it changes */
 	int oldTop = tablePtr->topRow, oldLeft = tablePtr->leftCol;
+	int oldTopShift = tablePtr->topRowShift;
+	int oldLeftShift = tablePtr->leftColShift;
+	int *shiftPtr = (*xy == 'y') ? &(tablePtr->topRowShift) :
+	    &(tablePtr->leftColShift);
+	Tcl_Size len;
+	char *what;
 
 	if (objc == 3) {
 	    if (Tcl_GetIntFromObj(interp, objv[2], &value) != TCL_OK) {
@@ -1187,6 +1652,32 @@ int Table_ViewCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 	    } else {
 		tablePtr->leftCol = value + tablePtr->titleCols;
 	    }
+	    *shiftPtr = 0;
+	} else if (objc == 5
+		&& STREQ(Tcl_GetString(objv[2]), "scroll")
+		&& (what = Tcl_GetStringFromObj(objv[4], &len), len >= 2)
+		&& strncmp(what, "pixels", (size_t) len) == 0) {
+	    /*
+	     * Scroll by pixels, which may leave the top row or left col
+	     * partially scrolled out of view.
+	     */
+	    Tcl_WideInt *starts;
+	    int title, top;
+	    if (Tk_GetPixelsFromObj(interp, tablePtr->tkwin, objv[3],
+			&value) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (*xy == 'y') {
+		starts = tablePtr->rowStarts;
+		title = tablePtr->titleRows;
+		top = tablePtr->topRow;
+	    } else {
+		starts = tablePtr->colStarts;
+		title = tablePtr->titleCols;
+		top = tablePtr->leftCol;
+	    }
+	    TableSetViewPixel(tablePtr, (*xy == 'y'),
+		    starts[top] - starts[title] + *shiftPtr + value);
 	} else {
 	    int result;
 	    double frac;
@@ -1201,6 +1692,7 @@ int Table_ViewCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 		} else {
 		    tablePtr->leftCol = (int)(frac*tablePtr->cols) + tablePtr->titleCols;
 		}
+		*shiftPtr = 0;
 		break;
 	    case TK_SCROLL_PAGES:
 		TableGetLastCell(tablePtr, &row, &col);
@@ -1209,13 +1701,19 @@ int Table_ViewCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 		} else {
 		    tablePtr->leftCol += value * (col-tablePtr->leftCol+1);
 		}
+		*shiftPtr = 0;
 		break;
 	    case TK_SCROLL_UNITS:
+		/* units scroll to whole rows/cols, snapping any shift */
+		if (value < 0 && *shiftPtr) {
+		    value++;
+		}
 		if (*xy == 'y') {
 		    tablePtr->topRow  += value;
 		} else {
 		    tablePtr->leftCol += value;
 		}
+		*shiftPtr = 0;
 		break;
 	    }
 	}
@@ -1223,7 +1721,10 @@ int Table_ViewCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 	CONSTRAIN(tablePtr->topRow, tablePtr->titleRows, tablePtr->rows-1);
 	CONSTRAIN(tablePtr->leftCol, tablePtr->titleCols, tablePtr->cols-1);
 	/* Do the table adjustment if topRow || leftCol changed */
-	if (oldTop != tablePtr->topRow || oldLeft != tablePtr->leftCol) {
+	if (oldTop != tablePtr->topRow || oldLeft != tablePtr->leftCol
+		|| oldTopShift != tablePtr->topRowShift
+		|| oldLeftShift != tablePtr->leftColShift) {
+	    tablePtr->flags |= SCROLL_VIEW;
 	    TableAdjustParams(tablePtr);
 	}
     }
@@ -303,7 +303,8 @@ int Table_EditCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 
 	count	= 1;
 	maxcol	= tablePtr->cols-1+tablePtr->colOffset;
-	maxrow	= tablePtr->rows-1+tablePtr->rowOffset;
+	/* a row filter only shows some of the rows */
+	maxrow	= TableAllRows(tablePtr)-1+tablePtr->rowOffset;
 	if (strcmp(Tcl_GetString(objv[i]), "end") == 0) {
 	    /* allow "end" to be specified as an index */
 	    first = (doRows) ? maxrow : maxcol;
@@ -318,6 +319,16 @@ int Table_EditCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *
 	    return TCL_OK;
 	}
 
+	/* rows are moved in the data, so the row filter can't be kept */
+	if (tablePtr->filterPtr != NULL) {
+	    TableFilterClear(tablePtr);
+	    TableAdjustParams(tablePtr);
+	    TableInvalidateAll(tablePtr, 0);
+	}
+
+	/* moving the data invalidates any view order on that axis */
+	TableSetPerm(tablePtr, doRows ? ROW : COL, NULL, 0);
+
 	if (doRows) {
 	    maxkey	= maxrow;
 	    minkey	= tablePtr->rowOffset;
@@ -495,22 +506,22 @@ void TableDeleteChars(
     int index,			/* Index of first character to delete. */
     int count) {		/* How many characters to delete. */
 
-    int byteIndex, byteCount, newByteCount, numBytes, numChars;
+    int byteIndex, byteCount, newByteCount, numBytes;
     char *new, *string;
+    TableValueInfo info;
 
     string = tablePtr->activeBuf;
-    numBytes = (int) strlen(string);
-    numChars = (int) Tcl_NumUtfChars(string, (Tcl_Size)numBytes);
-    if ((index + count) > numChars) {
-	count = numChars - index;
+    TableScanValue(string, &info);
+    numBytes = info.length;
+    if ((index + count) > info.numChars) {
+	count = info.numChars - index;
     }
     if (count <= 0) {
 	return;
     }
 
-    byteIndex = (int) (Tcl_UtfAtIndex(string, (Tcl_Size)index) - string);
-    byteCount = (int) (Tcl_UtfAtIndex(string + byteIndex, (Tcl_Size)count) -
-	(string + byteIndex));
+    byteIndex = TableValueOffset(string, &info, index);
+    byteCount = TableValueOffset(string, &info, index + count) - byteIndex;
 
     newByteCount = numBytes + 1 - byteCount;
     new = (char *) Tcl_Alloc((unsigned) newByteCount);
@@ -567,6 +578,7 @@ void TableInsertChars(
 
     int oldlen, byteIndex, byteCount;
     char *new, *string;
+    TableValueInfo info;
 
     byteCount = (int) strlen(value);
     if (byteCount == 0) {
@@ -585,9 +597,10 @@ void TableInsertChars(
     }
 
     string = tablePtr->activeBuf;
-    byteIndex = (int) (Tcl_UtfAtIndex(string, (Tcl_Size)index) - string);
+    TableScanValue(string, &info);
+    byteIndex = TableValueOffset(string, &info, index);
 
-    oldlen = (int) strlen(string);
+    oldlen = info.length;
     new = (char *) Tcl_Alloc((unsigned)(oldlen + byteCount + 1));
     memcpy(new, string, (size_t) byteIndex);
     strcpy(new + byteIndex, value);
@@ -614,8 +627,10 @@ void TableInsertChars(
      */
 
     if (tablePtr->icursor >= index) {
-	tablePtr->icursor += (int) (Tcl_NumUtfChars(new, (Tcl_Size)(oldlen+byteCount))
-	    - Tcl_NumUtfChars(tablePtr->activeBuf, (Tcl_Size)oldlen));
+	TableValueInfo newInfo;
+
+	TableScanValue(new, &newInfo);
+	tablePtr->icursor += newInfo.numChars - info.numChars;
     }
 
     Tcl_Free(string);
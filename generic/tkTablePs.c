@@ -836,7 +836,7 @@ int Table_PostscriptCmd(
 		TableMergeTag(tablePtr, tagPtr, titlePtr);
 	    }
 	    /* Does this have a cell tag */
-	    TableMakeArrayIndex(row+tablePtr->rowOffset,
+	    TableMakeDataIndex(tablePtr, row+tablePtr->rowOffset,
 				col+tablePtr->colOffset, string);
 	    hPtr = Tcl_FindHashEntry(tablePtr->cellStyles, string);
 	    if (hPtr != NULL) {
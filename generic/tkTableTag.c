@@ -363,6 +363,145 @@ void TableMergeTag(Table *tablePtr, TableTag *baseTag, TableTag *addTag) {
 #endif
 }
 
+/*
+ * A merged tag in the styleCache, with the STYLE_ACTIVE/STYLE_DISABLED
+ * result of the merge.
+ */
+typedef struct {
+    TableJoinTag jtag;
+    int result;
+} TableStyle;
+
+/*
+ * The maximum number of merged tags kept in the styleCache.  Each is a
+ * distinct combination of tags and cell state, so this is rarely hit.
+ */
+#define STYLE_CACHE_MAX	1024
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableResolveTag --
+ *	Sets tagPtr to the merge of the table defaults and the given
+ *	col, row and cell tags (each may be NULL), plus the title,
+ *	active, sel and flash tags as given by the STYLE_* bits in
+ *	state.  Each distinct combination is merged only once and then
+ *	kept in the styleCache.
+ *
+ * Results:
+ *	STYLE_ACTIVE if the active tag was merged, STYLE_DISABLED if
+ *	the active cell was disabled instead, else 0.
+ *
+ * Side effects:
+ *	tagPtr (a join tag) will have values changed.
+ *
+ *----------------------------------------------------------------------
+ */
+int TableResolveTag(Table *tablePtr, TableTag *tagPtr, TableTag *colPtr,
+	TableTag *rowPtr, TableTag *cellPtr, int state) {
+    TableStyleKey key;
+    TableStyle *stylePtr;
+    Tcl_HashEntry *entryPtr;
+    int new, invert = 0;
+
+    memset((void *) &key, 0, sizeof(key));
+    key.colPtr	= colPtr;
+    key.rowPtr	= rowPtr;
+    key.cellPtr	= cellPtr;
+    key.state	= (size_t) state;
+
+    entryPtr = Tcl_FindHashEntry(tablePtr->styleCache, (char *) &key);
+    if (entryPtr != NULL) {
+	stylePtr = (TableStyle *) Tcl_GetHashValue(entryPtr);
+	memcpy((void *) tagPtr, (void *) &(stylePtr->jtag), sizeof(TableJoinTag));
+	return stylePtr->result;
+    }
+
+    if (tablePtr->styleCache->numEntries >= STYLE_CACHE_MAX) {
+	TableFlushStyleCache(tablePtr);
+    }
+    stylePtr = (TableStyle *) Tcl_Alloc(sizeof(TableStyle));
+    stylePtr->result = 0;
+
+    /*
+     * Tags have their own priorities which TableMergeTag will
+     * take into account when merging tags.
+     */
+    TableResetTag(tablePtr, tagPtr);
+    if (colPtr != NULL) {
+	TableMergeTag(tablePtr, tagPtr, colPtr);
+    }
+    if (rowPtr != NULL) {
+	TableMergeTag(tablePtr, tagPtr, rowPtr);
+    }
+    if (state & STYLE_TITLE) {
+	entryPtr = Tcl_FindHashEntry(tablePtr->tagTable, "title");
+	TableMergeTag(tablePtr, tagPtr, (TableTag *) Tcl_GetHashValue(entryPtr));
+    }
+    if (cellPtr != NULL) {
+	TableMergeTag(tablePtr, tagPtr, cellPtr);
+    }
+    if (state & STYLE_ACTIVE) {
+	if (tagPtr->state == STATE_DISABLED) {
+	    stylePtr->result = STYLE_DISABLED;
+	} else {
+	    entryPtr = Tcl_FindHashEntry(tablePtr->tagTable, "active");
+	    TableMergeTag(tablePtr, tagPtr, (TableTag *) Tcl_GetHashValue(entryPtr));
+	    stylePtr->result = STYLE_ACTIVE;
+	}
+    }
+    if (state & STYLE_SEL) {
+	if (tablePtr->invertSelected && !(stylePtr->result & STYLE_ACTIVE)) {
+	    invert = 1;
+	} else {
+	    entryPtr = Tcl_FindHashEntry(tablePtr->tagTable, "sel");
+	    TableMergeTag(tablePtr, tagPtr, (TableTag *) Tcl_GetHashValue(entryPtr));
+	}
+    }
+    if (state & STYLE_FLASH) {
+	entryPtr = Tcl_FindHashEntry(tablePtr->tagTable, "flash");
+	TableMergeTag(tablePtr, tagPtr, (TableTag *) Tcl_GetHashValue(entryPtr));
+    }
+    if (invert) {
+	TableInvertTag(tagPtr);
+    }
+
+    memcpy((void *) &(stylePtr->jtag), (void *) tagPtr, sizeof(TableJoinTag));
+    entryPtr = Tcl_CreateHashEntry(tablePtr->styleCache, (char *) &key, &new);
+    Tcl_SetHashValue(entryPtr, (ClientData) stylePtr);
+    return stylePtr->result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TableFlushStyleCache --
+ *	Frees all merged tags in the styleCache.  This must be called
+ *	whenever a tag, its priority or the table defaults change.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The styleCache is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+void TableFlushStyleCache(Table *tablePtr) {
+    Tcl_HashEntry *entryPtr;
+    Tcl_HashSearch search;
+
+    if (tablePtr->styleCache->numEntries == 0) {
+	return;
+    }
+    for (entryPtr = Tcl_FirstHashEntry(tablePtr->styleCache, &search);
+	 entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+	Tcl_Free((char *) Tcl_GetHashValue(entryPtr));
+    }
+    Tcl_DeleteHashTable(tablePtr->styleCache);
+    Tcl_InitHashTable(tablePtr->styleCache, STYLE_KEY_WORDS);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -582,6 +721,8 @@ int TableInitTags(Tcl_Interp *interp, Table *tablePtr) {
  *
  * FindRowColTag --
  *	Finds a row/col tag based on the row/col styles and tagCommand.
+ *	cell is the view index in user coords, the styles are kept by
+ *	data index and the tagCommand receives the data index.
  *
  * Results:
  *	Returns tag associated with row/col cell, if any.
@@ -598,6 +739,7 @@ TableTag * FindRowColTag(Table *tablePtr, int cell, int mode) {
     Tcl_HashEntry *entryPtr;
     TableTag *tagPtr = NULL;
 
+    cell = TableViewToData(tablePtr, cell, mode);
     entryPtr = Tcl_FindHashEntry((mode == ROW) ? tablePtr->rowStyles
 				 : tablePtr->colStyles, INT2PTR(cell));
     if (entryPtr == NULL) {
@@ -739,7 +881,14 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		    for (scanPtr = Tcl_FirstHashEntry(hashTblPtr, &search);
 			 scanPtr != NULL;
 			 scanPtr = Tcl_NextHashEntry(&search)) {
-			keybuf = (char *) Tcl_GetHashKey(hashTblPtr, scanPtr);
+			if (hashTblPtr == tablePtr->flashCells) {
+			    /* flashing cells are keyed by row,col ints */
+			    TableFlash *flashPtr = (TableFlash *) Tcl_GetHashValue(scanPtr);
+			    TableMakeArrayIndex(flashPtr->row, flashPtr->col, buf);
+			    keybuf = buf;
+			} else {
+			    keybuf = (char *) Tcl_GetHashKey(hashTblPtr, scanPtr);
+			}
 			Tcl_ListObjAppendElement(NULL, resultPtr,
 				Tcl_NewStringObj(keybuf, -1));
 		    }
@@ -778,6 +927,19 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 			 scanPtr = Tcl_NextHashEntry(&search)) {
 			if ((TableTag *) Tcl_GetHashValue(scanPtr) == tagPtr) {
 			    keybuf = (char *) Tcl_GetHashKey(tablePtr->cellStyles, scanPtr);
+			    if ((tablePtr->rowPerm || tablePtr->colPerm ||
+				    tablePtr->rowFilter) &&
+				    TableParseArrayIndex(&row, &col, keybuf) == 2) {
+				/* report where the data cell is shown */
+				row = TableDataToView(tablePtr, row, ROW);
+				if (row < tablePtr->rowOffset) {
+				    /* hidden by the row filter */
+				    continue;
+				}
+				TableMakeArrayIndex(row,
+				    TableDataToView(tablePtr, col, COL), buf);
+				keybuf = buf;
+			    }
 			    Tcl_ListObjAppendElement(NULL, resultPtr,
 				    Tcl_NewStringObj(keybuf, -1));
 			}
@@ -798,9 +960,9 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		    return TCL_ERROR;
 		}
 		/*
-		 * Get the hash key ready
+		 * Get the hash key ready, cell tags follow the data
 		 */
-		TableMakeArrayIndex(row, col, buf);
+		TableMakeDataIndex(tablePtr, row, col, buf);
 
 		if (tagPtr == NULL) {
 		    /*
@@ -880,7 +1042,13 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		    for (scanPtr = Tcl_FirstHashEntry(hashTblPtr, &search);
 			 scanPtr != NULL;
 			 scanPtr = Tcl_NextHashEntry(&search)) {
-			TableParseArrayIndex(&row, &col, Tcl_GetHashKey(hashTblPtr, scanPtr));
+			if (hashTblPtr == tablePtr->flashCells) {
+			    TableFlash *flashPtr = (TableFlash *) Tcl_GetHashValue(scanPtr);
+			    row = flashPtr->row;
+			    col = flashPtr->col;
+			} else {
+			    TableParseArrayIndex(&row, &col, Tcl_GetHashKey(hashTblPtr, scanPtr));
+			}
 			value = forRows ? row : col;
 			Tcl_CreateHashEntry(cacheTblPtr, INT2PTR(value), &newEntry);
 			if (newEntry) {
@@ -915,7 +1083,14 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 			 scanPtr = Tcl_NextHashEntry(&search)) {
 			/* is this the tag pointer on this row */
 			if ((TableTag *) Tcl_GetHashValue(scanPtr) == tagPtr) {
-			    objPtr = Tcl_NewIntObj(PTR2INT(Tcl_GetHashKey(hashTblPtr, scanPtr)));
+			    value = TableDataToView(tablePtr,
+				    PTR2INT(Tcl_GetHashKey(hashTblPtr, scanPtr)),
+				    forRows ? ROW : COL);
+			    if (forRows && value < tablePtr->rowOffset) {
+				/* hidden by the row filter */
+				continue;
+			    }
+			    objPtr = Tcl_NewIntObj(value);
 			    Tcl_ListObjAppendElement(NULL, resultPtr, objPtr);
 			}
 		    }
@@ -934,11 +1109,13 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		if (Tcl_GetIntFromObj(interp, objv[i], &value) != TCL_OK) {
 		    return TCL_ERROR;
 		}
+		/* row|col tags follow the data */
+		row = TableViewToData(tablePtr, value, forRows ? ROW : COL);
 		if (tagPtr == NULL) {
 		    /*
 		     * This is a deletion
 		     */
-		    entryPtr = Tcl_FindHashEntry(hashTblPtr, INT2PTR(value));
+		    entryPtr = Tcl_FindHashEntry(hashTblPtr, INT2PTR(row));
 		    if (entryPtr != NULL) {
 			Tcl_DeleteHashEntry(entryPtr);
 			refresh = 1;
@@ -948,7 +1125,7 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		     * Add a key to the hash table and set it to point to the
 		     * Tag structure if it wasn't the same as an existing one
 		     */
-		    entryPtr = Tcl_CreateHashEntry(hashTblPtr, INT2PTR(value), &newEntry);
+		    entryPtr = Tcl_CreateHashEntry(hashTblPtr, INT2PTR(row), &newEntry);
 		    if (newEntry || (tagPtr != (TableTag *) Tcl_GetHashValue(entryPtr))) {
 			Tcl_SetHashValue(entryPtr, (ClientData) tagPtr);
 			refresh = 1;
@@ -1027,8 +1204,13 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		tagPtr->image = image;
 
 		/*
-		 * We reconfigured, so invalidate the table to redraw
+		 * We reconfigured, so invalidate the table to redraw.
+		 * The tag font may have been freed, so drop cached layouts,
+		 * merged tags and GCs.
 		 */
+		TableFlushLayoutCache(tablePtr);
+		TableFlushStyleCache(tablePtr);
+		TableFlushGcCache(tablePtr);
 		TableInvalidateAll(tablePtr, 0);
 	    }
 	    return result;
@@ -1098,7 +1280,10 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		    }
 		    tablePtr->tagPrioSize--;
 
-		    /* Release the tag structure */
+		    /* Release the tag structure, and any layouts using its font */
+		    TableFlushLayoutCache(tablePtr);
+		    TableFlushStyleCache(tablePtr);
+		    TableFlushGcCache(tablePtr);
 		    TableCleanupTag(tablePtr, tagPtr);
 		    Tcl_Free((char *) tagPtr);
 
@@ -1147,7 +1332,7 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 			tablePtr->activeCol+tablePtr->colOffset==col);
 	    } else if (STREQ(tagname, "flash")) {
 		result = (tablePtr->flashMode &&
-			(Tcl_FindHashEntry(tablePtr->flashCells, buf) != NULL));
+			(TableFindFlash(tablePtr, row, col) != NULL));
 	    } else if (STREQ(tagname, "sel")) {
 		result = (Tcl_FindHashEntry(tablePtr->selCells, buf) != NULL);
 	    } else if (STREQ(tagname, "title")) {
@@ -1156,6 +1341,7 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 	    } else {
 		/* get the pointer to the tag structure */
 		tagPtr = (TableTag *) Tcl_GetHashValue(entryPtr);
+		TableMakeDataIndex(tablePtr, row, col, buf);
 		scanPtr = Tcl_FindHashEntry(tablePtr->cellStyles, buf);
 		/*
 		 * Look to see if there is a cell, row, or col tag
@@ -1266,8 +1452,9 @@ int Table_TagCmd(ClientData clientData, Tcl_Interp *interp, int objc, Tcl_Obj *c
 		tablePtr->tagPrios[i]     = tagPtr;
 		refresh = 1;
 	    }
-	    /* since we deleted a tag, redraw the screen */
+	    /* since we changed the priorities, remerge and redraw */
 	    if (refresh) {
+		TableFlushStyleCache(tablePtr);
 		TableInvalidateAll(tablePtr, 0);
 	    }
 	    return TCL_OK;
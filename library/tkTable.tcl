@@ -123,15 +123,12 @@ if {[package vcompare [package present Tk] 8.7] >= 0} {
 #
 if {[package vcompare [package present Tk] 8.7] >= 0} {
 bind Table <TouchpadScroll> {
-    if {%# %% 5 != 0} {
-        return
-    }
     lassign [tk::PreciseScrollDeltas %D] tk::Priv(deltaX) tk::Priv(deltaY)
     if {$tk::Priv(deltaX) != 0} {
- 	%W xview scroll [expr {-$tk::Priv(deltaX)}] units
+ 	%W xview scroll [expr {-$tk::Priv(deltaX)}] pixels
     }
     if {$tk::Priv(deltaY) != 0} {
-	%W yview scroll [expr {-$tk::Priv(deltaY)}] units
+	%W yview scroll [expr {-$tk::Priv(deltaY)}] pixels
     }
 }
 }